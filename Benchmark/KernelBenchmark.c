@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include "Kernels.h"
+
+/*  ********** Kernel benchmark **********
+ *
+ *  Times the math kernels against the floating point code they replace in Merger.c and HidgOutput.c, and checks that
+ *  they give the same results. Build and run with make benchmark, on the target for meaningful numbers.
+ */
+
+#define ITERATIONS 1000000
+#define POINTS 64
+#define SCREEN_SIZE 3000
+#define SPEED_LIMIT 5
+
+static double GetTimeNanoSeconds(void);
+static bool ReferenceIsFasterThan(int32_t dx, int32_t dy, uint32_t milliseconds);
+static uint16_t ReferenceScaleToReport(uint32_t value);
+static void BenchmarkDeghost(const int32_t * x, const int32_t * y);
+static void BenchmarkScaling(const uint32_t * values);
+
+// Keeps the compiler from removing the measured loops.
+static volatile uint32_t sink = 0;
+
+int main(void)
+{
+    int32_t x[POINTS];
+    int32_t y[POINTS];
+    uint32_t values[POINTS];
+
+    srand(1);
+    for (int i = 0; i < POINTS; i++)
+    {
+        x[i] = rand() % SCREEN_SIZE;
+        y[i] = rand() % SCREEN_SIZE;
+        values[i] = rand() % (SCREEN_SIZE + 100);   // Include some positions outside the screen.
+    }
+
+#if defined(__ARM_NEON)
+    printf("Kernels use NEON. \n");
+#else
+    printf("Kernels use the scalar fallback. \n");
+#endif
+
+    BenchmarkDeghost(x, y);
+    BenchmarkScaling(values);
+
+    return 0;
+}
+
+/*  Gets the monotonic time.
+ *
+ *  @return time in nanoseconds.
+*/
+static double GetTimeNanoSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/*  Speed check as Deghost did it before the kernels.
+ *
+ *  @return true if faster than the limit.
+*/
+static bool ReferenceIsFasterThan(int32_t dx, int32_t dy, uint32_t milliseconds)
+{
+    float distance = sqrtf(pow(abs(dx), 2) + pow(abs(dy), 2)) / 10;
+
+    return distance / milliseconds > SPEED_LIMIT;
+}
+
+/*  Scaling as HidgOutput did it before the kernels.
+ *
+ *  @return logical report coordinate.
+*/
+static uint16_t ReferenceScaleToReport(uint32_t value)
+{
+    double scaled = 1.0 * value / SCREEN_SIZE;
+
+    return KERNEL_REPORT_MAX * (scaled < 1.0 ? scaled : 1.0);
+}
+
+/*  Times the deghost speed check and counts disagreements.  */
+static void BenchmarkDeghost(const int32_t * x, const int32_t * y)
+{
+    int mismatches = 0;
+    uint32_t count = 0;
+
+    double start = GetTimeNanoSeconds();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        int j = i % POINTS;
+        count += ReferenceIsFasterThan(x[j] - y[j], y[j] - x[j], 1 + i % 200);
+    }
+    double reference = (GetTimeNanoSeconds() - start) / ITERATIONS;
+    sink += count;
+
+    count = 0;
+    start = GetTimeNanoSeconds();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        int j = i % POINTS;
+        count += KernelIsFasterThan(x[j] - y[j], y[j] - x[j], 1 + i % 200, SPEED_LIMIT);
+    }
+    double kernel = (GetTimeNanoSeconds() - start) / ITERATIONS;
+    sink += count;
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        int j = i % POINTS;
+        mismatches += ReferenceIsFasterThan(x[j] - y[j], y[j] - x[j], 1 + i % 200) !=
+                      KernelIsFasterThan(x[j] - y[j], y[j] - x[j], 1 + i % 200, SPEED_LIMIT);
+    }
+
+    printf("deghost speed check: float %.1f ns, kernel %.1f ns, %d mismatches \n", reference, kernel, mismatches);
+}
+
+/*  Times report scaling and measures the largest difference.  */
+static void BenchmarkScaling(const uint32_t * values)
+{
+    uint16_t scaled[POINTS];
+    int maxError = 0;
+
+    double start = GetTimeNanoSeconds();
+    for (int i = 0; i < ITERATIONS / POINTS; i++)
+    {
+        for (int j = 0; j < POINTS; j++)
+        {
+            scaled[j] = ReferenceScaleToReport(values[j] + (i & 1));
+        }
+        sink += scaled[i % POINTS];
+    }
+    double reference = (GetTimeNanoSeconds() - start) / (ITERATIONS / POINTS * POINTS);
+
+    uint32_t factor = KernelGetReportFactor(SCREEN_SIZE);
+    start = GetTimeNanoSeconds();
+    for (int i = 0; i < ITERATIONS / POINTS; i++)
+    {
+        for (int j = 0; j < POINTS; j++)
+        {
+            scaled[j] = KernelScaleToReport(values[j] + (i & 1), factor);
+        }
+        sink += scaled[i % POINTS];
+    }
+    double kernel = (GetTimeNanoSeconds() - start) / (ITERATIONS / POINTS * POINTS);
+
+    uint32_t shifted[POINTS];
+    start = GetTimeNanoSeconds();
+    for (int i = 0; i < ITERATIONS / POINTS; i++)
+    {
+        for (int j = 0; j < POINTS; j++)
+        {
+            shifted[j] = values[j] + (i & 1);
+        }
+        KernelScaleToReportBatch(shifted, scaled, POINTS, factor);
+        sink += scaled[i % POINTS];
+    }
+    double batch = (GetTimeNanoSeconds() - start) / (ITERATIONS / POINTS * POINTS);
+
+    for (uint32_t value = 0; value <= SCREEN_SIZE + 100; value++)
+    {
+        int error = abs((int)ReferenceScaleToReport(value) - (int)KernelScaleToReport(value, factor));
+        maxError = error > maxError ? error : maxError;
+    }
+
+    printf("report scaling: double %.1f ns, kernel %.1f ns, batch %.1f ns, max error %d \n", reference, kernel, batch, maxError);
+}
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "Merger.h"
+#include "Metrics.h"
+#include "Settings.h"
+#include "TouchStream.h"
+#include <zForce.h>
+#include <TouchMessage.h>
+
+/*  ********** Merger benchmark **********
+ *
+ *  Feeds a synthetic two sensor trace through the merger and measures throughput, once for the merger alone and once end
+ *  to end with every merged frame published to a private shared memory touch stream, as the shm output does. Three
+ *  fingers move at the same time: one in the overlap seen by both sensors and one on each sensor. Build and run with
+ *  make benchmark, once per ARCHITECTURE to compare targets.
+ *
+ *  The merger runs on the trace time instead of the monotonic clock, see MetricsSetReplayTime, so released contacts
+ *  time out and expire as they would with real sensors, however fast the machine is. A run fails if any touch is
+ *  dropped because all contacts are in use, it would measure the reject path instead of the touch path.
+ *
+ *  Before measuring, a tap whose up event is debounced is checked to be released by the up timeout, so a contact left
+ *  touching can not skew the runs.
+ */
+
+#define FRAMES 100000               // Sensor frames per run, a full run is kept below an hour of sensor time.
+#define FRAME_INTERVAL 5            // Milliseconds between sensor frames.
+#define STROKE_FRAMES 200           // Frames from down to up of every finger.
+#define QUICK_TAP_WAIT 2000         // Milliseconds after a debounced tap by which it must be released.
+#define REPLAY_START 1000000        // Replay clock in microseconds at sensor time 0, must not be 0.
+#define BENCHMARK_STREAM_NAME "/multi-sensor-benchmark"
+
+typedef struct Finger
+{
+    int      Sensor;
+    uint32_t Id;
+    uint32_t X;
+    uint32_t Y;
+} Finger;
+
+static double GetTimeSeconds(void);
+static uint64_t GetSensorTimestamp(uint32_t milliseconds);
+static bool CheckQuickTap(void);
+static double Run(bool publish, uint32_t * merged);
+static const TouchFrame * Send(const Finger * finger, TouchEvent event, uint32_t offset, uint32_t milliseconds);
+
+// Referenced by the merger on fatal errors.
+volatile bool shutDownNow = false;
+
+static SensorConfiguration sensorConfigurations[2];
+static uint32_t sensorTime = 0;     // Milliseconds of the next sensor frame, continued by every run so touches of the runs are not mixed up.
+
+// Sensor coordinates, the overlap of the 1700 high sensors on a 3000 high screen is around sensor Y 1500.
+static const Finger fingers[] =
+{
+    { 0, 0, 500, 1500 },
+    { 1, 0, 502, 1500 },
+    { 0, 1, 2000, 500 },
+    { 1, 1, 2500, 500 },
+};
+
+// Outside the overlap, so the tap is reported without a consensus of the other sensor.
+static const Finger tapFinger = { 0, 0, 1000, 500 };
+
+int main(int argc, char * argv[])
+{
+    if (!ParseSettingsArguments(argc, argv))
+    {
+        PrintSettingsUsage(argv[0]);
+        return 1;
+    }
+
+    sensorConfigurations[0].SensorPosition = SensorPositionTopLeft;
+    sensorConfigurations[1].SensorPosition = SensorPositionBottomLeft;
+    for (int i = 0; i < 2; i++)
+    {
+        sensorConfigurations[i].TouchActiveAreaWidth = 3000;
+        sensorConfigurations[i].TouchActiveAreaHeight = 1700;
+        AddSensorConfiguration(sensorConfigurations[i]);
+    }
+
+    if (!TouchStreamOpen(BENCHMARK_STREAM_NAME))
+    {
+        return 1;
+    }
+
+    if (!CheckQuickTap())
+    {
+        TouchStreamClose();
+        return 1;
+    }
+
+    uint32_t merged = 0;
+    int touches = FRAMES * sizeof(fingers) / sizeof(fingers[0]);
+
+    double seconds = Run(false, &merged);
+    printf("merger: %.0f touches/s, %.2f us/touch, %u merged frames \n", touches / seconds, seconds * 1e6 / touches, merged);
+
+    seconds = Run(true, &merged);
+    printf("end-to-end: %.0f touches/s, %.2f us/touch, %u merged frames \n", touches / seconds, seconds * 1e6 / touches, merged);
+
+    TouchStreamClose();
+
+    uint64_t exhausted = MetricsGetCounter(MetricsCounterContactsExhausted);
+    if (exhausted > 0)
+    {
+        printf("Error: %llu touches dropped because all contacts were in use, the results are not valid. \n", (unsigned long long)exhausted);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*  Gets the monotonic time.
+ *
+ *  @return time in seconds.
+*/
+static double GetTimeSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/*  Converts milliseconds to the decimal minute, second and millisecond format of the sensor timestamps.
+ *
+ *  @return sensor timestamp.
+*/
+static uint64_t GetSensorTimestamp(uint32_t milliseconds)
+{
+    return (uint64_t)(milliseconds / 60000) * 100000 + (milliseconds / 1000 % 60) * 1000 + milliseconds % 1000;
+}
+
+/*  Sends a down, move and up of one touch within the debounce window, so the up is debounced, and checks that the
+ *  contact is released once the up timeout has passed.
+ *
+ *  @return true if released, false if the contact is still touching.
+*/
+static bool CheckQuickTap(void)
+{
+    Send(&tapFinger, DownEvent, 0, sensorTime);
+    Send(&tapFinger, MoveEvent, 0, sensorTime + FRAME_INTERVAL);
+    Send(&tapFinger, UpEvent, 0, sensorTime + 2 * FRAME_INTERVAL);
+
+    sensorTime += QUICK_TAP_WAIT;
+    MetricsSetReplayTime(REPLAY_START + sensorTime * 1000ull);
+    TimeoutCallback();
+    bool isReleased = !IsTouchFrameTouching();
+
+    if (!isReleased)
+    {
+        printf("Error: A tap with a debounced up event is still touching after %d ms. \n", QUICK_TAP_WAIT);
+    }
+    return isReleased;
+}
+
+/*  Runs the trace through the merger, optionally publishing every merged frame.
+ *
+ *  @return elapsed time in seconds.
+*/
+static double Run(bool publish, uint32_t * merged)
+{
+    const int numberOfFingers = sizeof(fingers) / sizeof(fingers[0]);
+
+    *merged = 0;
+    double start = GetTimeSeconds();
+
+    for (int frame = 0; frame < FRAMES; frame++, sensorTime += FRAME_INTERVAL)
+    {
+        int stroke = frame % STROKE_FRAMES;
+        TouchEvent event = stroke == 0 ? DownEvent : stroke == STROKE_FRAMES - 1 ? UpEvent : MoveEvent;
+
+        for (int i = 0; i < numberOfFingers; i++)
+        {
+            const TouchFrame * touchFrame = Send(&fingers[i], event, stroke, sensorTime);
+            if (touchFrame == NULL)
+            {
+                continue;
+            }
+
+            (*merged)++;
+            for (int j = 0; publish && j < touchFrame->NumberOfContacts; j++)
+            {
+                TouchStreamPublish(&touchFrame->Contacts[j], TouchStreamRecordMerged);
+            }
+        }
+
+        TimeoutCallback();
+    }
+
+    return GetTimeSeconds() - start;
+}
+
+/*  Sends a touch of a finger to the merger at given sensor time.
+ *
+ *  @return merged frame, NULL if the touch did not produce one.
+*/
+static const TouchFrame * Send(const Finger * finger, TouchEvent event, uint32_t offset, uint32_t milliseconds)
+{
+    TouchMessage message;
+    IndexedMessage indexedMessage;
+
+    MetricsSetReplayTime(REPLAY_START + milliseconds * 1000ull);
+
+    memset(&message, 0, sizeof(message));
+    message.Id = finger->Id;
+    message.Event = event;
+    message.X = finger->X + offset * 2;
+    message.Y = finger->Y;
+
+    memset(&indexedMessage, 0, sizeof(indexedMessage));
+    indexedMessage.Message = (Message *)&message;
+    indexedMessage.SensorConfiguration = &sensorConfigurations[finger->Sensor];
+    indexedMessage.Timestamp = GetSensorTimestamp(milliseconds);
+
+    return MergeTouch(&indexedMessage) != NULL ? GetTouchFrame() : NULL;
+}
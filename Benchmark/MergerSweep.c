@@ -0,0 +1,1395 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "Merger.h"
+#include "Metrics.h"
+#include "Settings.h"
+#include <zForce.h>
+#include <TouchMessage.h>
+
+/*  ********** Merger parameter sweep **********
+ *
+ *  Replays a touch trace through the merger once for every combination of a grid of settings, and scores every run
+ *  against the ground truth of the trace: how long presses and releases are delayed, how far the reported position is
+ *  from the finger, how many presses are reported that no finger made, including presses split in two by a bounce, and
+ *  how many finger strokes are never reported. All runs are written to a CSV file and the Pareto front, the runs no
+ *  other run beats on latency, position error, ghost rate and missed rate at the same time, is printed. Runs with the
+ *  same scores are printed as one row that lists the values they were run with.
+ *
+ *  The merger keeps its state in globals, so every run is a forked worker with a fresh merger, and as many run at the
+ *  same time as there are cores. The merger runs on the trace time instead of the monotonic clock, see
+ *  MetricsSetReplayTime, so a run takes a fraction of the recorded time and does not depend on the load of the machine.
+ *
+ *  A trace is a CSV file with one line per sensor, sensor touch and ground truth sample, # starts a comment:
+ *      sensor,<position>,<width>,<height>          Sensor position and touch active area, as in sensor_positions.csv.
+ *      touch,<ms>,<sensor>,<id>,<event>,<x>,<y>    Touch of the sensor on the given sensor line, in sensor coordinates.
+ *      truth,<ms>,<finger>,<event>,<x>,<y>         Annotated finger position in screen coordinates, 1/10 mm.
+ *  Events are down, move or up, and a finger stroke runs from a down to the next up of the finger. Without --trace a
+ *  synthetic trace with known truth is generated for two horizontal 3000 x 1700 sensors on the default 3000 x 3000
+ *  screen: taps and drags with sensor noise, bounces, position jumps and stray light touches mixed in.
+ */
+
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+
+#define MAX_SWEEP_PARAMETERS 8          // Settings swept at the same time.
+#define MAX_SWEEP_VALUES 16             // Values of a swept setting.
+#define MAX_SWEEP_ARGUMENTS 64          // Settings arguments of a run, the fixed ones and the swept ones.
+#define MAX_TRACE_LINE_SIZE 256
+#define MAX_OPEN_CONTACTS 32            // Reported contacts that are not released yet.
+#define MATCH_DISTANCE 150              // Largest distance in 1/10 mm from a press to the finger it is attributed to.
+#define MATCH_SLACK 200                 // Milliseconds before a finger lands and after it lifts a press is still attributed to it.
+#define FLUSH_TIME 5000                 // Milliseconds replayed after the last touch, so every contact is released.
+#define REPLAY_START 1000000            // Replay clock in microseconds at trace time 0, must not be 0.
+#define SWEEP_RESULTS_FILE "sweep-results.csv"
+
+#define SYNTHETIC_SEED 1
+#define SYNTHETIC_STROKES 400           // Finger strokes of the synthetic trace, about 6 minutes of touches.
+#define SYNTHETIC_FRAME_INTERVAL 5      // Milliseconds between sensor frames.
+#define SYNTHETIC_BOUNCE_FRAMES 12      // Longest bounce in frames, long enough to outlast the shorter debounce windows.
+#define SYNTHETIC_STRAY_FRAMES 8        // Longest stray light touch in frames.
+#define SYNTHETIC_SCREEN_SIZE 3000      // Width and height of the screen in 1/10 mm.
+#define SYNTHETIC_SENSOR_HEIGHT 1700    // Height of the sensors, they overlap between screen Y 1300 and 1700.
+
+typedef struct SweepParameter
+{
+    char   Specification[MAX_SETTING_STRING_SIZE];  // name:value,value,... split in place into the name and the values.
+    char * Name;
+    char * Values[MAX_SWEEP_VALUES];
+    int    NumberOfValues;
+} SweepParameter;
+
+typedef struct TraceRecord
+{
+    uint32_t              Time;         // Milliseconds from the start of the trace.
+    int                   Sensor;       // Index of the sensor line, -1 for the truth.
+    uint32_t              Id;           // Touch id of the sensor, or finger of the truth.
+    ApplicationTouchEvent Event;
+    int32_t               X;
+    int32_t               Y;
+    int                   Order;        // Position in the file, keeps records of the same time in order.
+} TraceRecord;
+
+typedef struct TraceRecords
+{
+    TraceRecord * Records;
+    int           Count;
+    int           Capacity;
+} TraceRecords;
+
+typedef struct Stroke
+{
+    int    First;           // Truth record of the down event.
+    int    Last;            // Truth record of the up event.
+    int    Presses;         // Presses of the current run attributed to the stroke.
+    double FirstPress;      // Milliseconds of the first press of the current run.
+    double LastRelease;     // Milliseconds of the last release of the current run, negative if not released.
+} Stroke;
+
+typedef struct Trace
+{
+    SensorConfiguration Sensors[MAX_SENSORS];
+    int                 NumberOfSensors;
+    TraceRecords        Touches;
+    TraceRecords        Truth;      // Sorted by finger and time, see BuildStrokes.
+    Stroke            * Strokes;    // Sorted by down time.
+    int                 NumberOfStrokes;
+} Trace;
+
+typedef struct SweepResult
+{
+    bool  IsValid;
+    bool  IsParetoOptimal;
+    float PressLatency;     // Mean milliseconds from a finger landing to its press being reported.
+    float ReleaseLatency;   // Mean milliseconds from a finger lifting to its release being reported.
+    float PositionError;    // Root mean square distance in mm from the reported position to the finger.
+    float GhostRate;        // Reported presses no finger made, per finger stroke.
+    float MissedRate;       // Fraction of finger strokes that are never reported.
+} SweepResult;
+
+typedef struct OpenContact
+{
+    uint32_t ContactId;
+    int      Stroke;        // Stroke the press was attributed to, -1 for a ghost.
+} OpenContact;
+
+static bool ParseArguments(int argc, char * argv[]);
+static bool AddSweepParameter(const char * specification);
+static void PrintUsage(void);
+static bool LoadTrace(Trace * trace, const char * path);
+static bool ParseTraceEvent(const char * text, ApplicationTouchEvent * event);
+static bool WriteTrace(const Trace * trace, const char * path);
+static bool AppendRecord(TraceRecords * records, TraceRecord record);
+static int CompareTime(const void * a, const void * b);
+static int CompareFingerTime(const void * a, const void * b);
+static int CompareStrokes(const void * a, const void * b);
+static bool BuildStrokes(Trace * trace);
+static void GenerateTrace(Trace * trace, uint32_t seed);
+static void GenerateStroke(Trace * trace, uint32_t finger, uint32_t start, int frames, float x, float y, float vx, float vy);
+static void GenerateStrayTouch(Trace * trace, uint32_t start);
+static bool ToSensorCoordinates(int sensor, float x, float y, int32_t * sensorX, int32_t * sensorY);
+static uint32_t Random(void);
+static int32_t RandomRange(int32_t min, int32_t max);
+static bool ValidateSweep(void);
+static int GetArguments(int point, char * arguments[], char values[][MAX_SETTING_STRING_SIZE * 2]);
+static void RunSweep(void);
+static bool RunPoint(int point, SweepResult * result);
+static void Replay(void);
+static void AdvanceTo(uint64_t time);
+static void ObserveFrame(const TouchFrame * frame);
+static int FindStroke(double time, uint32_t x, uint32_t y);
+static float GetTruthDistanceSquared(const Stroke * stroke, double time, uint32_t x, uint32_t y);
+static void ScoreRun(SweepResult * result);
+static const char * GetPointValue(int point, int parameter);
+static float GetLatency(const SweepResult * result);
+static bool Dominates(const SweepResult * a, const SweepResult * b);
+static bool HasEqualScores(const SweepResult * a, const SweepResult * b);
+static void MarkParetoFront(void);
+static bool IsFirstOfEqualScores(int point);
+static void GetEquivalentValues(int point, int parameter, char * values, size_t size);
+static bool WriteResults(const char * path);
+static void PrintParetoFront(void);
+
+// Referenced by the merger on fatal errors.
+volatile bool shutDownNow = false;
+
+static const char * defaultSweep[] =
+{
+    "up-timeout-frames:4,6,8,16",
+    "debounce-frames:2,4,8",
+    "deghost-speed-limit:1,2,5,10",
+    "smoothing-min-cutoff:0.5,1,2,4",
+    "seam-crossfade:0,100,200",
+};
+
+// Screen offset of the touches of each synthetic sensor, as from a slightly misaligned mounting.
+static const int32_t syntheticOffsets[2][2] = { { 0, 0 }, { 12, -10 } };
+
+static SweepParameter sweepParameters[MAX_SWEEP_PARAMETERS];
+static int            numberOfSweepParameters = 0;
+static int            numberOfPoints = 1;
+static char         * fixedArguments[MAX_SWEEP_ARGUMENTS];
+static int            numberOfFixedArguments = 0;
+static const char   * applicationName = NULL;
+static const char   * tracePath = NULL;
+static const char   * writeTracePath = NULL;
+static const char   * resultsPath = SWEEP_RESULTS_FILE;
+static int            jobs = 0;
+static uint32_t       seed = SYNTHETIC_SEED;
+static Trace          trace;
+static SweepResult  * results = NULL;     // Shared with the workers.
+static uint32_t       randomState = SYNTHETIC_SEED;
+
+// State of the run of a worker.
+static uint64_t       replayTime = REPLAY_START;
+static OpenContact    openContacts[MAX_OPEN_CONTACTS];
+static int            numberOfOpenContacts = 0;
+static int            ghosts = 0;
+static double         squaredErrorSum = 0;
+static int            errorSamples = 0;
+
+int main(int argc, char * argv[])
+{
+    applicationName = argv[0];
+
+    if (!ParseArguments(argc, argv))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    bool isDefaultSweep = numberOfSweepParameters == 0;
+    for (int i = 0; isDefaultSweep && i < (int)(sizeof(defaultSweep) / sizeof(defaultSweep[0])); i++)
+    {
+        AddSweepParameter(defaultSweep[i]);
+    }
+
+    if (tracePath != NULL)
+    {
+        if (!LoadTrace(&trace, tracePath))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        GenerateTrace(&trace, seed);
+    }
+
+    if (!BuildStrokes(&trace))
+    {
+        return 1;
+    }
+
+    if (writeTracePath != NULL && !WriteTrace(&trace, writeTracePath))
+    {
+        return 1;
+    }
+
+    if (!ValidateSweep())
+    {
+        return 1;
+    }
+
+    printf("Trace: %d sensors, %d touches, %d finger strokes. \n", trace.NumberOfSensors, trace.Touches.Count, trace.NumberOfStrokes);
+
+    results = mmap(NULL, numberOfPoints * sizeof(SweepResult), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED)
+    {
+        perror("Error: Allocating sweep results");
+        return 1;
+    }
+
+    if (jobs <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cores > 0 ? (int)cores : 1;
+    }
+
+    printf("Running %d settings combinations on %d workers. \n", numberOfPoints, jobs);
+    RunSweep();
+    MarkParetoFront();
+
+    if (!WriteResults(resultsPath))
+    {
+        return 1;
+    }
+
+    PrintParetoFront();
+
+    return 0;
+}
+
+/*  Parses the arguments of the sweep. Arguments that are not for the sweep are settings every run uses.
+ *
+ *  @return true on success, false if an argument is invalid.
+*/
+static bool ParseArguments(int argc, char * argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        char * argument = argv[i];
+
+        if (strncmp(argument, "--sweep=", 8) == 0)
+        {
+            if (!AddSweepParameter(argument + 8))
+            {
+                return false;
+            }
+        }
+        else if (strncmp(argument, "--trace=", 8) == 0)
+        {
+            tracePath = argument + 8;
+        }
+        else if (strncmp(argument, "--write-trace=", 14) == 0)
+        {
+            writeTracePath = argument + 14;
+        }
+        else if (strncmp(argument, "--results=", 10) == 0)
+        {
+            resultsPath = argument + 10;
+        }
+        else if (strncmp(argument, "--jobs=", 7) == 0)
+        {
+            jobs = atoi(argument + 7);
+        }
+        else if (strncmp(argument, "--seed=", 7) == 0)
+        {
+            seed = (uint32_t)strtoul(argument + 7, NULL, 10);
+        }
+        else if (strcmp(argument, "--help") == 0)
+        {
+            return false;
+        }
+        else if (numberOfFixedArguments < MAX_SWEEP_ARGUMENTS - MAX_SWEEP_PARAMETERS - 4)
+        {
+            fixedArguments[numberOfFixedArguments++] = argument;
+        }
+        else
+        {
+            printf("Error: Too many settings. \n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*  Adds a swept setting given as name:value,value,...
+ *
+ *  @return true on success, false if the specification is invalid.
+*/
+static bool AddSweepParameter(const char * specification)
+{
+    if (numberOfSweepParameters == MAX_SWEEP_PARAMETERS)
+    {
+        printf("Error: At most %d settings can be swept. \n", MAX_SWEEP_PARAMETERS);
+        return false;
+    }
+
+    SweepParameter * parameter = &sweepParameters[numberOfSweepParameters];
+    snprintf(parameter->Specification, sizeof(parameter->Specification), "%s", specification);
+
+    char * separator = strchr(parameter->Specification, ':');
+    if (separator == NULL || separator == parameter->Specification)
+    {
+        printf("Error: Invalid sweep %s, expected name:value,value,... \n", specification);
+        return false;
+    }
+
+    *separator = '\0';
+    parameter->Name = parameter->Specification;
+    parameter->NumberOfValues = 0;
+
+    for (char * value = strtok(separator + 1, ","); value != NULL; value = strtok(NULL, ","))
+    {
+        if (parameter->NumberOfValues == MAX_SWEEP_VALUES)
+        {
+            printf("Error: At most %d values can be swept for %s. \n", MAX_SWEEP_VALUES, parameter->Name);
+            return false;
+        }
+        parameter->Values[parameter->NumberOfValues++] = value;
+    }
+
+    if (parameter->NumberOfValues == 0)
+    {
+        printf("Error: No values to sweep for %s. \n", parameter->Name);
+        return false;
+    }
+
+    numberOfSweepParameters++;
+    numberOfPoints *= parameter->NumberOfValues;
+    return true;
+}
+
+/*  Prints the arguments of the sweep and the settings.  */
+static void PrintUsage(void)
+{
+    printf("Usage: %s [--trace=<file>] [--sweep=<setting>:<value>,<value>,...]... [--<setting>=<value>]... \n", applicationName);
+    printf("   --trace=<file>         Trace to replay, a synthetic trace with known truth if not given. \n");
+    printf("   --write-trace=<file>   Writes the replayed trace, e.g. to keep the synthetic one. \n");
+    printf("   --sweep=<setting>:...  Values of a setting to try, given once per setting. Without any, sweeps %d settings: \n", (int)(sizeof(defaultSweep) / sizeof(defaultSweep[0])));
+    for (int i = 0; i < (int)(sizeof(defaultSweep) / sizeof(defaultSweep[0])); i++)
+    {
+        printf("                            %s \n", defaultSweep[i]);
+    }
+    printf("   --results=<file>       CSV file with the scores of every run, default %s. \n", SWEEP_RESULTS_FILE);
+    printf("   --jobs=<workers>       Runs at the same time, default the number of cores. \n");
+    printf("   --seed=<number>        Seed of the synthetic trace, default %d. \n", SYNTHETIC_SEED);
+    printf("Every run uses --report-rate=0 so every merged touch is scored, and the settings below. The up timeout and the \n");
+    printf("debounce window are up-timeout-frames and debounce-frames frames of the trace, limited by up-timeout and \n");
+    printf("debounce-interval. \n\n");
+    PrintSettingsUsage(applicationName);
+}
+
+/*  ********** Traces ********** */
+
+/*  Reads a trace file, see the format at the top of the file.
+ *
+ *  @return true on success, false if the file can not be read or has an invalid line.
+*/
+static bool LoadTrace(Trace * trace, const char * path)
+{
+    FILE * file = fopen(path, "r");
+    char line[MAX_TRACE_LINE_SIZE];
+    int lineNumber = 0;
+
+    if (file == NULL)
+    {
+        printf("Error: Unable to open trace %s. \n", path);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char kind[16], event[16];
+        int position, width, height, sensor;
+        TraceRecord record = { .Order = lineNumber++ };
+        bool isValid = true;
+
+        char * comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        if (sscanf(line, " %15[a-z]", kind) != 1)
+        {
+            continue;
+        }
+
+        if (strcmp(kind, "sensor") == 0)
+        {
+            isValid = sscanf(line, " sensor,%d,%d,%d", &position, &width, &height) == 3 &&
+                      trace->NumberOfSensors < MAX_SENSORS && position >= SensorPositionTopLeft &&
+                      position <= SensorPositionBottomRight && width > 0 && height > 0;
+            if (isValid)
+            {
+                SensorConfiguration * configuration = &trace->Sensors[trace->NumberOfSensors++];
+                configuration->SensorPosition = (SensorPosition)position;
+                configuration->TouchActiveAreaWidth = width;
+                configuration->TouchActiveAreaHeight = height;
+            }
+        }
+        else if (strcmp(kind, "touch") == 0)
+        {
+            isValid = sscanf(line, " touch,%u,%d,%u,%15[a-z],%d,%d", &record.Time, &sensor, &record.Id, event, &record.X, &record.Y) == 6 &&
+                      sensor >= 0 && sensor < trace->NumberOfSensors && record.X >= 0 && record.Y >= 0 &&
+                      ParseTraceEvent(event, &record.Event);
+            record.Sensor = sensor;
+            isValid = isValid && AppendRecord(&trace->Touches, record);
+        }
+        else if (strcmp(kind, "truth") == 0)
+        {
+            isValid = sscanf(line, " truth,%u,%u,%15[a-z],%d,%d", &record.Time, &record.Id, event, &record.X, &record.Y) == 5 &&
+                      ParseTraceEvent(event, &record.Event);
+            record.Sensor = -1;
+            isValid = isValid && AppendRecord(&trace->Truth, record);
+        }
+        else
+        {
+            isValid = false;
+        }
+
+        if (!isValid)
+        {
+            printf("Error: Invalid line %d in trace %s. \n", lineNumber, path);
+            fclose(file);
+            return false;
+        }
+    }
+
+    fclose(file);
+
+    if (trace->NumberOfSensors != 2 && trace->NumberOfSensors != 4)
+    {
+        printf("Error: The trace %s must have 2 or 4 sensor lines before its touches. \n", path);
+        return false;
+    }
+
+    return true;
+}
+
+/*  Parses the event of a trace line.
+ *
+ *  @return true on success, false if the event is unknown.
+*/
+static bool ParseTraceEvent(const char * text, ApplicationTouchEvent * event)
+{
+    if (strcmp(text, "down") == 0)
+    {
+        *event = App_DownEvent;
+    }
+    else if (strcmp(text, "move") == 0)
+    {
+        *event = App_MoveEvent;
+    }
+    else if (strcmp(text, "up") == 0)
+    {
+        *event = App_UpEvent;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/*  Writes a trace file that LoadTrace reads back.
+ *
+ *  @return true on success, false on fail.
+*/
+static bool WriteTrace(const Trace * trace, const char * path)
+{
+    static const char * eventNames[] = { [App_DownEvent] = "down", [App_MoveEvent] = "move", [App_UpEvent] = "up" };
+    FILE * file = fopen(path, "w");
+
+    if (file == NULL)
+    {
+        printf("Error: Unable to write trace %s. \n", path);
+        return false;
+    }
+
+    fprintf(file, "# sensor,position,width,height\n");
+    for (int i = 0; i < trace->NumberOfSensors; i++)
+    {
+        fprintf(file, "sensor,%d,%u,%u\n", trace->Sensors[i].SensorPosition,
+            trace->Sensors[i].TouchActiveAreaWidth, trace->Sensors[i].TouchActiveAreaHeight);
+    }
+
+    fprintf(file, "# touch,ms,sensor,id,event,x,y\n");
+    for (int i = 0; i < trace->Touches.Count; i++)
+    {
+        const TraceRecord * record = &trace->Touches.Records[i];
+        fprintf(file, "touch,%u,%d,%u,%s,%d,%d\n", record->Time, record->Sensor, record->Id, eventNames[record->Event], record->X, record->Y);
+    }
+
+    fprintf(file, "# truth,ms,finger,event,x,y\n");
+    for (int i = 0; i < trace->Truth.Count; i++)
+    {
+        const TraceRecord * record = &trace->Truth.Records[i];
+        fprintf(file, "truth,%u,%u,%s,%d,%d\n", record->Time, record->Id, eventNames[record->Event], record->X, record->Y);
+    }
+
+    fclose(file);
+    return true;
+}
+
+/*  Appends a record, growing the array as needed.
+ *
+ *  @return true on success, false if out of memory.
+*/
+static bool AppendRecord(TraceRecords * records, TraceRecord record)
+{
+    if (records->Count == records->Capacity)
+    {
+        int capacity = records->Capacity > 0 ? records->Capacity * 2 : 1024;
+        TraceRecord * grown = realloc(records->Records, capacity * sizeof(TraceRecord));
+        if (grown == NULL)
+        {
+            printf("Error: Out of memory for the trace. \n");
+            return false;
+        }
+
+        records->Records = grown;
+        records->Capacity = capacity;
+    }
+
+    records->Records[records->Count++] = record;
+    return true;
+}
+
+/*  Orders records by time, and records of the same time as they were added.  */
+static int CompareTime(const void * a, const void * b)
+{
+    const TraceRecord * recordA = a;
+    const TraceRecord * recordB = b;
+
+    if (recordA->Time != recordB->Time)
+    {
+        return recordA->Time < recordB->Time ? -1 : 1;
+    }
+
+    return recordA->Order - recordB->Order;
+}
+
+/*  Orders records by finger, then by time.  */
+static int CompareFingerTime(const void * a, const void * b)
+{
+    const TraceRecord * recordA = a;
+    const TraceRecord * recordB = b;
+
+    if (recordA->Id != recordB->Id)
+    {
+        return recordA->Id < recordB->Id ? -1 : 1;
+    }
+
+    return CompareTime(a, b);
+}
+
+/*  Orders strokes by down time.  */
+static int CompareStrokes(const void * a, const void * b)
+{
+    const Stroke * strokeA = a;
+    const Stroke * strokeB = b;
+
+    return CompareTime(&trace.Truth.Records[strokeA->First], &trace.Truth.Records[strokeB->First]);
+}
+
+/*  Sorts the touches by time and splits the truth into finger strokes, each from a down to the next up of the finger.
+ *
+ *  @return true on success, false if the trace has no complete stroke.
+*/
+static bool BuildStrokes(Trace * trace)
+{
+    qsort(trace->Touches.Records, trace->Touches.Count, sizeof(TraceRecord), CompareTime);
+    qsort(trace->Truth.Records, trace->Truth.Count, sizeof(TraceRecord), CompareFingerTime);
+
+    trace->Strokes = malloc((trace->Truth.Count / 2 + 1) * sizeof(Stroke));
+    trace->NumberOfStrokes = 0;
+    if (trace->Strokes == NULL)
+    {
+        printf("Error: Out of memory for the trace. \n");
+        return false;
+    }
+
+    int first = -1;
+    for (int i = 0; i < trace->Truth.Count; i++)
+    {
+        const TraceRecord * record = &trace->Truth.Records[i];
+
+        if (first >= 0 && record->Id != trace->Truth.Records[first].Id)
+        {
+            first = -1;
+        }
+
+        if (record->Event == App_DownEvent)
+        {
+            first = i;
+        }
+        else if (record->Event == App_UpEvent && first >= 0)
+        {
+            trace->Strokes[trace->NumberOfStrokes++] = (Stroke){ .First = first, .Last = i, .LastRelease = -1 };
+            first = -1;
+        }
+    }
+
+    if (trace->NumberOfStrokes == 0)
+    {
+        printf("Error: The trace has no finger stroke from a truth down to an up event. \n");
+        return false;
+    }
+
+    qsort(trace->Strokes, trace->NumberOfStrokes, sizeof(Stroke), CompareStrokes);
+    return true;
+}
+
+/*  ********** Synthetic trace ********** */
+
+/*  Generates taps and drags one after the other, about a third of them in the overlap of the sensors. Some drags are
+ *  fast flicks, and some strokes have a bounce, where a sensor loses the finger for a few frames, or a single touch
+ *  that jumps far away. Stray light touches appear on a single sensor between and during the strokes.
+*/
+static void GenerateTrace(Trace * trace, uint32_t seed)
+{
+    randomState = seed != 0 ? seed : SYNTHETIC_SEED;
+
+    trace->NumberOfSensors = 2;
+    trace->Sensors[0] = (SensorConfiguration){ .SensorPosition = SensorPositionTopLeft,
+        .TouchActiveAreaWidth = SYNTHETIC_SCREEN_SIZE, .TouchActiveAreaHeight = SYNTHETIC_SENSOR_HEIGHT };
+    trace->Sensors[1] = (SensorConfiguration){ .SensorPosition = SensorPositionBottomLeft,
+        .TouchActiveAreaWidth = SYNTHETIC_SCREEN_SIZE, .TouchActiveAreaHeight = SYNTHETIC_SENSOR_HEIGHT };
+
+    const int32_t overlapTop = SYNTHETIC_SCREEN_SIZE - SYNTHETIC_SENSOR_HEIGHT;
+    uint32_t time = 100;
+
+    for (uint32_t finger = 0; finger < SYNTHETIC_STROKES; finger++)
+    {
+        bool isDrag = RandomRange(0, 99) < 40;
+        bool isFlick = isDrag && RandomRange(0, 99) < 15;
+        int frames = isDrag ? RandomRange(60, 180) : RandomRange(12, 30);
+        // 1/10 mm per ms, a flick is up to 2.5 mm per ms.
+        float speed = isFlick ? RandomRange(150, 250) / 10.0f : isDrag ? RandomRange(5, 60) / 10.0f : 0.1f;
+        float angle = RandomRange(0, 359) * (float)M_PI / 180;
+        float x = RandomRange(200, SYNTHETIC_SCREEN_SIZE - 200);
+        float y = RandomRange(0, 99) < 30 ? RandomRange(overlapTop, SYNTHETIC_SENSOR_HEIGHT) : RandomRange(200, SYNTHETIC_SCREEN_SIZE - 200);
+
+        GenerateStroke(trace, finger, time, frames, x, y, speed * cosf(angle), speed * sinf(angle));
+
+        uint32_t next = time + frames * SYNTHETIC_FRAME_INTERVAL + RandomRange(150, 600);
+        if (RandomRange(0, 99) < 30)
+        {
+            GenerateStrayTouch(trace, RandomRange(time, next));
+        }
+        time = next;
+    }
+}
+
+/*  Generates the truth and the sensor touches of a finger moving at constant speed, stopping at the screen edges.  */
+static void GenerateStroke(Trace * trace, uint32_t finger, uint32_t start, int frames, float x, float y, float vx, float vy)
+{
+    int bounceSensor = RandomRange(0, 99) < 15 ? RandomRange(0, 1) : -1;
+    int bounceFrame = RandomRange(2, frames - 5);
+    int bounceFrames = RandomRange(1, MIN(SYNTHETIC_BOUNCE_FRAMES, frames - 2 - bounceFrame));
+    int jumpSensor = RandomRange(0, 99) < 10 ? RandomRange(0, 1) : -1;
+    int jumpFrame = RandomRange(1, frames - 2);
+    bool isSeen[2] = { false, false };
+    TraceRecord last[2] = { { 0 } };
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        uint32_t time = start + frame * SYNTHETIC_FRAME_INTERVAL;
+        float elapsed = (float)frame * SYNTHETIC_FRAME_INTERVAL;
+        float fingerX = fminf(fmaxf(x + vx * elapsed, 20), SYNTHETIC_SCREEN_SIZE - 20);
+        float fingerY = fminf(fmaxf(y + vy * elapsed, 20), SYNTHETIC_SCREEN_SIZE - 20);
+        ApplicationTouchEvent event = frame == 0 ? App_DownEvent : frame == frames - 1 ? App_UpEvent : App_MoveEvent;
+
+        AppendRecord(&trace->Truth, (TraceRecord){ time, -1, finger, event, (int32_t)fingerX, (int32_t)fingerY, trace->Truth.Count });
+
+        for (int sensor = 0; sensor < 2; sensor++)
+        {
+            // Sensor noise of a few 1/10 mm around the offset of the sensor.
+            float noisyX = fingerX + syntheticOffsets[sensor][0] + RandomRange(-4, 4) + RandomRange(-4, 4);
+            float noisyY = fingerY + syntheticOffsets[sensor][1] + RandomRange(-4, 4) + RandomRange(-4, 4);
+            bool isBouncing = sensor == bounceSensor && frame >= bounceFrame && frame < bounceFrame + bounceFrames;
+            TraceRecord record = { time, sensor, 0, App_MoveEvent, 0, 0, trace->Touches.Count };
+
+            if (frame == jumpFrame && sensor == jumpSensor)
+            {
+                noisyX = noisyX < SYNTHETIC_SCREEN_SIZE / 2 ? noisyX + 800 : noisyX - 800;
+            }
+
+            if (event != App_UpEvent && !isBouncing && ToSensorCoordinates(sensor, noisyX, noisyY, &record.X, &record.Y))
+            {
+                record.Event = isSeen[sensor] ? App_MoveEvent : App_DownEvent;
+                isSeen[sensor] = true;
+                last[sensor] = record;
+                AppendRecord(&trace->Touches, record);
+            }
+            else if (isSeen[sensor])
+            {
+                // The sensor lost the finger, it reports the release at the last position.
+                record.Event = App_UpEvent;
+                record.X = last[sensor].X;
+                record.Y = last[sensor].Y;
+                isSeen[sensor] = false;
+                AppendRecord(&trace->Touches, record);
+            }
+        }
+    }
+}
+
+/*  Generates a touch of up to SYNTHETIC_STRAY_FRAMES frames on a single sensor where no finger is, as from stray light.  */
+static void GenerateStrayTouch(Trace * trace, uint32_t start)
+{
+    int sensor = RandomRange(0, 1);
+    int frames = RandomRange(1, SYNTHETIC_STRAY_FRAMES);
+    TraceRecord record = { start, sensor, 1, App_DownEvent, RandomRange(100, SYNTHETIC_SCREEN_SIZE - 100),
+        RandomRange(100, SYNTHETIC_SENSOR_HEIGHT - 100), 0 };
+
+    for (int frame = 0; frame <= frames; frame++)
+    {
+        record.Time = start + frame * SYNTHETIC_FRAME_INTERVAL;
+        record.Event = frame == 0 ? App_DownEvent : frame == frames ? App_UpEvent : App_MoveEvent;
+        record.Order = trace->Touches.Count;
+        AppendRecord(&trace->Touches, record);
+    }
+}
+
+/*  Converts a screen position to the coordinates of a synthetic sensor, the inverse of MapTouchCoordinates for the top
+ *  left and bottom left horizontal sensors.
+ *
+ *  @return true if the sensor covers the position.
+*/
+static bool ToSensorCoordinates(int sensor, float x, float y, int32_t * sensorX, int32_t * sensorY)
+{
+    float mappedY = sensor == 0 ? y : SYNTHETIC_SCREEN_SIZE - y;
+
+    if (x < 0 || x >= SYNTHETIC_SCREEN_SIZE || mappedY < 0 || mappedY >= SYNTHETIC_SENSOR_HEIGHT)
+    {
+        return false;
+    }
+
+    *sensorX = (int32_t)x;
+    *sensorY = (int32_t)mappedY;
+    return true;
+}
+
+/*  Gets the next number of a xorshift generator, so a seed always gives the same trace.
+ *
+ *  @return pseudo random number.
+*/
+static uint32_t Random(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+/*  Gets a pseudo random number between min and max, both included.
+ *
+ *  @return number, min if max is less than min.
+*/
+static int32_t RandomRange(int32_t min, int32_t max)
+{
+    return max > min ? min + (int32_t)(Random() % (uint32_t)(max - min + 1)) : min;
+}
+
+/*  ********** Runs ********** */
+
+/*  Checks every swept value with the fixed settings before the workers start, so the errors are printed once.
+ *
+ *  @return true if all settings are valid.
+*/
+static bool ValidateSweep(void)
+{
+    char values[MAX_SWEEP_PARAMETERS][MAX_SETTING_STRING_SIZE * 2];
+    char * arguments[MAX_SWEEP_ARGUMENTS];
+    int stride = 1;
+
+    // The combination with the first value of all other settings.
+    for (int i = numberOfSweepParameters - 1; i >= 0; i--)
+    {
+        for (int value = 0; value < sweepParameters[i].NumberOfValues; value++)
+        {
+            if (!ParseSettingsArguments(GetArguments(value * stride, arguments, values), arguments))
+            {
+                printf("Error: Invalid settings for the sweep of %s. \n", sweepParameters[i].Name);
+                return false;
+            }
+        }
+        stride *= sweepParameters[i].NumberOfValues;
+    }
+
+    return true;
+}
+
+/*  Gets the settings arguments of a combination, the swept values after the fixed settings so they take precedence.
+ *
+ *  @return number of arguments, including the application name.
+*/
+static int GetArguments(int point, char * arguments[], char values[][MAX_SETTING_STRING_SIZE * 2])
+{
+    static char sensors[32];
+    int count = 0;
+
+    // The timeouts are derived from the sensor frame rate as in the application, and every merged touch is scored.
+    snprintf(sensors, sizeof(sensors), "--sensors=%d", trace.NumberOfSensors);
+    arguments[count++] = (char *)applicationName;
+    arguments[count++] = sensors;
+    arguments[count++] = "--report-rate=0";
+
+    for (int i = 0; i < numberOfFixedArguments; i++)
+    {
+        arguments[count++] = fixedArguments[i];
+    }
+
+    for (int i = 0; i < numberOfSweepParameters; i++)
+    {
+        snprintf(values[i], sizeof(values[i]), "--%s=%s", sweepParameters[i].Name, GetPointValue(point, i));
+        arguments[count++] = values[i];
+    }
+
+    return count;
+}
+
+/*  Runs every combination of the swept settings, each in a forked worker that writes its scores to the shared results.
+ *  A worker that fails leaves its result invalid.
+*/
+static void RunSweep(void)
+{
+    int running = 0;
+    int failed = 0;
+    int status;
+
+    for (int point = 0; point < numberOfPoints; point++)
+    {
+        if (running == jobs)
+        {
+            failed += wait(&status) > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+            running--;
+        }
+
+        // Output still buffered would be printed again by the worker.
+        fflush(stdout);
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            _exit(RunPoint(point, &results[point]) ? 0 : 1);
+        }
+        else if (pid < 0)
+        {
+            perror("Error: Starting sweep worker");
+            failed++;
+            continue;
+        }
+
+        running++;
+    }
+
+    for (; running > 0; running--)
+    {
+        failed += wait(&status) > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    if (failed > 0)
+    {
+        printf("Error: %d of %d runs failed. \n", failed, numberOfPoints);
+    }
+}
+
+/*  Replays the trace with the settings of one combination and scores the run. Only called in a worker, the merger is
+ *  set up from scratch. The settings were checked by ValidateSweep, so the output of the merger is discarded.
+ *
+ *  @return true on success, false if the settings are invalid or the merger failed.
+*/
+static bool RunPoint(int point, SweepResult * result)
+{
+    char values[MAX_SWEEP_PARAMETERS][MAX_SETTING_STRING_SIZE * 2];
+    char * arguments[MAX_SWEEP_ARGUMENTS];
+
+    if (freopen("/dev/null", "w", stdout) == NULL || !ParseSettingsArguments(GetArguments(point, arguments, values), arguments))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < trace.NumberOfSensors; i++)
+    {
+        AddSensorConfiguration(trace.Sensors[i]);
+    }
+
+    Replay();
+    if (shutDownNow)
+    {
+        return false;
+    }
+
+    ScoreRun(result);
+    return true;
+}
+
+/*  Sends every touch of the trace to the merger at its time, and releases the up pending contacts at their deadlines in
+ *  between as the main thread does.
+*/
+static void Replay(void)
+{
+    static SensorConfiguration configurations[MAX_SENSORS];
+
+    memcpy(configurations, trace.Sensors, sizeof(configurations));
+
+    for (int i = 0; i < trace.Touches.Count && !shutDownNow; i++)
+    {
+        const TraceRecord * record = &trace.Touches.Records[i];
+        uint32_t milliseconds = record->Time;
+        TouchMessage message;
+        IndexedMessage indexedMessage;
+
+        AdvanceTo(REPLAY_START + milliseconds * 1000ull);
+
+        memset(&message, 0, sizeof(message));
+        message.Id = record->Id;
+        message.Event = record->Event == App_DownEvent ? DownEvent : record->Event == App_UpEvent ? UpEvent : MoveEvent;
+        message.X = record->X;
+        message.Y = record->Y;
+
+        // Sensor timestamps are decimal minutes, seconds and milliseconds.
+        memset(&indexedMessage, 0, sizeof(indexedMessage));
+        indexedMessage.Message = (Message *)&message;
+        indexedMessage.SensorConfiguration = &configurations[record->Sensor];
+        indexedMessage.Timestamp = (uint64_t)(milliseconds / 60000) * 100000 + (milliseconds / 1000 % 60) * 1000 + milliseconds % 1000;
+
+        if (MergeTouch(&indexedMessage) != NULL)
+        {
+            ObserveFrame(GetTouchFrame());
+        }
+    }
+
+    uint32_t end = trace.Touches.Count > 0 ? trace.Touches.Records[trace.Touches.Count - 1].Time : 0;
+    AdvanceTo(REPLAY_START + (end + FLUSH_TIME) * 1000ull);
+}
+
+/*  Moves the replay clock to given time in microseconds, stopping at every up pending deadline before it.  */
+static void AdvanceTo(uint64_t time)
+{
+    for (;;)
+    {
+        MetricsSetReplayTime(replayTime);
+
+        int32_t timeout = GetTimeoutInMs();
+        if (timeout < 0 || replayTime + timeout * 1000ull > time)
+        {
+            break;
+        }
+
+        // The timeout is rounded up to whole milliseconds, so the deadline has passed.
+        replayTime += timeout * 1000ull;
+        MetricsSetReplayTime(replayTime);
+
+        if (TimeoutCallback())
+        {
+            ObserveFrame(GetTouchFrame());
+        }
+    }
+
+    replayTime = time;
+    MetricsSetReplayTime(replayTime);
+}
+
+/*  Scores a frame as sent to the host: a contact not seen before is a press, attributed to the finger stroke it is
+ *  closest to or else counted as a ghost, and the position of every touching contact is compared with its finger.
+*/
+static void ObserveFrame(const TouchFrame * frame)
+{
+    double time = (replayTime - REPLAY_START) / 1000.0;
+
+    for (int i = 0; i < frame->NumberOfContacts; i++)
+    {
+        const TouchInfo * contact = &frame->Contacts[i];
+        int index = 0;
+
+        while (index < numberOfOpenContacts && openContacts[index].ContactId != contact->ContactId)
+        {
+            index++;
+        }
+
+        if (index == numberOfOpenContacts)
+        {
+            if (contact->Event == App_UpEvent || numberOfOpenContacts == MAX_OPEN_CONTACTS)
+            {
+                continue;
+            }
+
+            int stroke = FindStroke(time, contact->X, contact->Y);
+            openContacts[numberOfOpenContacts++] = (OpenContact){ contact->ContactId, stroke };
+
+            if (stroke < 0)
+            {
+                ghosts++;
+            }
+            else if (trace.Strokes[stroke].Presses++ == 0)
+            {
+                trace.Strokes[stroke].FirstPress = time;
+            }
+            else
+            {
+                // A second press during one stroke is a click the user did not make.
+                ghosts++;
+            }
+        }
+
+        Stroke * stroke = openContacts[index].Stroke >= 0 ? &trace.Strokes[openContacts[index].Stroke] : NULL;
+
+        if (contact->Event == App_UpEvent)
+        {
+            if (stroke != NULL)
+            {
+                stroke->LastRelease = time;
+            }
+            openContacts[index] = openContacts[--numberOfOpenContacts];
+        }
+        else if (stroke != NULL)
+        {
+            squaredErrorSum += GetTruthDistanceSquared(stroke, time, contact->X, contact->Y);
+            errorSamples++;
+        }
+    }
+}
+
+/*  Finds the finger stroke a press belongs to.
+ *
+ *  @return index of the nearest stroke within MATCH_DISTANCE and MATCH_SLACK, -1 if none.
+*/
+static int FindStroke(double time, uint32_t x, uint32_t y)
+{
+    float nearest = (float)MATCH_DISTANCE * MATCH_DISTANCE;
+    int found = -1;
+
+    for (int i = 0; i < trace.NumberOfStrokes; i++)
+    {
+        const Stroke * stroke = &trace.Strokes[i];
+        double down = trace.Truth.Records[stroke->First].Time;
+        double up = trace.Truth.Records[stroke->Last].Time;
+
+        if (down - MATCH_SLACK > time)
+        {
+            break;
+        }
+
+        if (time > up + MATCH_SLACK)
+        {
+            continue;
+        }
+
+        float distance = GetTruthDistanceSquared(stroke, time, x, y);
+        if (distance <= nearest)
+        {
+            nearest = distance;
+            found = i;
+        }
+    }
+
+    return found;
+}
+
+/*  Gets the squared distance from a position to the finger of a stroke at given time, interpolated between the truth
+ *  samples and limited to the duration of the stroke.
+ *
+ *  @return squared distance in 1/10 mm.
+*/
+static float GetTruthDistanceSquared(const Stroke * stroke, double time, uint32_t x, uint32_t y)
+{
+    const TraceRecord * records = trace.Truth.Records;
+    int low = stroke->First;
+    int high = stroke->Last;
+
+    // Last sample at or before the time.
+    while (low < high)
+    {
+        int middle = (low + high + 1) / 2;
+        if (records[middle].Time <= time)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    float fingerX = records[low].X;
+    float fingerY = records[low].Y;
+
+    if (low < stroke->Last && time > records[low].Time)
+    {
+        float fraction = (float)((time - records[low].Time) / (records[low + 1].Time - records[low].Time));
+        fingerX += (records[low + 1].X - records[low].X) * fraction;
+        fingerY += (records[low + 1].Y - records[low].Y) * fraction;
+    }
+
+    float dx = (float)x - fingerX;
+    float dy = (float)y - fingerY;
+    return dx * dx + dy * dy;
+}
+
+/*  Sums up the scores of the run.  */
+static void ScoreRun(SweepResult * result)
+{
+    double pressLatency = 0, releaseLatency = 0;
+    int pressed = 0, released = 0;
+
+    for (int i = 0; i < trace.NumberOfStrokes; i++)
+    {
+        const Stroke * stroke = &trace.Strokes[i];
+
+        if (stroke->Presses == 0)
+        {
+            continue;
+        }
+
+        pressed++;
+        pressLatency += stroke->FirstPress - trace.Truth.Records[stroke->First].Time;
+
+        if (stroke->LastRelease >= 0)
+        {
+            released++;
+            releaseLatency += stroke->LastRelease - trace.Truth.Records[stroke->Last].Time;
+        }
+    }
+
+    result->PressLatency = pressed > 0 ? (float)(pressLatency / pressed) : 0;
+    result->ReleaseLatency = released > 0 ? (float)(releaseLatency / released) : 0;
+    result->PositionError = errorSamples > 0 ? (float)(sqrt(squaredErrorSum / errorSamples) / 10) : 0;
+    result->GhostRate = (float)ghosts / trace.NumberOfStrokes;
+    result->MissedRate = (float)(trace.NumberOfStrokes - pressed) / trace.NumberOfStrokes;
+    result->IsValid = true;
+}
+
+/*  Gets the value a combination uses for a swept setting. The last setting changes fastest.
+ *
+ *  @return value as given on the command line.
+*/
+static const char * GetPointValue(int point, int parameter)
+{
+    for (int i = numberOfSweepParameters - 1; i > parameter; i--)
+    {
+        point /= sweepParameters[i].NumberOfValues;
+    }
+
+    return sweepParameters[parameter].Values[point % sweepParameters[parameter].NumberOfValues];
+}
+
+/*  ********** Results ********** */
+
+/*  Gets the latency of a click, the press and the release latency added.
+ *
+ *  @return latency in milliseconds.
+*/
+static float GetLatency(const SweepResult * result)
+{
+    return result->PressLatency + result->ReleaseLatency;
+}
+
+/*  Checks if a run is at least as good as another on every score and better on one.
+ *
+ *  @return true if run a dominates run b.
+*/
+static bool Dominates(const SweepResult * a, const SweepResult * b)
+{
+    const float scoresA[] = { GetLatency(a), a->PositionError, a->GhostRate, a->MissedRate };
+    const float scoresB[] = { GetLatency(b), b->PositionError, b->GhostRate, b->MissedRate };
+    bool isBetter = false;
+
+    for (int i = 0; i < (int)(sizeof(scoresA) / sizeof(scoresA[0])); i++)
+    {
+        if (scoresA[i] > scoresB[i])
+        {
+            return false;
+        }
+        isBetter |= scoresA[i] < scoresB[i];
+    }
+
+    return isBetter;
+}
+
+/*  Checks if two runs have the same scores, e.g. because a swept setting has no effect on the trace.
+ *
+ *  @return true if equal.
+*/
+static bool HasEqualScores(const SweepResult * a, const SweepResult * b)
+{
+    return GetLatency(a) == GetLatency(b) && a->PositionError == b->PositionError && a->GhostRate == b->GhostRate &&
+        a->MissedRate == b->MissedRate;
+}
+
+/*  Marks the valid runs that no other run dominates.  */
+static void MarkParetoFront(void)
+{
+    for (int i = 0; i < numberOfPoints; i++)
+    {
+        results[i].IsParetoOptimal = results[i].IsValid;
+
+        for (int j = 0; j < numberOfPoints && results[i].IsParetoOptimal; j++)
+        {
+            results[i].IsParetoOptimal = !(results[j].IsValid && Dominates(&results[j], &results[i]));
+        }
+    }
+}
+
+/*  Checks if a run on the Pareto front is the first of the runs on the front with the same scores.
+ *
+ *  @return true if no earlier run on the front has the same scores.
+*/
+static bool IsFirstOfEqualScores(int point)
+{
+    for (int i = 0; i < point; i++)
+    {
+        if (results[i].IsParetoOptimal && HasEqualScores(&results[i], &results[point]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*  Lists the distinct values of a swept setting over the runs on the Pareto front with the same scores as given run,
+ *  separated by commas.
+*/
+static void GetEquivalentValues(int point, int parameter, char * values, size_t size)
+{
+    size_t length = 0;
+
+    values[0] = 0;
+    for (int i = point; i < numberOfPoints; i++)
+    {
+        if (!results[i].IsParetoOptimal || !HasEqualScores(&results[i], &results[point]))
+        {
+            continue;
+        }
+
+        const char * value = GetPointValue(i, parameter);
+        bool isListed = false;
+        for (int j = point; j < i && !isListed; j++)
+        {
+            isListed = results[j].IsParetoOptimal && HasEqualScores(&results[j], &results[point]) &&
+                strcmp(GetPointValue(j, parameter), value) == 0;
+        }
+
+        if (!isListed && length + strlen(value) + 2 <= size)
+        {
+            length += snprintf(values + length, size - length, "%s%s", length > 0 ? "," : "", value);
+        }
+    }
+}
+
+/*  Writes the swept values and the scores of every valid run as CSV.
+ *
+ *  @return true on success, false on fail.
+*/
+static bool WriteResults(const char * path)
+{
+    FILE * file = fopen(path, "w");
+
+    if (file == NULL)
+    {
+        printf("Error: Unable to write results %s. \n", path);
+        return false;
+    }
+
+    for (int i = 0; i < numberOfSweepParameters; i++)
+    {
+        fprintf(file, "%s,", sweepParameters[i].Name);
+    }
+    fprintf(file, "press_latency_ms,release_latency_ms,position_error_mm,ghost_rate,missed_rate,pareto\n");
+
+    for (int point = 0; point < numberOfPoints; point++)
+    {
+        const SweepResult * result = &results[point];
+
+        if (!result->IsValid)
+        {
+            continue;
+        }
+
+        for (int i = 0; i < numberOfSweepParameters; i++)
+        {
+            fprintf(file, "%s,", GetPointValue(point, i));
+        }
+        fprintf(file, "%.2f,%.2f,%.3f,%.4f,%.4f,%d\n", result->PressLatency, result->ReleaseLatency,
+            result->PositionError, result->GhostRate, result->MissedRate, result->IsParetoOptimal);
+    }
+
+    fclose(file);
+    printf("Scores of every run written to %s. \n", path);
+    return true;
+}
+
+/*  Prints the runs on the Pareto front, from the lowest latency up. Runs with the same scores are printed as one row
+ *  listing the values of each setting they were run with.
+ */
+static void PrintParetoFront(void)
+{
+    int front = 0;
+    int rows = 0;
+    float printed = -INFINITY;
+    char values[MAX_SETTING_STRING_SIZE];
+
+    for (int point = 0; point < numberOfPoints; point++)
+    {
+        front += results[point].IsParetoOptimal;
+        rows += results[point].IsParetoOptimal && IsFirstOfEqualScores(point);
+    }
+
+    printf("\nPareto front, %d of %d runs with %d different scores: \n", front, numberOfPoints, rows);
+    for (int i = 0; i < numberOfSweepParameters; i++)
+    {
+        printf("%*s ", (int)strlen(sweepParameters[i].Name), sweepParameters[i].Name);
+    }
+    printf("latency_ms press_ms release_ms error_mm ghost_rate missed_rate \n");
+
+    // Selection by latency, the front is small.
+    for (int printedCount = 0; printedCount < rows; )
+    {
+        float next = INFINITY;
+
+        for (int point = 0; point < numberOfPoints; point++)
+        {
+            float latency = GetLatency(&results[point]);
+            if (results[point].IsParetoOptimal && latency > printed && latency < next)
+            {
+                next = latency;
+            }
+        }
+
+        if (next == INFINITY)
+        {
+            break;
+        }
+
+        for (int point = 0; point < numberOfPoints; point++)
+        {
+            const SweepResult * result = &results[point];
+
+            if (!result->IsParetoOptimal || GetLatency(result) != next || !IsFirstOfEqualScores(point))
+            {
+                continue;
+            }
+
+            for (int i = 0; i < numberOfSweepParameters; i++)
+            {
+                GetEquivalentValues(point, i, values, sizeof(values));
+                printf("%*s ", (int)strlen(sweepParameters[i].Name), values);
+            }
+            printf("%10.1f %8.1f %10.1f %8.2f %10.4f %11.4f \n", GetLatency(result), result->PressLatency,
+                result->ReleaseLatency, result->PositionError, result->GhostRate, result->MissedRate);
+            printedCount++;
+        }
+
+        printed = next;
+    }
+}
@@ -0,0 +1,162 @@
+#include "AutoTune.h"
+#include "Merger.h"
+#include "Metrics.h"
+#include "Settings.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+
+typedef struct AutoTuneSample
+{
+    uint64_t Time;                  // Monotonic microseconds, see Metrics.h.
+    uint64_t Touches;
+    uint64_t Interference;          // Touches rejected by consensus and faulty state transitions, not by debounce itself.
+    uint64_t DeghostDrops;
+    uint64_t Retouches;
+    uint64_t Timeouts;
+} AutoTuneSample;
+
+static void TakeSample(AutoTuneSample * sample);
+static int32_t Step(int32_t value, int direction, int32_t minimum, int32_t maximum);
+static void StepWindow(int32_t * frames, int32_t * maxTimeout, int direction, int32_t minimum, int32_t maximum);
+
+static AutoTuneSample lastSample;
+static bool isSampled = false;
+
+/*  Adjusts the settings when AUTOTUNE_INTERVAL has passed since the last adjustment. Does nothing when auto-tune is
+ *  off.
+ */
+void AutoTuneUpdate(void)
+{
+    const Settings * settings = GetSettings();
+    AutoTuneSample sample;
+
+    if (!settings->AutoTune)
+    {
+        // Start counting again when it is switched on by a reload.
+        isSampled = false;
+        return;
+    }
+
+    TakeSample(&sample);
+    if (!isSampled)
+    {
+        lastSample = sample;
+        isSampled = true;
+        return;
+    }
+
+    if (sample.Time - lastSample.Time < AUTOTUNE_INTERVAL * 1000ull)
+    {
+        return;
+    }
+
+    uint64_t touches = sample.Touches - lastSample.Touches;
+    if (touches < AUTOTUNE_MIN_TOUCHES)
+    {
+        // Too few to tell interference from noise, keep counting.
+        return;
+    }
+
+    float interferenceRate = (float)(sample.Interference - lastSample.Interference) / touches;
+    float deghostRate = (float)(sample.DeghostDrops - lastSample.DeghostDrops) / touches;
+    uint64_t retouches = sample.Retouches - lastSample.Retouches;
+    uint64_t releases = retouches + sample.Timeouts - lastSample.Timeouts;
+    lastSample = sample;
+
+    int debounceDirection = interferenceRate > AUTOTUNE_DROP_HIGH ? 1 : interferenceRate < AUTOTUNE_DROP_LOW ? -1 : 0;
+    int deghostDirection = interferenceRate > AUTOTUNE_DROP_HIGH ? -1 :
+                           (deghostRate > AUTOTUNE_DROP_HIGH && interferenceRate < AUTOTUNE_DROP_LOW) ? 1 : 0;
+    int upTimeoutDirection = 0;
+
+    if (releases >= AUTOTUNE_MIN_RELEASES)
+    {
+        float retouchRate = (float)retouches / releases;
+        upTimeoutDirection = retouchRate > AUTOTUNE_RETOUCH_HIGH ? 1 : retouchRate < AUTOTUNE_RETOUCH_LOW ? -1 : 0;
+    }
+
+    // Values configured outside the bounds are moved inside them, even without a direction.
+    int32_t debounceFrames = settings->DebounceFrames;
+    int32_t debounceInterval = settings->DebounceInterval;
+    StepWindow(&debounceFrames, &debounceInterval, debounceDirection,
+        settings->AutoTuneDebounceMin, settings->AutoTuneDebounceMax);
+    int32_t upTimeoutFrames = settings->UpTimeoutFrames;
+    int32_t upTimeout = settings->UpTimeout;
+    StepWindow(&upTimeoutFrames, &upTimeout, upTimeoutDirection,
+        settings->AutoTuneUpTimeoutMin, settings->AutoTuneUpTimeoutMax);
+    int32_t deghostSpeedLimit = Step(settings->DeghostSpeedLimit, deghostDirection,
+        settings->AutoTuneDeghostMin, settings->AutoTuneDeghostMax);
+
+    if (debounceFrames == settings->DebounceFrames && debounceInterval == settings->DebounceInterval &&
+        upTimeoutFrames == settings->UpTimeoutFrames && upTimeout == settings->UpTimeout &&
+        deghostSpeedLimit == settings->DeghostSpeedLimit)
+    {
+        return;
+    }
+
+    printf("Auto-tune: debounce window %d -> %d ms, up timeout %d -> %d ms, deghost-speed-limit %d -> %d mm/ms "
+           "(interference %.2f%%, ghosts %.2f%%). \n",
+        GetDebounceInterval(), GetFramePeriods(debounceFrames, debounceInterval),
+        GetUpTimeout(), GetFramePeriods(upTimeoutFrames, upTimeout),
+        settings->DeghostSpeedLimit, deghostSpeedLimit, interferenceRate * 100.0f, deghostRate * 100.0f);
+
+    if (UpdateTunedSettings(debounceFrames, debounceInterval, upTimeoutFrames, upTimeout, deghostSpeedLimit))
+    {
+        MetricsIncrement(MetricsCounterAutoTuneUpdates);
+    }
+}
+
+/*  Reads the counters used for tuning.  */
+static void TakeSample(AutoTuneSample * sample)
+{
+    sample->Time = MetricsGetTimeMicroSeconds();
+    sample->Touches = MetricsGetSensorMessages();
+    sample->Interference = MetricsGetCounter(MetricsCounterConsensusRejects) +
+                           MetricsGetCounter(MetricsCounterStateArbitratorErrors);
+    sample->DeghostDrops = MetricsGetCounter(MetricsCounterDeghostDrops);
+    sample->Retouches = MetricsGetCounter(MetricsCounterUpRetouches);
+    sample->Timeouts = MetricsGetCounter(MetricsCounterTimeouts);
+}
+
+/*  Moves a value by AUTOTUNE_STEP of itself, at least 1, in given direction.
+ *
+ *  @return moved value within minimum and maximum.
+*/
+static int32_t Step(int32_t value, int direction, int32_t minimum, int32_t maximum)
+{
+    int32_t step = MAX((int32_t)(value * AUTOTUNE_STEP), 1);
+
+    return MIN(MAX(value + direction * step, minimum), maximum);
+}
+
+/*  Moves a window in given direction. A fixed window, frames 0, is moved in ms. A frame derived window is moved by
+ *  its frame count, and only when that changes the window in use, so neither the limit in maxTimeout nor an unknown
+ *  frame rate lets the count run away.
+*/
+static void StepWindow(int32_t * frames, int32_t * maxTimeout, int direction, int32_t minimum, int32_t maximum)
+{
+    if (*frames == 0)
+    {
+        *maxTimeout = Step(*maxTimeout, direction, minimum, maximum);
+        return;
+    }
+
+    int32_t window = GetFramePeriods(*frames, *maxTimeout);
+    direction = window < minimum ? 1 : window > maximum ? -1 : direction;
+    if (direction == 0)
+    {
+        return;
+    }
+
+    int32_t tunedFrames = Step(*frames, direction, 1, INT32_MAX);
+    int32_t tunedWindow = GetFramePeriods(tunedFrames, *maxTimeout);
+
+    // Never step out of the bounds, only towards them.
+    if (tunedWindow != window && (tunedWindow >= minimum || direction > 0) && (tunedWindow <= maximum || direction < 0))
+    {
+        *frames = tunedFrames;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+/*  ********** Auto-tune **********
+ *
+ *  Slowly adapts the debounce window, up timeout and deghost speed limit to the installation from the merger counters,
+ *  when the auto-tune setting is on. Every AUTOTUNE_INTERVAL with at least AUTOTUNE_MIN_TOUCHES sensor touches, each
+ *  value is moved by AUTOTUNE_STEP of itself, at least 1, and never outside its auto-tune-*-min and -max settings:
+ *
+ *  - The debounce window grows while many touches are rejected as interference, i.e. by consensus and faulty state
+ *    transitions, and shrinks again while almost none are. Touches removed by debounce are not counted, a wider window
+ *    removes more of them and would widen itself further.
+ *  - deghost-speed-limit tightens with the interference, and loosens while many touches are dropped as ghosts on an
+ *    otherwise quiet installation, which are then more likely fast real fingers.
+ *  - The up timeout grows while many released contacts are touched again before it ends, and shrinks while almost none
+ *    are.
+ *
+ *  The windows are tuned where they are set: by debounce-frames and up-timeout-frames when derived from the sensor
+ *  frame rate, and then only when the window in use changes, otherwise by debounce-interval and up-timeout. The auto-tune-*-min and -max bounds apply to the window in use, see GetUpTimeout and
+ *  GetDebounceInterval in Merger.h.
+ *
+ *  Learned values are published as settings and saved to SETTINGS_TUNED_FILE, see Settings.h. Only the main thread
+ *  calls AutoTuneUpdate.
+ */
+
+#define AUTOTUNE_INTERVAL 60000             // Milliseconds between adjustments.
+#define AUTOTUNE_MIN_TOUCHES 1000           // Sensor touches needed in an interval before adjusting.
+#define AUTOTUNE_MIN_RELEASES 50            // Releases needed in an interval before adjusting the up timeout.
+#define AUTOTUNE_STEP 0.1f                  // Largest change of a value per adjustment, as a fraction of the value.
+#define AUTOTUNE_DROP_HIGH 0.01f            // Fraction of touches dropped above which filtering is made stricter.
+#define AUTOTUNE_DROP_LOW 0.001f            // Fraction of touches dropped below which filtering is relaxed.
+#define AUTOTUNE_RETOUCH_HIGH 0.1f          // Fraction of releases touched again above which the up timeout grows.
+#define AUTOTUNE_RETOUCH_LOW 0.02f          // Fraction of releases touched again below which the up timeout shrinks.
+
+/*  Adjusts the settings when AUTOTUNE_INTERVAL has passed since the last adjustment. Does nothing when auto-tune is
+ *  off.
+ */
+void AutoTuneUpdate(void);
+
+#endif // AUTOTUNE_H
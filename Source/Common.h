@@ -8,13 +8,10 @@
 #include <OsAbstractionLayer.h>
 #include <Queue.h>
 
-#define NUMBER_OF_SENSORS 2                     // Number of sensors connected to the raspberry pi. Example code supports 2 or 4.
-#define SENSOR_ORIENTATION_HORIZONTAL 1         // Which orientation the sensors are mounted on the screen. 0 for vertical (on the sides), 1 for horizontal (top and bottom).
-
-static const int32_t hostScreenWidth = 3000;    // Width of the screen which the raspberry pi will be sending touches to, unit is 1/10 mm.
-static const int32_t hostScreenHeight = 3000;   // Height of the screen which the raspberry pi will be sending touches to, unit is 1/10 mm.
-
-static const bool verbose = false;
+#define MAX_SENSORS 4                           // Most sensors connected to the raspberry pi, the number used is the sensors setting.
+#define MAX_CONTACTS 5                          // Maximum number of simultaneous contacts reported to the host. Must match the digitizer report in neonode_usb.
+#define MAX_USB_PATH_SIZE 32                    // Size of a USB port path like 1-1.2, including the terminating zero.
+#define MAX_TOUCH_BUF_SIZE 32                   // Most touches kept per contact, the number used is the touch-history setting.
 
 typedef enum ApplicationTouchEvent
 {
@@ -41,6 +38,7 @@ typedef struct SensorConfiguration
     uint32_t        TouchActiveAreaWidth;
     uint32_t        TouchActiveAreaHeight;
     char          * McuUniqueIdentifier;
+    char            UsbPath[MAX_USB_PATH_SIZE];     // USB port the sensor is connected to, empty if unknown.
 } SensorConfiguration;
 
 typedef struct TouchInfo
@@ -50,8 +48,15 @@ typedef struct TouchInfo
     ApplicationTouchEvent Event;
     uint64_t              Timestamp;
     SensorConfiguration * SensorConfiguration;
+    uint32_t              ContactId;    // Identifies the contact from its down event until its up event.
 } TouchInfo;
 
+typedef struct TouchFrame
+{
+    int       NumberOfContacts;
+    TouchInfo Contacts[MAX_CONTACTS];   // Contacts touching the screen, and contacts released in this frame with App_UpEvent.
+} TouchFrame;
+
 typedef struct SensorGroupHandler
 {
     zForceThread   * Thread;
@@ -64,6 +69,7 @@ typedef struct IndexedMessage
     SensorConfiguration * SensorConfiguration;
     SensorGroupHandler  * SensorGroupHandler;
     uint64_t              Timestamp;
+    uint64_t              QueuedAt;     // Monotonic time in microseconds when the message was queued, used for latency metrics.
     Message             * Message;
 } IndexedMessage;
 
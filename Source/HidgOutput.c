@@ -0,0 +1,281 @@
+#include "Output.h"
+#include "Metrics.h"
+#include "Settings.h"
+#include "Kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Helper macros.
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+#define HIDG_DEVICE "/dev/hidg0"
+
+// Digitizer report layout, must match the descriptor in Scripts/neonode_usb.
+#define DIGITIZER_REPORT_ID 1
+#define DIGITIZER_CONTACT_SIZE 6    // Tip switch and padding, contact identifier, 16 bit X, 16 bit Y.
+#define DIGITIZER_REPORT_SIZE (1 + MAX_CONTACTS * DIGITIZER_CONTACT_SIZE + 1)
+
+typedef enum HidReportMode
+{
+    HidReportMouse,
+    HidReportDigitizer
+} HidReportMode;
+
+typedef struct HidgOutput
+{
+    int           EmulatedDevice;
+    HidReportMode Mode;
+    bool          HasPrimaryContact;    // Mouse mode follows the first contact until it is released.
+    uint32_t      PrimaryContactId;
+    uint32_t      FactorX;              // Fixed-point scale factors from screen to report coordinates.
+    uint32_t      FactorY;
+    bool          SlotInUse[MAX_CONTACTS];      // Digitizer mode reports the slot of a contact as its identifier.
+    uint32_t      SlotContactId[MAX_CONTACTS];
+} HidgOutput;
+
+static bool HidgOpen(OutputBackend * self);
+static bool HidgSend(OutputBackend * self, const TouchFrame * frame);
+static void HidgClose(OutputBackend * self);
+static size_t BuildMouseReport(HidgOutput * hidg, const TouchFrame * frame, uint8_t * data);
+static size_t BuildDigitizerReport(HidgOutput * hidg, const TouchFrame * frame, uint8_t * data);
+static int FindSlot(HidgOutput * hidg, const TouchInfo * contact);
+static void WriteReportCoordinates(uint16_t x, uint16_t y, uint8_t * data);
+
+/*  Creates the USB gadget backend.
+ *
+ *  @return new backend, NULL if out of memory.
+*/
+OutputBackend * HidgOutputNew(void)
+{
+    OutputBackend * backend = calloc(1, sizeof(OutputBackend) + sizeof(HidgOutput));
+    if (backend == NULL)
+    {
+        return NULL;
+    }
+
+    HidgOutput * hidg = (HidgOutput *)(backend + 1);
+    hidg->EmulatedDevice = -1;
+
+    backend->Name = "hidg";
+    backend->Private = hidg;
+    backend->Open = HidgOpen;
+    backend->Send = HidgSend;
+    backend->SendRaw = NULL;
+    backend->Close = HidgClose;
+
+    return backend;
+}
+
+/*  Opens the emulated device in the report mode given by the hid-report setting.
+ *
+ *  @return true on success, false on fail.
+*/
+static bool HidgOpen(OutputBackend * self)
+{
+    HidgOutput * hidg = (HidgOutput *)self->Private;
+    const char * mode = GetSettings()->HidReport;
+
+    if (strcmp(mode, "mouse") == 0)
+    {
+        hidg->Mode = HidReportMouse;
+    }
+    else if (strcmp(mode, "digitizer") == 0)
+    {
+        hidg->Mode = HidReportDigitizer;
+    }
+    else
+    {
+        printf("Error: Unknown hid-report '%s'. \n", mode);
+        return false;
+    }
+
+    hidg->FactorX = KernelGetReportFactor(GetSettings()->ScreenWidth);
+    hidg->FactorY = KernelGetReportFactor(GetSettings()->ScreenHeight);
+
+    hidg->EmulatedDevice = open(HIDG_DEVICE, O_RDWR | O_NONBLOCK);
+    if (hidg->EmulatedDevice < 0)
+    {
+        printf("Error: Unable to open hidg0 (%s). \n", mode);
+        return false;
+    }
+
+    return true;
+}
+
+/*  Converts the frame to a HID report and sends it to the host.
+ *
+ *  @return false if the device can not be opened, true otherwise.
+*/
+static bool HidgSend(OutputBackend * self, const TouchFrame * frame)
+{
+    HidgOutput * hidg = (HidgOutput *)self->Private;
+
+    if(hidg->EmulatedDevice < 0)
+    {
+        if (!HidgOpen(self))
+        {
+            return false;
+        }
+    }
+
+    uint8_t data[DIGITIZER_REPORT_SIZE] = {0};
+    size_t size = hidg->Mode == HidReportDigitizer ? BuildDigitizerReport(hidg, frame, data) : BuildMouseReport(hidg, frame, data);
+    if (size == 0)
+    {
+        return true;
+    }
+
+    ssize_t written = write(hidg->EmulatedDevice, data, size);
+
+    if(written < 0)
+    {
+        MetricsIncrement(errno == EAGAIN ? MetricsCounterHidWriteAgain : MetricsCounterHidWriteFailures);
+        perror("Error: Writing to hidg0");
+    }
+    else
+    {
+        MetricsIncrement(MetricsCounterTouchesSent);
+    }
+
+    return true;
+}
+
+/*  Builds a 5 byte absolute mouse report for the primary contact, other contacts are ignored.
+ *
+ *  @return report size, 0 if there is nothing to send.
+*/
+static size_t BuildMouseReport(HidgOutput * hidg, const TouchFrame * frame, uint8_t * data)
+{
+    const TouchInfo * contact = NULL;
+
+    for (int i = 0; i < frame->NumberOfContacts; i++)
+    {
+        const TouchInfo * candidate = &frame->Contacts[i];
+        if (hidg->HasPrimaryContact ? candidate->ContactId == hidg->PrimaryContactId : candidate->Event != App_UpEvent)
+        {
+            contact = candidate;
+            break;
+        }
+    }
+
+    if (contact == NULL)
+    {
+        return 0;
+    }
+
+    hidg->HasPrimaryContact = contact->Event != App_UpEvent;
+    hidg->PrimaryContactId = contact->ContactId;
+
+    switch(contact->Event)
+    {
+        case App_DownEvent: data[0] = 1; break;     // button press
+        case App_MoveEvent: data[0] = 1; break;     // button press
+        default: data[0] = 0;                   // button release
+    }
+    WriteReportCoordinates(KernelScaleToReport(contact->X, hidg->FactorX), KernelScaleToReport(contact->Y, hidg->FactorY), &data[1]);
+
+    return 5;
+}
+
+/*  Builds a multi-touch digitizer report with all contacts in the frame. Released contacts are reported once with the
+ *  tip switch cleared, unused contact entries are left zeroed. The contact identifier is the slot of the contact, so it
+ *  fits the 7 bits of the report and is unique among the live contacts whatever their contact ids are.
+ *
+ *  @return report size, 0 if there is nothing to send.
+*/
+static size_t BuildDigitizerReport(HidgOutput * hidg, const TouchFrame * frame, uint8_t * data)
+{
+    int count = MIN(frame->NumberOfContacts, MAX_CONTACTS);
+    uint32_t x[MAX_CONTACTS];
+    uint32_t y[MAX_CONTACTS];
+    uint16_t scaledX[MAX_CONTACTS];
+    uint16_t scaledY[MAX_CONTACTS];
+
+    for (int i = 0; i < count; i++)
+    {
+        x[i] = frame->Contacts[i].X;
+        y[i] = frame->Contacts[i].Y;
+    }
+    KernelScaleToReportBatch(x, scaledX, count, hidg->FactorX);
+    KernelScaleToReportBatch(y, scaledY, count, hidg->FactorY);
+
+    int numberOfEntries = 0;
+
+    data[0] = DIGITIZER_REPORT_ID;
+    for (int i = 0; i < count; i++)
+    {
+        const TouchInfo * contact = &frame->Contacts[i];
+        bool isDown = contact->Event != App_UpEvent;
+        int slot = FindSlot(hidg, contact);
+
+        if (slot < 0 || (!isDown && !hidg->SlotInUse[slot]))
+        {
+            continue;
+        }
+
+        hidg->SlotInUse[slot] = isDown;
+        hidg->SlotContactId[slot] = contact->ContactId;
+
+        uint8_t * entry = &data[1 + numberOfEntries++ * DIGITIZER_CONTACT_SIZE];
+
+        entry[0] = isDown ? 1 : 0;  // Tip switch.
+        entry[1] = slot;
+        WriteReportCoordinates(scaledX[i], scaledY[i], &entry[2]);
+    }
+
+    if (numberOfEntries == 0)
+    {
+        return 0;
+    }
+    data[DIGITIZER_REPORT_SIZE - 1] = numberOfEntries;
+
+    return DIGITIZER_REPORT_SIZE;
+}
+
+/*  Finds the slot of a contact, or a free slot for a new contact.
+ *
+ *  @return slot index, -1 if all slots are in use.
+*/
+static int FindSlot(HidgOutput * hidg, const TouchInfo * contact)
+{
+    int freeSlot = -1;
+
+    for (int slot = 0; slot < MAX_CONTACTS; slot++)
+    {
+        if (hidg->SlotInUse[slot] && hidg->SlotContactId[slot] == contact->ContactId)
+        {
+            return slot;
+        }
+        if (!hidg->SlotInUse[slot] && freeSlot < 0)
+        {
+            freeSlot = slot;
+        }
+    }
+
+    return freeSlot;
+}
+
+/*  Writes report coordinates as 16 bit little endian X and Y.  */
+static void WriteReportCoordinates(uint16_t x, uint16_t y, uint8_t * data)
+{
+    data[0] = x & 0xFF;
+    data[1] = x >> 8;
+    data[2] = y & 0xFF;
+    data[3] = y >> 8;
+}
+
+/*  Closes the emulated device.  */
+static void HidgClose(OutputBackend * self)
+{
+    HidgOutput * hidg = (HidgOutput *)self->Private;
+
+    if (hidg->EmulatedDevice >= 0)
+    {
+        close(hidg->EmulatedDevice);
+    }
+    free(self);
+}
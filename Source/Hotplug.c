@@ -0,0 +1,151 @@
+#include "Hotplug.h"
+#include "Utility.h"
+#include "Settings.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <libudev.h>
+#include <zForce.h>
+
+static void HotplugThread(void * parameters);
+static void HandleDevice(struct udev_device * device);
+
+static struct udev         * udev = NULL;
+static struct udev_monitor * monitor = NULL;
+static zForceThread        * hotplugThread = NULL;
+static volatile bool         hotplugShutDownNow = false;
+static HotplugCallback       hotplugCallback = NULL;
+static uint16_t              hotplugVendorId = 0;
+static uint16_t              hotplugProductId = 0;
+
+/*  Starts watching for HID devices with given vendor and product id.
+ *
+ *  @return true on success, false if udev is not available.
+*/
+bool HotplugStart(uint16_t vendorId, uint16_t productId, HotplugCallback callback)
+{
+    zForce * zForceInstance = zForce_GetInstance();
+
+    if (zForceInstance == NULL)
+    {
+        return false;
+    }
+
+    udev = udev_new();
+    monitor = udev != NULL ? udev_monitor_new_from_netlink(udev, "udev") : NULL;
+    if (monitor == NULL ||
+        udev_monitor_filter_add_match_subsystem_devtype(monitor, "hidraw", NULL) < 0 ||
+        udev_monitor_enable_receiving(monitor) < 0)
+    {
+        printf("Error: Unable to monitor udev. \n");
+        HotplugStop();
+        return false;
+    }
+
+    hotplugCallback = callback;
+    hotplugVendorId = vendorId;
+    hotplugProductId = productId;
+    hotplugShutDownNow = false;
+
+    if (!zForceInstance->OsAbstractionLayer.CreateThread(&hotplugThread, HotplugThread, NULL))
+    {
+        printf("Error: Unable to create hotplug thread. \n");
+        HotplugStop();
+        return false;
+    }
+
+    return true;
+}
+
+/*  Stops watching. The thread is not joined since WaitForThreadExit may block forever, it releases the monitor itself
+ *  within HOTPLUG_POLL_INTERVAL.
+*/
+void HotplugStop(void)
+{
+    if (hotplugThread != NULL)
+    {
+        hotplugShutDownNow = true;
+        hotplugThread = NULL;
+        return;
+    }
+
+    if (monitor != NULL)
+    {
+        udev_monitor_unref(monitor);
+        monitor = NULL;
+    }
+    if (udev != NULL)
+    {
+        udev_unref(udev);
+        udev = NULL;
+    }
+}
+
+/*  Receives the udev events and reports the sensors.  */
+static void HotplugThread(void * parameters)
+{
+    (void)parameters;
+
+    while (!hotplugShutDownNow)
+    {
+        // HandleDevice reports to the application, which reads the settings.
+        SettingsQuiescentState();
+
+        struct pollfd pollDescriptor = { .fd = udev_monitor_get_fd(monitor), .events = POLLIN };
+        int result = poll(&pollDescriptor, 1, HOTPLUG_POLL_INTERVAL);
+
+        if (result > 0 && (pollDescriptor.revents & POLLIN))
+        {
+            struct udev_device * device = udev_monitor_receive_device(monitor);
+            if (device != NULL)
+            {
+                HandleDevice(device);
+                udev_device_unref(device);
+            }
+        }
+        else if (result < 0 && errno != EINTR)
+        {
+            perror("Error: Polling udev");
+            break;
+        }
+    }
+
+    udev_monitor_unref(monitor);
+    monitor = NULL;
+    udev_unref(udev);
+    udev = NULL;
+
+    SettingsThreadExit();
+}
+
+/*  Reports an added sensor or a removed HID device to the callback.  */
+static void HandleDevice(struct udev_device * device)
+{
+    const char * action = udev_device_get_action(device);
+    const char * devicePath = udev_device_get_devpath(device);
+    char usbPath[MAX_USB_PATH_SIZE];
+
+    if (action == NULL || devicePath == NULL || !GetUsbPortFromDevicePath(devicePath, usbPath, sizeof(usbPath)))
+    {
+        return;
+    }
+
+    if (strcmp(action, "remove") == 0)
+    {
+        // The device is gone from sysfs, so its ids can not be read. The callback matches the port instead.
+        hotplugCallback(HotplugEventRemove, usbPath);
+    }
+    else if (strcmp(action, "add") == 0)
+    {
+        struct udev_device * hid = udev_device_get_parent_with_subsystem_devtype(device, "hid", NULL);
+        const char * hidId = hid != NULL ? udev_device_get_property_value(hid, "HID_ID") : NULL;
+        unsigned int bus, vendor, product;
+
+        if (hidId != NULL && sscanf(hidId, "%x:%x:%x", &bus, &vendor, &product) == 3 &&
+            vendor == hotplugVendorId && product == hotplugProductId)
+        {
+            hotplugCallback(HotplugEventAdd, usbPath);
+        }
+    }
+}
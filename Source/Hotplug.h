@@ -0,0 +1,35 @@
+#ifndef HOTPLUG_H
+#define HOTPLUG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*  ********** Hotplug **********
+ *
+ *  Watches udev for sensors being plugged in and unplugged, so a sensor is brought up again as soon as it is back
+ *  instead of on the next retry, and an unplugged sensor is noticed even when zForceSDK does not report the
+ *  disconnect. Events are reported with the USB port path, e.g. 1-1.2, see GetUsbPortPath.
+ *
+ *  The callback runs on the hotplug thread and must not block.
+ */
+
+#define HOTPLUG_POLL_INTERVAL 1000      // Milliseconds between checks for a shutdown while no events arrive.
+
+typedef enum HotplugEvent
+{
+    HotplugEventAdd = 0,            //!< A sensor with the vendor and product id was plugged in.
+    HotplugEventRemove              //!< A HID device was unplugged, the vendor and product id are no longer known.
+} HotplugEvent;
+
+typedef void (* HotplugCallback)(HotplugEvent event, const char * usbPath);
+
+/*  Starts watching for HID devices with given vendor and product id.
+ *
+ *  @return true on success, false if udev is not available.
+*/
+bool HotplugStart(uint16_t vendorId, uint16_t productId, HotplugCallback callback);
+
+/*  Stops watching. The thread is not joined, it exits within HOTPLUG_POLL_INTERVAL.  */
+void HotplugStop(void);
+
+#endif // HOTPLUG_H
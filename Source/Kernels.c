@@ -0,0 +1,81 @@
+#include "Kernels.h"
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/*  Calculates the squared distance between two points.
+ *
+ *  @return squared distance in (1/10 mm)^2.
+*/
+uint64_t KernelDistanceSquared(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+    int64_t dx = (int64_t)x1 - x0;
+    int64_t dy = (int64_t)y1 - y0;
+
+    return (uint64_t)(dx * dx) + (uint64_t)(dy * dy);
+}
+
+/*  Checks if a movement of dx, dy in 1/10 mm during given milliseconds is faster than limit mm per ms, by comparing
+ *  squares instead of taking a square root.
+ *
+ *  @return true if faster.
+*/
+bool KernelIsFasterThan(int32_t dx, int32_t dy, uint32_t milliseconds, uint32_t limit)
+{
+    // (distance / 10) / milliseconds > limit  <=>  distance^2 > (10 * limit * milliseconds)^2
+    uint64_t distanceSquared = (uint64_t)((int64_t)dx * dx) + (uint64_t)((int64_t)dy * dy);
+    uint64_t maxDistance = (uint64_t)10 * limit * milliseconds;
+
+    return distanceSquared > maxDistance * maxDistance;
+}
+
+/*  Gets the Q16 fixed-point factor that scales coordinates in the range 0 to range to 0 to KERNEL_REPORT_MAX.
+ *
+ *  @return factor for KernelScaleToReport.
+*/
+uint32_t KernelGetReportFactor(uint32_t range)
+{
+    if (range == 0)
+    {
+        return 0;
+    }
+
+    // Round up so range itself maps to KERNEL_REPORT_MAX.
+    return (uint32_t)((((uint64_t)KERNEL_REPORT_MAX << 16) + range - 1) / range);
+}
+
+/*  Scales a coordinate with a factor from KernelGetReportFactor, saturating at KERNEL_REPORT_MAX.
+ *
+ *  @return logical report coordinate.
+*/
+uint16_t KernelScaleToReport(uint32_t value, uint32_t factor)
+{
+    uint64_t scaled = ((uint64_t)value * factor) >> 16;
+
+    return scaled > KERNEL_REPORT_MAX ? KERNEL_REPORT_MAX : (uint16_t)scaled;
+}
+
+/*  Scales count coordinates with a factor from KernelGetReportFactor, saturating at KERNEL_REPORT_MAX.  */
+void KernelScaleToReportBatch(const uint32_t * values, uint16_t * scaled, int count, uint32_t factor)
+{
+    int i = 0;
+
+#if defined(__ARM_NEON)
+    const uint32x2_t factors = vdup_n_u32(factor);
+    const uint32x4_t maximum = vdupq_n_u32(KERNEL_REPORT_MAX);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32x4_t input = vld1q_u32(&values[i]);
+        uint64x2_t low = vmull_u32(vget_low_u32(input), factors);
+        uint64x2_t high = vmull_u32(vget_high_u32(input), factors);
+        uint32x4_t result = vcombine_u32(vqshrn_n_u64(low, 16), vqshrn_n_u64(high, 16));
+        vst1_u16(&scaled[i], vmovn_u32(vminq_u32(result, maximum)));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        scaled[i] = KernelScaleToReport(values[i], factor);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*  ********** Math kernels **********
+ *
+ *  Integer and fixed-point versions of the distance and scaling math on the touch path. The default ARMv6+VFPv2
+ *  target has slow double precision and no integer divide instruction, so these avoid doubles, square roots and
+ *  divides per touch. Coordinates are in 1/10 mm and at most INT16_MAX.
+ *
+ *  The batch version processes several contacts per call and uses NEON where the compiler targets it (__ARM_NEON,
+ *  e.g. ARMv7 with -mfpu=neon or AArch64), with a scalar fallback elsewhere. Benchmark/KernelBenchmark.c compares
+ *  them against the floating point code they replace, run it with make benchmark.
+ */
+
+#define KERNEL_REPORT_MAX 32767     // Largest logical coordinate of the HID reports.
+
+/*  Calculates the squared distance between two points.
+ *
+ *  @return squared distance in (1/10 mm)^2.
+*/
+uint64_t KernelDistanceSquared(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+
+/*  Checks if a movement of dx, dy in 1/10 mm during given milliseconds is faster than limit mm per ms, by comparing
+ *  squares instead of taking a square root.
+ *
+ *  @return true if faster.
+*/
+bool KernelIsFasterThan(int32_t dx, int32_t dy, uint32_t milliseconds, uint32_t limit);
+
+/*  Gets the Q16 fixed-point factor that scales coordinates in the range 0 to range to 0 to KERNEL_REPORT_MAX.
+ *
+ *  @return factor for KernelScaleToReport.
+*/
+uint32_t KernelGetReportFactor(uint32_t range);
+
+/*  Scales a coordinate with a factor from KernelGetReportFactor, saturating at KERNEL_REPORT_MAX.
+ *
+ *  @return logical report coordinate.
+*/
+uint16_t KernelScaleToReport(uint32_t value, uint32_t factor);
+
+/*  Scales count coordinates with a factor from KernelGetReportFactor, saturating at KERNEL_REPORT_MAX.  */
+void KernelScaleToReportBatch(const uint32_t * values, uint16_t * scaled, int count, uint32_t factor);
+
+#endif // KERNELS_H
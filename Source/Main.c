@@ -33,6 +33,13 @@
 #include "ErrorString.h"
 #include "DumpMessage.h"
 #include "Merger.h"
+#include "Metrics.h"
+#include "Output.h"
+#include "Settings.h"
+#include "ReportScheduler.h"
+#include "SensorBringUp.h"
+#include "Hotplug.h"
+#include "AutoTune.h"
 
 // Helper macros.
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
@@ -40,7 +47,9 @@
 
 #define HIDDEVICEVID "0x1536"     // Vendor ID of Device.
 #define HIDDEVICEPID "0x0101"     // Product ID of Device.
-#define QUEUE_TIMEOUT 1000
+#define SENSOR_RETRY_INTERVAL 2000  // Milliseconds between bring-up attempts of a sensor that failed or disconnected, unless it is plugged in before.
+#define SENSOR_POLL_INTERVAL 100    // Longest wait for sensor messages before checking if the sensor was unplugged.
+#define HOTPLUG_WAIT_SLICE 10       // Milliseconds between checks for a sensor being plugged in.
 
 typedef struct Digitizer
 {
@@ -49,20 +58,57 @@ typedef struct Digitizer
     PlatformDevice      * Platform;
     SensorDevice        * Sensor;
     zForceThread        * Thread;
-    bool                  IsConnected;
+    bool                  IsConnected;  // Set by the sensor thread, cleared when the sensor fails or disconnects.
     volatile bool         ShutDownNow;
     SensorConfiguration * SensorConfiguration;
     SensorGroupHandler  * SensorGroupHandler;
+    BringUp               BringUp;
+    bool                  IsCached;     // Configuration taken from sensor_positions.csv, verified when the responses arrive.
+    bool                  IsMerged;     // Touches are merged, only used by the sensor group thread.
+    SensorPosition        MergedPosition;
+    bool                  IsUnplugged;      // Set by the hotplug callback when the USB port of the sensor is removed.
+    bool                  HasBeenEnabled;
+    bool                  IsRejoining;      // Brought up again after having been enabled, see ChooseDeviceIndex.
+    int                   ProbeIndex;       // Next index to look for a rejoining sensor on when it is not on its USB port.
+    Message             * PendingEnable;    // Enable response held back until the rejoining sensor is identified.
+    uint64_t              ReconnectStart;   // Monotonic time in microseconds the sensor was found plugged in again.
 } Digitizer;
 
 static void SignalHandler(int sig);
+static void ReloadSignalHandler(int sig);
 static void Destroy(void);
 static void ShutDownNow(const char * error);
 static void SensorThread(void * parameters);
+static void RunSensor(Digitizer * digitizer);
+static void CloseSensor(Digitizer * digitizer);
+static void WaitForSensor(Digitizer * digitizer, uint32_t hotplugAddsBefore);
+static int ChooseDeviceIndex(Digitizer * digitizer);
+static bool IsUsbPortUsed(const Digitizer * digitizer, const char * usbPath);
+static bool VerifyRejoiningSensor(Digitizer * digitizer, McuUniqueIdentifierMessage * mcuUniqueIdentifierMessage);
+static void EnableSensor(Digitizer * digitizer, Message * message);
+static void HandleHotplug(HotplugEvent event, const char * usbPath);
+static bool SendBringUpRequest(Digitizer * digitizer, BringUpStep step);
+static BringUpStep GetBringUpStep(MessageType messageType);
+static void HandleMcuUniqueIdentifier(Digitizer * digitizer, McuUniqueIdentifierMessage * mcuUniqueIdentifierMessage);
+static void HandleTouchActiveArea(Digitizer * digitizer, TouchActiveAreaMessage * touchActiveAreaMessage);
+static char * NewMcuUniqueIdentifierString(McuUniqueIdentifierMessage * mcuUniqueIdentifierMessage);
+static void SetMcuUniqueIdentifier(SensorConfiguration * sensorConfiguration, char * identifier);
+static bool UseCachedConfiguration(Digitizer * digitizer);
+static void VerifyCachedMcuUniqueIdentifier(SensorConfiguration * sensorConfiguration, McuUniqueIdentifierMessage * mcuUniqueIdentifierMessage);
+static void VerifyCachedTouchActiveArea(SensorConfiguration * sensorConfiguration, TouchActiveAreaMessage * touchActiveAreaMessage);
+static SensorConfiguration * FindPersistentConfiguration(const char * usbPath);
+static const char * FindCachedUsbPath(const char * identifier, const char * exceptUsbPath);
+static void AssignSensorPorts(void);
+static void UsePortPosition(Digitizer * digitizer);
+static bool IsOnMappedPort(const Digitizer * digitizer);
 static void SensorGroupThread(void * parameters);
-static void SendToHostAsAbsoluteMouse(TouchInfo * info);
+static void UpdateSensorAvailability(void);
+static void MergeSensor(Digitizer * digitizer);
+static void RemoveSensor(Digitizer * digitizer);
+static Digitizer * FindDigitizer(const SensorConfiguration * sensorConfiguration);
 
 static void PrintTouchInfo(TouchInfo * info, int mode);
+static void PrintTouchFrame(const TouchFrame * frame);
 static void ProcessMessage(IndexedMessage * indexedMessage);
 static void EnqueueMessage(Queue * queue, Message * message, SensorConfiguration * sensorConfiguration, uint64_t timestamp);
 static void EnqueueIndexedMessage(Queue * queue, IndexedMessage * indexedMessage);
@@ -70,20 +116,29 @@ static void EnqueueIndexedMessage(Queue * queue, IndexedMessage * indexedMessage
 // Local (static) Variables
 static zForce             * zForceInstance;
 static bool                 zForceInitialized = false;
-static Digitizer            digitizers[NUMBER_OF_SENSORS] = { 0 };
+static Digitizer            digitizers[MAX_SENSORS] = { 0 };
 static Queue              * mainMessageQueue;
 static SensorGroupHandler   groupHandler = { 0 };
-static SensorConfiguration  persistentPositions[NUMBER_OF_SENSORS] = { 0 };
-static int                  emulatedDevice = -1;
+static SensorConfiguration  persistentPositions[MAX_SENSORS] = { 0 };
 static bool                 sensorPositionsFileExists = false;
+static bool                 isPortMappingVerified = false;  // A sensor answered with the identifier cached for its USB port, see VerifyCachedMcuUniqueIdentifier.
+static bool                 isPositionsFileStale = false;   // Changes to persistentPositions wait for the port mapping to be verified.
+static uint32_t             hotplugAdds = 0;    // Sensors plugged in since start, see HandleHotplug.
+static volatile sig_atomic_t reloadSettingsNow = 0;
 
 // Global error shutdown flag
 bool volatile shutDownNow = false;
 
-int main (void)
+int main (int argc, char * argv[])
 {
     printf("Version: %d.%d.%d \n", MAJOR_VERSION, MINOR_VERSION, PATCH_VERSION);
 
+    if (!ParseSettingsArguments(argc, argv))
+    {
+        PrintSettingsUsage(argv[0]);
+        return -1;
+    }
+
     const bool resultCode = zForce_Initialize(NULL);
 
     if (resultCode)
@@ -97,11 +152,41 @@ int main (void)
 
     // Install the Control-C handler.
     signal(SIGINT, SignalHandler);
+    signal(SIGHUP, ReloadSignalHandler);
+
+    // Metrics are only used for monitoring, the application keeps running without them.
+    if (!MetricsStart(METRICS_SOCKET_PATH))
+    {
+        printf("Warning: Unable to start metrics on %s. \n", METRICS_SOCKET_PATH);
+    }
+
+    ReportSchedulerSetRate(GetSettings()->ReportRate);
+
+    // Without hotplug events a sensor that was unplugged is brought up again on the next retry.
+    if (!HotplugStart(strtol(HIDDEVICEVID, NULL, 16), strtol(HIDDEVICEPID, NULL, 16), HandleHotplug))
+    {
+        printf("Warning: Unable to watch for sensors being plugged in, retrying every %d ms instead. \n", SENSOR_RETRY_INTERVAL);
+    }
+
+    // Open the outputs before any thread can produce touches for them.
+    if (!OutputOpen(GetSettings()->Outputs))
+    {
+        ShutDownNow("Error: Unable to open outputs. \n");
+    }
 
     zForceInstance = zForce_GetInstance();
 
     sensorPositionsFileExists = ReadSensorPositionsFile(persistentPositions);
 
+    // Lay out the sensors with their cached sizes, so the others work as usual if one is missing from the start.
+    for (int i = 0; sensorPositionsFileExists && i < GetSettings()->Sensors; i++)
+    {
+        if (persistentPositions[i].TouchActiveAreaWidth != 0 && persistentPositions[i].TouchActiveAreaHeight != 0)
+        {
+            AddSensorLayout(persistentPositions[i]);
+        }
+    }
+
     mainMessageQueue = Queue_New();
     groupHandler.SensorGroupQueue = Queue_New();
 
@@ -110,58 +195,161 @@ int main (void)
         ShutDownNow("Error: Unable to create thread. \n");
     }
 
-    for (int sensorIndex = 0; sensorIndex < NUMBER_OF_SENSORS; sensorIndex++)
+    for (int sensorIndex = 0; sensorIndex < GetSettings()->Sensors; sensorIndex++)
     {
         Digitizer * digitizer = &digitizers[sensorIndex];
-        SensorConfiguration * config = (SensorConfiguration *)zForceInstance->OsAbstractionLayer.Malloc(sizeof(SensorConfiguration));
+        SensorConfiguration * config = (SensorConfiguration *)zForceInstance->OsAbstractionLayer.MallocWithPattern(sizeof(SensorConfiguration), 0);
         digitizer->SensorConfiguration = config;
         digitizer->SensorIndex = sensorIndex;
         digitizer->SensorConfiguration->SensorPosition = sensorIndex;
         digitizer->SensorGroupHandler = &groupHandler;
+    }
+
+    AssignSensorPorts();
+
+    for (int sensorIndex = 0; sensorIndex < GetSettings()->Sensors; sensorIndex++)
+    {
+        Digitizer * digitizer = &digitizers[sensorIndex];
         if (!zForceInstance->OsAbstractionLayer.CreateThread(&digitizer->Thread, SensorThread, digitizer))
         {
             ShutDownNow("Error: Unable to create thread. \n");
         }
     }
 
-    // Initialize the emulated absolute mouse.
-    emulatedDevice = open("/dev/hidg0", O_RDWR | O_NONBLOCK);
-    if(emulatedDevice < 0)
-    {
-        ShutDownNow("Error: Unable to open hidg0 (absolute mouse). \n");
-    }
-
     for (;;)
     {
+        SettingsQuiescentState();
+
         // If the global shutdown variable is set, close the application.
         if (shutDownNow)
         {
             ShutDownNow("Shutting down due to errors.\n");
         }
         // Picking up messages that are posted to the main queue by the sensor and group threads.
-        IndexedMessage * indexedMessage = mainMessageQueue->Dequeue(mainMessageQueue, QUEUE_TIMEOUT);
+        IndexedMessage * indexedMessage = mainMessageQueue->Dequeue(mainMessageQueue, GetSettings()->QueueTimeout);
         if (NULL != indexedMessage)
         {
+            MetricsQueueDequeued(MetricsQueueMain);
             Message * message = indexedMessage->Message;
             DumpMessage(message);
             message->Destructor(message);
             zForceInstance->OsAbstractionLayer.Free(indexedMessage); // We need to free it as we haven't created an "object" we can call the destructor on.
         }
+
+        // The settings are read here rather than in the signal handler. The other threads see them on their next GetSettings.
+        if (reloadSettingsNow)
+        {
+            reloadSettingsNow = 0;
+            if (ReloadSettings())
+            {
+                MetricsIncrement(MetricsCounterSettingsReloads);
+            }
+        }
+
+        AutoTuneUpdate();
     }
 
     Destroy();
 }
 
-/*  Sets up a sensor and runs the message loop.  */
+/*  Runs a sensor, and brings it up again after SENSOR_RETRY_INTERVAL whenever it fails or disconnects. The other
+ *  sensors keep working meanwhile, see RemoveSensor.
+*/
 static void SensorThread(void *parameters)
 {
     Digitizer * digitizer = (Digitizer *)parameters;
+
+    while (!digitizer->ShutDownNow)
+    {
+        SettingsQuiescentState();
+        RunSensor(digitizer);
+        if (digitizer->ShutDownNow)
+        {
+            break;
+        }
+
+        uint32_t hotplugAddsBefore = __atomic_load_n(&hotplugAdds, __ATOMIC_ACQUIRE);
+
+        // Only a connected sensor drops out, retries while it is not plugged in or can not connect are not counted.
+        if (__atomic_exchange_n(&digitizer->IsConnected, false, __ATOMIC_ACQ_REL))
+        {
+            MetricsIncrement(MetricsCounterSensorDropouts);
+        }
+        CloseSensor(digitizer);
+        printf("Sensor %d: Offline, trying again when plugged in or in %d ms.\n", digitizer->SensorIndex, SENSOR_RETRY_INTERVAL);
+
+        WaitForSensor(digitizer, hotplugAddsBefore);
+    }
+
+    SettingsThreadExit();
+}
+
+/*  Waits until a sensor is plugged in, or at most SENSOR_RETRY_INTERVAL.  */
+static void WaitForSensor(Digitizer * digitizer, uint32_t hotplugAddsBefore)
+{
+    for (int waited = 0; waited < SENSOR_RETRY_INTERVAL && !digitizer->ShutDownNow; waited += HOTPLUG_WAIT_SLICE)
+    {
+        if (__atomic_load_n(&hotplugAdds, __ATOMIC_ACQUIRE) != hotplugAddsBefore)
+        {
+            break;
+        }
+        zForceInstance->OsAbstractionLayer.Sleep(HOTPLUG_WAIT_SLICE);
+    }
+
+    digitizer->ReconnectStart = MetricsGetTimeMicroSeconds();
+}
+
+/*  Sets up a sensor and runs the message loop until the sensor fails or disconnects.  */
+static void RunSensor(Digitizer * digitizer)
+{
+    BringUp * bringUp = &digitizer->BringUp;
     const char * connectionStringBase = "hidpipe://vid="HIDDEVICEVID",pid="HIDDEVICEPID",index=%d";
 
-    const size_t connectionStringMaxLength = strlen(connectionStringBase) + 3;
-    char * connectionString = (char *)zForceInstance->OsAbstractionLayer.MallocWithPattern(connectionStringMaxLength, 0); // Allows up to 99 devices.
+    BringUpStart(bringUp, digitizer->SensorIndex, MetricsGetTimeMicroSeconds());
+    digitizer->IsRejoining = digitizer->HasBeenEnabled;
+    __atomic_store_n(&digitizer->IsUnplugged, false, __ATOMIC_RELEASE);
+
+    int deviceIndex = ChooseDeviceIndex(digitizer);
+    if (deviceIndex < 0)
+    {
+        printf("Sensor %d: Not plugged in.\n", digitizer->SensorIndex);
+        return;
+    }
+
+    char assignedUsbPath[MAX_USB_PATH_SIZE];
+    strcpy(assignedUsbPath, digitizer->SensorConfiguration->UsbPath);
 
-    snprintf(connectionString, connectionStringMaxLength - 1, connectionStringBase, digitizer->SensorConfiguration->SensorPosition);
+    if (!GetUsbPortPath(strtol(HIDDEVICEVID, NULL, 16), strtol(HIDDEVICEPID, NULL, 16), deviceIndex,
+                        digitizer->SensorConfiguration->UsbPath, MAX_USB_PATH_SIZE))
+    {
+        printf("Sensor %d: USB port unknown, not using the cached configuration.\n", digitizer->SensorIndex);
+        digitizer->SensorConfiguration->UsbPath[0] = 0;
+    }
+    else if (!digitizer->IsRejoining)
+    {
+        // Not on the port it was assigned at start, so the position of the port it is on applies.
+        if (strcmp(assignedUsbPath, digitizer->SensorConfiguration->UsbPath) != 0)
+        {
+            UsePortPosition(digitizer);
+        }
+
+        digitizer->IsCached = false;
+        if (UseCachedConfiguration(digitizer))
+        {
+            BringUpUseCachedConfiguration(bringUp);
+        }
+    }
+
+    // The configuration of a rejoining sensor is known, so it is enabled right away and identified on the way.
+    if (digitizer->IsRejoining)
+    {
+        BringUpUseCachedConfiguration(bringUp);
+    }
+
+    const size_t connectionStringMaxLength = strlen(connectionStringBase) + 11;
+    char * connectionString = (char *)zForceInstance->OsAbstractionLayer.MallocWithPattern(connectionStringMaxLength, 0); // Allows any device index.
+
+    snprintf(connectionString, connectionStringMaxLength - 1, connectionStringBase, deviceIndex);
     digitizer->Connection = Connection_New (
         connectionString, // Transport
         "asn1://",        // Protocol
@@ -173,14 +361,15 @@ static void SensorThread(void *parameters)
             digitizer->SensorIndex,
             zForceErrno,
             ErrorString(zForceErrno));
-        shutDownNow = true;
         return;
     }
     free (connectionString);
     printf("Sensor %d: Connection created.\n", digitizer->SensorIndex);
 
     printf("Sensor %d: Connecting to Device.\n", digitizer->SensorIndex);
-   
+
+    // The connection has no dependencies, so it is always the first step.
+    BringUpGetNextRequest(bringUp, MetricsGetTimeMicroSeconds());
     const bool connectionAttemptResult = digitizer->Connection->Connect(digitizer->Connection);
 
     if (!connectionAttemptResult)
@@ -189,21 +378,32 @@ static void SensorThread(void *parameters)
             digitizer->SensorIndex,
             zForceErrno,
             ErrorString(zForceErrno));
-        shutDownNow = true;
         return;
     }
 
-    // Wait for Connection response to arrive within 1000 seconds.
-    ConnectionMessage * connectionMessage =
-        digitizer->Connection->ConnectionQueue->Dequeue(digitizer->Connection->ConnectionQueue, 1000000);
+    // Wait for the connection response in short slices, so a shutdown or the connect timeout is noticed.
+    ConnectionMessage * connectionMessage = NULL;
+    while (NULL == connectionMessage && !digitizer->ShutDownNow)
+    {
+        SettingsQuiescentState();
+        uint64_t now = MetricsGetTimeMicroSeconds();
+        if (BringUpGetFailedStep(bringUp, now) == BringUpStepConnect)
+        {
+            break;
+        }
+        connectionMessage = digitizer->Connection->ConnectionQueue->Dequeue(digitizer->Connection->ConnectionQueue,
+            BringUpGetTimeoutInMs(bringUp, now, GetSettings()->QueueTimeout));
+    }
 
     if (NULL == connectionMessage)
     {
         printf("Sensor %d: No Connection Message Received.\n", digitizer->SensorIndex);
         printf("   Reason: %s\n", ErrorString(zForceErrno));
-        shutDownNow = true;
         return;
     }
+    BringUpComplete(bringUp, BringUpStepConnect, MetricsGetTimeMicroSeconds());
+    connectionMessage->Destructor(connectionMessage);
+    __atomic_store_n(&digitizer->IsConnected, true, __ATOMIC_RELEASE);
 
     printf("Sensor %d: Devices: %d\n", digitizer->SensorIndex, digitizer->Connection->NumberOfDevices);
     
@@ -212,7 +412,6 @@ static void SensorThread(void *parameters)
     if (NULL == digitizer->Platform)
     {
         printf("Sensor %d: No Platform device found.\n", digitizer->SensorIndex);
-        shutDownNow = true;
         return;
     }
 
@@ -222,185 +421,657 @@ static void SensorThread(void *parameters)
     if (NULL == digitizer->Sensor)
     {
         printf("Sensor %d: No Sensor device found.\n", digitizer->SensorIndex);
-        shutDownNow = true;
         return;
     }
 
-    if (!digitizer->Sensor->SetOperationModes(digitizer->Sensor,
-        DetectionMode | SignalsMode | LedLevelsMode | DetectionHidMode | GesturesMode,
-        DetectionMode))
-    {
-        printf("Sensor %d: SetOperationModes error (%d) %s.\n", digitizer->SensorIndex, zForceErrno, ErrorString(zForceErrno));
-        shutDownNow = true;
-        return;
-    }
-
-    bool operationModeMessageReceived = false;
-    bool enableMessageReceived = false;
-    bool touchActiveAreaMessageReceived = false;
-    bool mcuUniqueIdentifierMessageReceived = false;
-    bool numberOfTrackedObjectsMessageReceived = false;
-
     while (!digitizer->ShutDownNow)
     {
+        SettingsQuiescentState();
+
         // Check if sensor disconnected.
         if (!digitizer->Connection->IsConnected)
         {
             printf("Sensor %d: Connection error (%d) %s.\n", digitizer->SensorIndex, zForceErrno, ErrorString(zForceErrno));
-            shutDownNow = true;
             return;
         }
-        // This is where we run the dequeue-loop, and put the message into the other queue along with the index, unless it's one of those types, and we haven't already processed this message type.
-        Message * message = digitizer->Connection->DeviceQueue->Dequeue(digitizer->Connection->DeviceQueue, QUEUE_TIMEOUT);
-        if (NULL != message)
+
+        if (__atomic_load_n(&digitizer->IsUnplugged, __ATOMIC_ACQUIRE))
         {
-            switch (message->MessageType)
+            printf("Sensor %d: Unplugged from USB port %s.\n", digitizer->SensorIndex, digitizer->SensorConfiguration->UsbPath);
+            return;
+        }
+
+        // Send every bring-up request that is ready, or timed out and should be sent again.
+        uint64_t now = MetricsGetTimeMicroSeconds();
+        for (BringUpStep step = BringUpGetNextRequest(bringUp, now); step != BringUpStepCount; step = BringUpGetNextRequest(bringUp, now))
+        {
+            if (!SendBringUpRequest(digitizer, step))
             {
-                case OperationModesMessageType:
-                    if (!operationModeMessageReceived)
-                    {
-                        operationModeMessageReceived = true;
+                return;
+            }
+        }
 
-                        if (!digitizer->Platform->GetMcuUniqueIdentifier(digitizer->Platform))
-                        {
-                            printf("Sensor %d: GetMcuUniqueIdentifier error (%d) %s.\n", digitizer->SensorIndex, zForceErrno, ErrorString(zForceErrno));
-                            shutDownNow = true;
-                        }
+        BringUpStep failedStep = BringUpGetFailedStep(bringUp, now);
+        if (failedStep != BringUpStepCount)
+        {
+            printf("Sensor %d: No %s response after %d attempts.\n", digitizer->SensorIndex, BringUpGetStepName(failedStep), BRINGUP_STEP_ATTEMPTS);
+            return;
+        }
 
-                        message->Destructor (message);
-                    }
-                    else
-                    {
-                        // This message was received but we have already processed it. Probably the main loop or somewhere else that requested this. Send it to them for handling.
-                        EnqueueMessage(mainMessageQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
-                    }
-                break;
-                case McuUniqueIdentifierMessageType:
-                    if (!mcuUniqueIdentifierMessageReceived)
+        // This is where we run the dequeue-loop, and put the message into the other queue along with the index, unless it's one of those types, and we haven't already processed this message type.
+        Message * message = digitizer->Connection->DeviceQueue->Dequeue(digitizer->Connection->DeviceQueue,
+            BringUpGetTimeoutInMs(bringUp, now, SENSOR_POLL_INTERVAL));
+        if (NULL == message)
+        {
+            continue;
+        }
+
+        BringUpStep step = GetBringUpStep(message->MessageType);
+        if (step != BringUpStepCount && !BringUpComplete(bringUp, step, MetricsGetTimeMicroSeconds()))
+        {
+            // This message was received but we have already processed it. Probably the main loop or somewhere else that requested this. Send it to them for handling.
+            EnqueueMessage(mainMessageQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
+            continue;
+        }
+
+        switch (message->MessageType)
+        {
+            case OperationModesMessageType:
+            case NumberOfTrackedObjectsMessageType:
+                message->Destructor(message);
+            break;
+            case McuUniqueIdentifierMessageType:
+            case TouchActiveAreaMessageType:
+                // The sensor on a mapped port takes the position of the port, the sensor group thread checks its identifier.
+                if (message->MessageType == McuUniqueIdentifierMessageType && digitizer->IsRejoining && IsOnMappedPort(digitizer))
+                {
+                    EnqueueMessage(digitizer->SensorGroupHandler->SensorGroupQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
+                    if (digitizer->PendingEnable != NULL)
                     {
-                        mcuUniqueIdentifierMessageReceived = true;
-
-                        McuUniqueIdentifierMessage * mcuUniqueIdentifierMessage = (McuUniqueIdentifierMessage *)message;
-
-                        digitizer->SensorConfiguration->McuUniqueIdentifier = (char*)zForceInstance->OsAbstractionLayer.MallocWithPattern(mcuUniqueIdentifierMessage->BufferSize * 2 + 1, 0);
-                        char * ptr = digitizer->SensorConfiguration->McuUniqueIdentifier;
-                        for (uint32_t i = 0; i < mcuUniqueIdentifierMessage->BufferSize; i++)
-                        {
-                            ptr += sprintf(ptr, "%02X", mcuUniqueIdentifierMessage->McuUniqueIdentifier[i]); 
-                        }
-
-                        // Check if sensor positions file exists, if it does, use the position from the file.
-                        if (sensorPositionsFileExists)
-                        {
-                            bool positionFound = false;
-                            for (int i = 0; i < NUMBER_OF_SENSORS; i++)
-                            {
-                                if (strcmp(persistentPositions[i].McuUniqueIdentifier, digitizer->SensorConfiguration->McuUniqueIdentifier) == 0)
-                                {
-                                    digitizer->SensorConfiguration->SensorPosition = persistentPositions[i].SensorPosition;
-                                    positionFound = true;
-                                }
-                            }
-                            // If sensor position is missing for given MCUID, print error and create new file.
-                            if (!positionFound)
-                            {
-                                printf("Error: Could not find sensor MCUID: %s in sensor_positions.csv file. \n", digitizer->SensorConfiguration->McuUniqueIdentifier);
-                                sensorPositionsFileExists = false;
-                            }
-                        }
-
-                        if (!digitizer->Sensor->GetTouchActiveArea(digitizer->Sensor))
-                        {
-                            printf("Sensor %d: GetTouchActiveArea error (%d) %s.\n", digitizer->SensorIndex, zForceErrno, ErrorString(zForceErrno));
-                            shutDownNow = true;
-                        }
-
-                        message->Destructor(message);
+                        EnableSensor(digitizer, digitizer->PendingEnable);
+                        digitizer->PendingEnable = NULL;
                     }
-                    else
+                    break;
+                }
+
+                if (message->MessageType == McuUniqueIdentifierMessageType && digitizer->IsRejoining)
+                {
+                    bool isVerified = VerifyRejoiningSensor(digitizer, (McuUniqueIdentifierMessage *)message);
+                    message->Destructor(message);
+                    if (!isVerified)
                     {
-                        // This message was received but we have already processed it. Probably the main loop or somewhere else that requested this. Send it to them for handling.
-                        EnqueueMessage(mainMessageQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
+                        return;
                     }
-                break;
-                case TouchActiveAreaMessageType:
-                    if (!touchActiveAreaMessageReceived)
-                    {
-                        touchActiveAreaMessageReceived = true;
+                    break;
+                }
 
-                        TouchActiveAreaMessage * touchActiveAreaMessage = (TouchActiveAreaMessage *)message;
+                if (digitizer->IsCached)
+                {
+                    // The sensor group thread already uses the cached configuration, let it verify the response.
+                    EnqueueMessage(digitizer->SensorGroupHandler->SensorGroupQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
+                    break;
+                }
 
-                        if (touchActiveAreaMessage->HasX)
-                        {
-                            digitizer->SensorConfiguration->TouchActiveAreaWidth = touchActiveAreaMessage->UpperBoundaryX - touchActiveAreaMessage->LowerBoundaryX;
-                        }
+                if (message->MessageType == McuUniqueIdentifierMessageType)
+                {
+                    HandleMcuUniqueIdentifier(digitizer, (McuUniqueIdentifierMessage *)message);
+                }
+                else
+                {
+                    HandleTouchActiveArea(digitizer, (TouchActiveAreaMessage *)message);
+                }
+                message->Destructor(message);
+            break;
+            case EnableMessageType:
+                /* We are enabled and can now receive notifications */
+                // A rejoining sensor is only merged once it is known to be the same sensor, see VerifyRejoiningSensor.
+                if (digitizer->IsRejoining && !BringUpIsDone(bringUp, BringUpStepMcuUniqueIdentifier))
+                {
+                    digitizer->PendingEnable = message;
+                }
+                else
+                {
+                    EnableSensor(digitizer, message);
+                }
 
-                        if (touchActiveAreaMessage->HasY)
-                        {
-                            digitizer->SensorConfiguration->TouchActiveAreaHeight = touchActiveAreaMessage->UpperBoundaryY - touchActiveAreaMessage->LowerBoundaryY;
-                        }
+                // The finger frequency only seeds the up timeout until the frame rate has been measured, so a failure is not fatal.
+                if (!digitizer->Platform->GetFingerFrequency(digitizer->Platform))
+                {
+                    printf("Sensor %d: GetFingerFrequency error (%d) %s.\n", digitizer->SensorIndex, zForceErrno, ErrorString(zForceErrno));
+                }
+            break;
+            case FingerFrequencyMessageType:
+                // Handled by the sensor group thread, which owns the up timeout.
+                EnqueueMessage(digitizer->SensorGroupHandler->SensorGroupQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
+            break;
+            case TouchMessageType:
+            {
+                if (!BringUpIsDone(bringUp, BringUpStepFirstTouch) && BringUpComplete(bringUp, BringUpStepFirstTouch, MetricsGetTimeMicroSeconds()))
+                {
+                    BringUpPrintDurations(bringUp);
+                }
 
-                        if (!digitizer->Sensor->SetNumberOfTrackedObjects(digitizer->Sensor, 1))
-                        {
-                            printf("Sensor %d: SetNumberOfTrackedObjects error (%d) %s.\n", digitizer->SensorIndex, zForceErrno, ErrorString(zForceErrno));
-                            shutDownNow = true;
-                        }
+                TouchMessage * touchMessage = (TouchMessage *)message;
+                MetricsSensorMessage(digitizer->SensorIndex);
+                EnqueueMessage(digitizer->SensorGroupHandler->SensorGroupQueue, (Message *)touchMessage, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
+            }
+            break;
+            default:
+                // All other messages are simply sent to the main loop queue.
+                EnqueueMessage(mainMessageQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
+            break;
+        }
+    }
+}
 
-                        message->Destructor(message);
-                    }
-                    else
-                    {
-                        // This message was received but we have already processed it. Probably the main loop or somewhere else that requested this. Send it to them for handling.
-                        EnqueueMessage(mainMessageQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
-                    }
-                break;
-                case NumberOfTrackedObjectsMessageType:
-                    if (!numberOfTrackedObjectsMessageReceived)
-                    {
-                        numberOfTrackedObjectsMessageReceived = true;
+/*  Disconnects and frees the connection of a sensor that failed, so it can be brought up again.  */
+static void CloseSensor(Digitizer * digitizer)
+{
+    if (digitizer->PendingEnable != NULL)
+    {
+        digitizer->PendingEnable->Destructor(digitizer->PendingEnable);
+        digitizer->PendingEnable = NULL;
+    }
 
-                        if (!digitizer->Sensor->SetEnable (digitizer->Sensor, true, 0))
-                        {
-                            printf("Sensor %d: SetEnable error (%d) %s.\n", digitizer->SensorIndex, zForceErrno, ErrorString(zForceErrno));
-                            shutDownNow = true;
-                        }
+    if (digitizer->Connection != NULL)
+    {
+        if (digitizer->Connection->IsConnected)
+        {
+            digitizer->Connection->Disconnect(digitizer->Connection);
+        }
+        digitizer->Connection->Destructor(digitizer->Connection);
+        digitizer->Connection = NULL;
+    }
 
-                        message->Destructor(message);
-                    }
-                    else
-                    {
-                        // This message was received but we have already processed it. Probably the main loop or somewhere else that requested this. Send it to them for handling.
-                        EnqueueMessage(mainMessageQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
-                    }
-                break;
-                case EnableMessageType:
-                    if (!enableMessageReceived)
-                    {
-                        /* We are enabled and can now receive notifications */
-                        enableMessageReceived = true;
+    digitizer->Platform = NULL;
+    digitizer->Sensor = NULL;
+}
 
-                        // Send message to sensor group queue to signal that the sensor is ready.
-                        EnqueueMessage(digitizer->SensorGroupHandler->SensorGroupQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
-                    }
-                    else
-                    {
-                        // This message was received but we have already processed it. Probably the main loop or somewhere else that requested this. Send it to them for handling.
-                        EnqueueMessage(mainMessageQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
-                    }
-                break;
-                case TouchMessageType:
-                {
-                    TouchMessage * touchMessage = (TouchMessage *)message;
-                    EnqueueMessage(digitizer->SensorGroupHandler->SensorGroupQueue, (Message *)touchMessage, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
-                }
-                break;
-                default:
-                    // All other messages are simply sent to the main loop queue.
-                    EnqueueMessage(mainMessageQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
-                break;
+/*  Chooses the hidpipe index to bring a sensor up on. The indexes change when sensors are plugged in and out, so the
+ *  sensor is looked for on its USB port, see AssignSensorPorts. Otherwise the first time it is the index of the sensor,
+ *  and a sensor that has been enabled before is looked for on the ports no other sensor uses, one per attempt. It is
+ *  identified before its touches are merged again.
+ *
+ *  @return index, -1 if no unused sensor is plugged in.
+*/
+static int ChooseDeviceIndex(Digitizer * digitizer)
+{
+    char paths[MAX_HID_DEVICES][MAX_USB_PATH_SIZE];
+    int numberOfPaths = GetUsbPortPaths(strtol(HIDDEVICEVID, NULL, 16), strtol(HIDDEVICEPID, NULL, 16), paths, MAX_HID_DEVICES);
+
+    for (int i = 0; i < numberOfPaths; i++)
+    {
+        if (strcmp(paths[i], digitizer->SensorConfiguration->UsbPath) == 0 && !IsUsbPortUsed(digitizer, paths[i]))
+        {
+            return i;
+        }
+    }
+
+    if (!digitizer->HasBeenEnabled)
+    {
+        return digitizer->SensorIndex;
+    }
+
+    for (int i = 0; i < numberOfPaths; i++)
+    {
+        int index = (digitizer->ProbeIndex + i) % numberOfPaths;
+        if (!IsUsbPortUsed(digitizer, paths[index]))
+        {
+            digitizer->ProbeIndex = index + 1;
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+/*  Checks if another sensor is connected on a USB port.
+ *
+ *  @return true if used.
+*/
+static bool IsUsbPortUsed(const Digitizer * digitizer, const char * usbPath)
+{
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        if (&digitizers[i] != digitizer && __atomic_load_n(&digitizers[i].IsConnected, __ATOMIC_ACQUIRE) &&
+            strcmp(digitizers[i].SensorConfiguration->UsbPath, usbPath) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*  Checks that a rejoining sensor is the one that dropped out, and merges it if it was enabled meanwhile. Another sensor
+ *  found on its port is left for its own thread, and the next attempt looks on the other ports.
+ *
+ *  @return true if it is the same sensor.
+*/
+static bool VerifyRejoiningSensor(Digitizer * digitizer, McuUniqueIdentifierMessage * mcuUniqueIdentifierMessage)
+{
+    char * identifier = NewMcuUniqueIdentifierString(mcuUniqueIdentifierMessage);
+    bool isSame = strcmp(identifier, digitizer->SensorConfiguration->McuUniqueIdentifier) == 0;
+
+    if (!isSame)
+    {
+        printf("Sensor %d: Found sensor %s on USB port %s instead.\n", digitizer->SensorIndex, identifier, digitizer->SensorConfiguration->UsbPath);
+        digitizer->SensorConfiguration->UsbPath[0] = 0;
+    }
+    zForceInstance->OsAbstractionLayer.Free(identifier);
+
+    if (isSame && digitizer->PendingEnable != NULL)
+    {
+        EnableSensor(digitizer, digitizer->PendingEnable);
+        digitizer->PendingEnable = NULL;
+    }
+
+    return isSame;
+}
+
+/*  Sends the enable response to the sensor group thread, which starts merging the touches of the sensor.  */
+static void EnableSensor(Digitizer * digitizer, Message * message)
+{
+    if (digitizer->IsRejoining)
+    {
+        uint64_t duration = MetricsGetTimeMicroSeconds() - digitizer->ReconnectStart;
+        MetricsSensorReconnect(digitizer->SensorIndex, duration);
+        printf("Sensor %d: Reconnected on USB port %s in %.1f ms.\n", digitizer->SensorIndex, digitizer->SensorConfiguration->UsbPath, duration / 1000.0);
+    }
+
+    digitizer->HasBeenEnabled = true;
+    EnqueueMessage(digitizer->SensorGroupHandler->SensorGroupQueue, message, digitizer->SensorConfiguration, zForceInstance->OsAbstractionLayer.GetTimeMilliSeconds());
+}
+
+/*  Wakes the sensors waiting to be brought up when a sensor is plugged in, and stops a sensor whose USB port is
+ *  removed. Runs on the hotplug thread.
+*/
+static void HandleHotplug(HotplugEvent event, const char * usbPath)
+{
+    if (event == HotplugEventAdd)
+    {
+        printf("USB port %s: Sensor plugged in.\n", usbPath);
+        __atomic_fetch_add(&hotplugAdds, 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        if (__atomic_load_n(&digitizers[i].IsConnected, __ATOMIC_ACQUIRE) && strcmp(digitizers[i].SensorConfiguration->UsbPath, usbPath) == 0)
+        {
+            __atomic_store_n(&digitizers[i].IsUnplugged, true, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+/*  Sends the request of a bring-up step.
+ *
+ *  @return true on success, false if the request could not be sent.
+*/
+static bool SendBringUpRequest(Digitizer * digitizer, BringUpStep step)
+{
+    bool result = true;
+
+    switch (step)
+    {
+        case BringUpStepOperationModes:
+            result = digitizer->Sensor->SetOperationModes(digitizer->Sensor,
+                DetectionMode | SignalsMode | LedLevelsMode | DetectionHidMode | GesturesMode,
+                DetectionMode);
+        break;
+        case BringUpStepMcuUniqueIdentifier:
+            result = digitizer->Platform->GetMcuUniqueIdentifier(digitizer->Platform);
+        break;
+        case BringUpStepTouchActiveArea:
+            result = digitizer->Sensor->GetTouchActiveArea(digitizer->Sensor);
+        break;
+        case BringUpStepNumberOfTrackedObjects:
+            result = digitizer->Sensor->SetNumberOfTrackedObjects(digitizer->Sensor, GetSettings()->TrackedObjects);
+        break;
+        case BringUpStepEnable:
+            result = digitizer->Sensor->SetEnable(digitizer->Sensor, true, 0);
+        break;
+        default:
+        break;
+    }
+
+    if (!result)
+    {
+        printf("Sensor %d: Requesting %s error (%d) %s.\n", digitizer->SensorIndex, BringUpGetStepName(step), zForceErrno, ErrorString(zForceErrno));
+    }
+
+    return result;
+}
+
+/*  Gets the bring-up step a message is the response of.
+ *
+ *  @return step, BringUpStepCount if the message is not a bring-up response.
+*/
+static BringUpStep GetBringUpStep(MessageType messageType)
+{
+    switch (messageType)
+    {
+        case OperationModesMessageType:
+            return BringUpStepOperationModes;
+        case McuUniqueIdentifierMessageType:
+            return BringUpStepMcuUniqueIdentifier;
+        case TouchActiveAreaMessageType:
+            return BringUpStepTouchActiveArea;
+        case NumberOfTrackedObjectsMessageType:
+            return BringUpStepNumberOfTrackedObjects;
+        case EnableMessageType:
+            return BringUpStepEnable;
+        default:
+            return BringUpStepCount;
+    }
+}
+
+/*  Stores the MCU unique identifier of a sensor and looks up its position in the sensor positions file.  */
+static void HandleMcuUniqueIdentifier(Digitizer * digitizer, McuUniqueIdentifierMessage * mcuUniqueIdentifierMessage)
+{
+    SetMcuUniqueIdentifier(digitizer->SensorConfiguration, NewMcuUniqueIdentifierString(mcuUniqueIdentifierMessage));
+
+    // The position of a mapped USB port does not depend on the sensor plugged into it.
+    if (IsOnMappedPort(digitizer))
+    {
+        return;
+    }
+
+    // Check if sensor positions file exists, if it does, use the position from the file.
+    if (sensorPositionsFileExists)
+    {
+        bool positionFound = false;
+        for (int i = 0; i < GetSettings()->Sensors; i++)
+        {
+            if (persistentPositions[i].McuUniqueIdentifier != NULL &&
+                strcmp(persistentPositions[i].McuUniqueIdentifier, digitizer->SensorConfiguration->McuUniqueIdentifier) == 0)
+            {
+                digitizer->SensorConfiguration->SensorPosition = persistentPositions[i].SensorPosition;
+                positionFound = true;
             }
         }
+        // If sensor position is missing for given MCUID, print error and create new file.
+        if (!positionFound)
+        {
+            printf("Error: Could not find sensor MCUID: %s in sensor_positions.csv file. \n", digitizer->SensorConfiguration->McuUniqueIdentifier);
+            sensorPositionsFileExists = false;
+        }
+    }
+}
+
+/*  Formats the MCU unique identifier as a hex string.
+ *
+ *  @return string allocated with the OsAbstractionLayer, the caller frees it.
+*/
+static char * NewMcuUniqueIdentifierString(McuUniqueIdentifierMessage * mcuUniqueIdentifierMessage)
+{
+    char * identifier = (char*)zForceInstance->OsAbstractionLayer.MallocWithPattern(mcuUniqueIdentifierMessage->BufferSize * 2 + 1, 0);
+    char * ptr = identifier;
+    for (uint32_t i = 0; i < mcuUniqueIdentifierMessage->BufferSize; i++)
+    {
+        ptr += sprintf(ptr, "%02X", mcuUniqueIdentifierMessage->McuUniqueIdentifier[i]); 
+    }
+    return identifier;
+}
+
+/*  Stores the MCU unique identifier of a sensor, taking over the string. When a sensor is brought up again the
+ *  identifier is usually the same, and the one the sensor group thread may be using is kept.
+*/
+static void SetMcuUniqueIdentifier(SensorConfiguration * sensorConfiguration, char * identifier)
+{
+    if (sensorConfiguration->McuUniqueIdentifier != NULL && strcmp(sensorConfiguration->McuUniqueIdentifier, identifier) == 0)
+    {
+        zForceInstance->OsAbstractionLayer.Free(identifier);
+        return;
+    }
+
+    if (sensorConfiguration->McuUniqueIdentifier != NULL)
+    {
+        zForceInstance->OsAbstractionLayer.Free(sensorConfiguration->McuUniqueIdentifier);
+    }
+    sensorConfiguration->McuUniqueIdentifier = identifier;
+}
+
+/*  Stores the size of the touch active area of a sensor.  */
+static void HandleTouchActiveArea(Digitizer * digitizer, TouchActiveAreaMessage * touchActiveAreaMessage)
+{
+    if (touchActiveAreaMessage->HasX)
+    {
+        digitizer->SensorConfiguration->TouchActiveAreaWidth = touchActiveAreaMessage->UpperBoundaryX - touchActiveAreaMessage->LowerBoundaryX;
+    }
+
+    if (touchActiveAreaMessage->HasY)
+    {
+        digitizer->SensorConfiguration->TouchActiveAreaHeight = touchActiveAreaMessage->UpperBoundaryY - touchActiveAreaMessage->LowerBoundaryY;
+    }
+}
+
+/*  Takes the position, identifier and touch active area of a sensor from sensor_positions.csv when the file has them
+ *  cached for the USB port the sensor is connected to.
+ *
+ *  @return true if the cached configuration is used.
+*/
+static bool UseCachedConfiguration(Digitizer * digitizer)
+{
+    const SensorConfiguration * cached = FindPersistentConfiguration(digitizer->SensorConfiguration->UsbPath);
+
+    if (cached == NULL || cached->McuUniqueIdentifier == NULL || cached->TouchActiveAreaWidth == 0 || cached->TouchActiveAreaHeight == 0)
+    {
+        return false;
+    }
+
+    digitizer->SensorConfiguration->SensorPosition = cached->SensorPosition;
+    digitizer->SensorConfiguration->TouchActiveAreaWidth = cached->TouchActiveAreaWidth;
+    digitizer->SensorConfiguration->TouchActiveAreaHeight = cached->TouchActiveAreaHeight;
+    char * identifier = (char*)zForceInstance->OsAbstractionLayer.MallocWithPattern(strlen(cached->McuUniqueIdentifier) + 1, 0);
+    strcpy(identifier, cached->McuUniqueIdentifier);
+    SetMcuUniqueIdentifier(digitizer->SensorConfiguration, identifier);
+    digitizer->IsCached = true;
+
+    printf("Sensor %d: Using cached configuration for USB port %s.\n", digitizer->SensorIndex, digitizer->SensorConfiguration->UsbPath);
+
+    return true;
+}
+
+/*  Checks that the sensor on a USB port is the cached one. The position belongs to the port, so a different sensor
+ *  takes it over, and its identifier replaces the cached one.
+ *
+ *  The port of a sensor is only known from its hidpipe index, see GetUsbPortPaths. Until one sensor has answered with
+ *  the identifier cached for its port, a sensor cached for another port means that the indexes do not follow the
+ *  ports. That is a mapping error and shuts down without touching sensor_positions.csv. Other changes are saved once
+ *  the mapping is verified.
+*/
+static void VerifyCachedMcuUniqueIdentifier(SensorConfiguration * sensorConfiguration, McuUniqueIdentifierMessage * mcuUniqueIdentifierMessage)
+{
+    char * identifier = NewMcuUniqueIdentifierString(mcuUniqueIdentifierMessage);
+
+    if (sensorConfiguration->McuUniqueIdentifier != NULL && strcmp(identifier, sensorConfiguration->McuUniqueIdentifier) == 0)
+    {
+        zForceInstance->OsAbstractionLayer.Free(identifier);
+        isPortMappingVerified = true;
+        if (isPositionsFileStale)
+        {
+            isPositionsFileStale = false;
+            WriteSensorPositionsFile(persistentPositions);
+        }
+        return;
+    }
+
+    const char * cachedUsbPath = FindCachedUsbPath(identifier, sensorConfiguration->UsbPath);
+    if (!isPortMappingVerified && cachedUsbPath != NULL)
+    {
+        printf("Error: Sensor MCUID %s cached for USB port %s answered on USB port %s. Either the hidpipe indexes do not "
+            "follow the USB ports or the sensors were swapped, sensor_positions.csv is left unchanged. \n",
+            identifier, cachedUsbPath, sensorConfiguration->UsbPath);
+        zForceInstance->OsAbstractionLayer.Free(identifier);
+        shutDownNow = true;
+        return;
     }
+
+    printf("Sensor MCUID %s on USB port %s replaces MCUID %s at position %s. \n", identifier, sensorConfiguration->UsbPath,
+        sensorConfiguration->McuUniqueIdentifier != NULL ? sensorConfiguration->McuUniqueIdentifier : "unknown",
+        GetSensorPositionName(sensorConfiguration->SensorPosition));
+
+    SensorConfiguration * persistent = FindPersistentConfiguration(sensorConfiguration->UsbPath);
+    if (persistent != NULL)
+    {
+        if (persistent->McuUniqueIdentifier != NULL)
+        {
+            zForceInstance->OsAbstractionLayer.Free(persistent->McuUniqueIdentifier);
+        }
+        persistent->McuUniqueIdentifier = (char*)zForceInstance->OsAbstractionLayer.MallocWithPattern(strlen(identifier) + 1, 0);
+        strcpy(persistent->McuUniqueIdentifier, identifier);
+        if (isPortMappingVerified)
+        {
+            WriteSensorPositionsFile(persistentPositions);
+        }
+        else
+        {
+            printf("Sensor MCUID %s is saved to sensor_positions.csv once the USB port mapping is verified. \n", identifier);
+            isPositionsFileStale = true;
+        }
+    }
+
+    SetMcuUniqueIdentifier(sensorConfiguration, identifier);
+}
+
+/*  Checks the cached touch active area of a sensor, and updates the merger and the cache if it changed.  */
+static void VerifyCachedTouchActiveArea(SensorConfiguration * sensorConfiguration, TouchActiveAreaMessage * touchActiveAreaMessage)
+{
+    uint32_t width = touchActiveAreaMessage->HasX ? touchActiveAreaMessage->UpperBoundaryX - touchActiveAreaMessage->LowerBoundaryX : sensorConfiguration->TouchActiveAreaWidth;
+    uint32_t height = touchActiveAreaMessage->HasY ? touchActiveAreaMessage->UpperBoundaryY - touchActiveAreaMessage->LowerBoundaryY : sensorConfiguration->TouchActiveAreaHeight;
+
+    if (width == sensorConfiguration->TouchActiveAreaWidth && height == sensorConfiguration->TouchActiveAreaHeight)
+    {
+        return;
+    }
+
+    printf("Touch active area of sensor position %s changed from cached %ux%u to %ux%u. \n", GetSensorPositionName(sensorConfiguration->SensorPosition),
+        sensorConfiguration->TouchActiveAreaWidth, sensorConfiguration->TouchActiveAreaHeight, width, height);
+
+    sensorConfiguration->TouchActiveAreaWidth = width;
+    sensorConfiguration->TouchActiveAreaHeight = height;
+    UpdateSensorConfiguration(*sensorConfiguration);
+
+    SensorConfiguration * persistent = FindPersistentConfiguration(sensorConfiguration->UsbPath);
+    if (persistent != NULL)
+    {
+        persistent->TouchActiveAreaWidth = width;
+        persistent->TouchActiveAreaHeight = height;
+        WriteSensorPositionsFile(persistentPositions);
+    }
+}
+
+/*  Finds the configuration read from sensor_positions.csv for a USB port.
+ *
+ *  @return configuration, NULL if the file has none for the port.
+*/
+static SensorConfiguration * FindPersistentConfiguration(const char * usbPath)
+{
+    if (!sensorPositionsFileExists || usbPath[0] == 0)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        if (strcmp(persistentPositions[i].UsbPath, usbPath) == 0)
+        {
+            return &persistentPositions[i];
+        }
+    }
+    return NULL;
+}
+
+/*  Finds the USB port that sensor_positions.csv caches a sensor for, other than given port.
+ *
+ *  @return USB port path, NULL if the sensor is not cached for another port.
+*/
+static const char * FindCachedUsbPath(const char * identifier, const char * exceptUsbPath)
+{
+    if (!sensorPositionsFileExists)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        if (persistentPositions[i].McuUniqueIdentifier != NULL && persistentPositions[i].UsbPath[0] != 0 &&
+            strcmp(persistentPositions[i].McuUniqueIdentifier, identifier) == 0 && strcmp(persistentPositions[i].UsbPath, exceptUsbPath) != 0)
+        {
+            return persistentPositions[i].UsbPath;
+        }
+    }
+    return NULL;
+}
+
+/*  Assigns the USB ports to the sensors in the order of their sysfs paths, so every sensor is on the same port on every
+ *  start regardless of the hidpipe indexes, and takes the positions of the ports from sensor_positions.csv before any
+ *  sensor is queried. Sensors on ports missing from the file get the remaining positions, and are looked up by their
+ *  MCU unique identifier once it arrives.
+*/
+static void AssignSensorPorts(void)
+{
+    char paths[MAX_HID_DEVICES][MAX_USB_PATH_SIZE];
+    int numberOfPaths = GetUsbPortPaths(strtol(HIDDEVICEVID, NULL, 16), strtol(HIDDEVICEPID, NULL, 16), paths, MAX_HID_DEVICES);
+    bool isPositionUsed[SensorPositionBottomRight + 1] = { false };
+    bool isMapped[MAX_SENSORS] = { false };
+
+    // A single sensor is on hidpipe index 0 whatever its port.
+    isPortMappingVerified = numberOfPaths <= 1;
+
+    for (int i = 0; i < GetSettings()->Sensors && i < numberOfPaths; i++)
+    {
+        SensorConfiguration * config = digitizers[i].SensorConfiguration;
+        const SensorConfiguration * mapped = FindPersistentConfiguration(paths[i]);
+
+        strcpy(config->UsbPath, paths[i]);
+        if (mapped != NULL && mapped->SensorPosition <= SensorPositionBottomRight && !isPositionUsed[mapped->SensorPosition])
+        {
+            config->SensorPosition = mapped->SensorPosition;
+            isPositionUsed[mapped->SensorPosition] = true;
+            isMapped[i] = true;
+        }
+    }
+
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        SensorConfiguration * config = digitizers[i].SensorConfiguration;
+        if (!isMapped[i])
+        {
+            int position = 0;
+            while (isPositionUsed[position])
+            {
+                position++;
+            }
+            config->SensorPosition = position;
+            isPositionUsed[position] = true;
+        }
+
+        printf("Sensor %d: USB port %s, position %s%s. \n", i, config->UsbPath[0] != 0 ? config->UsbPath : "unknown",
+            GetSensorPositionName(config->SensorPosition), isMapped[i] ? "" : " until identified");
+    }
+}
+
+/*  Takes the position of the USB port a sensor is on from sensor_positions.csv, if the file maps the port.  */
+static void UsePortPosition(Digitizer * digitizer)
+{
+    const SensorConfiguration * mapped = FindPersistentConfiguration(digitizer->SensorConfiguration->UsbPath);
+
+    if (mapped != NULL)
+    {
+        digitizer->SensorConfiguration->SensorPosition = mapped->SensorPosition;
+    }
+}
+
+/*  Checks if a sensor is on a USB port that sensor_positions.csv maps to the position of the sensor.
+ *
+ *  @return true if the port decides the position.
+*/
+static bool IsOnMappedPort(const Digitizer * digitizer)
+{
+    const SensorConfiguration * mapped = FindPersistentConfiguration(digitizer->SensorConfiguration->UsbPath);
+
+    return mapped != NULL && mapped->SensorPosition == digitizer->SensorConfiguration->SensorPosition;
 }
 
 /*  Runs the message loop for a sensor group.  */
@@ -409,53 +1080,138 @@ static void SensorGroupThread(void * parameters)
     SensorGroupHandler * sensorGroupHandler = (SensorGroupHandler *)parameters;
     IndexedMessage * indexedMessage = NULL;
 
+    SettingsQuiescentState();
+    int32_t reportRate = GetSettings()->ReportRate;
+
     while (!sensorGroupHandler->ShutDownNow)
     {
-        if(globalTriggerTimeout)
+        SettingsQuiescentState();
+
+        // The report scheduler is only used by this thread, so a reloaded report rate is applied here.
+        if (GetSettings()->ReportRate != reportRate)
         {
-            globalTriggerTimeout = false;
-            indexedMessage = sensorGroupHandler->SensorGroupQueue->Dequeue (
-                sensorGroupHandler->SensorGroupQueue, globalTimeoutInMs);
-            if(indexedMessage == NULL)   // true when timeout
+            reportRate = GetSettings()->ReportRate;
+            ReportSchedulerSetRate(reportRate);
+        }
+
+        UpdateSensorAvailability();
+
+        // Wake up in time to release contacts that are up pending, see TimeoutCallback, and for the next paced report.
+        int32_t timeoutInMs = GetTimeoutInMs();
+        int32_t tickInMs = ReportSchedulerGetTimeoutInMs(MetricsGetTimeMicroSeconds());
+        if (tickInMs >= 0 && (timeoutInMs < 0 || tickInMs < timeoutInMs))
+        {
+            timeoutInMs = tickInMs;
+        }
+        indexedMessage = sensorGroupHandler->SensorGroupQueue->Dequeue (
+            sensorGroupHandler->SensorGroupQueue, timeoutInMs < 0 ? GetSettings()->QueueTimeout : timeoutInMs);
+        if (NULL != indexedMessage)
+        {
+            MetricsQueueDequeued(MetricsQueueSensorGroup);
+
+            // This is where the magic happens that de-duplicates touches from right/left, before sending them along to the Main Thread's queue.
+            // You can either modify the IndexedMessage, or you can create a new one (don't forget to free the other one).
+            // The IndexedMessage is mutable, as is the Message object.
+            // IMPORTANT: ALWAYS use either your own malloc()/free() OR the OsAbstractionLayer-functions. This goes for everywhere.
+            // The following two are identical:
+
+            // Using the EnqueueIndexMessage() helper function.
+            // EnqueueIndexedMessage(sensorGroupHandler->SensorGroupQueue, indexedMessage);
+            // printf("SensorGroupThread: \t%s\n", GetSensorPositionName(indexedMessage->SensorConfiguration->SensorPosition));
+
+            // Using EnqueueMessage() like we do everywhere else.
+            // EnqueueMessage(sensorGroupHandler->SensorGroupQueue, indexedMessage->Message, indexedMessage->SensorConfiguration->SensorPosition, indexedMessage->SensorGroupHandler->SensorGroup, indexedMessage->Timestamp);
+            // zForceInstance->OsAbstractionLayer.Free(indexedMessage);
+
+            // IMPORTANT: Messages are fire-and-forget, so it's up to the receiver to destroy / free them.
+
+            ProcessMessage(indexedMessage);
+        }
+
+        if (TimeoutCallback())
+        {
+            const TouchFrame * frame = GetTouchFrame();
+            if (GetSettings()->Verbose)
             {
-                TimeoutCallback();
-                TouchInfo * info = TouchBufPopLastWritten();
-                if (verbose)
-                {
-                    PrintTouchInfo(info, 0);
-                }
-                SendToHostAsAbsoluteMouse(info);
+                PrintTouchFrame(frame);
             }
-            else
+            OutputSend(frame);
+        }
+
+        uint64_t now = MetricsGetTimeMicroSeconds();
+        ReportSchedulerSetActive(IsTouchFrameTouching(), now);
+        if (ReportSchedulerIsTickDue(now))
+        {
+            const TouchFrame * frame = GetResampledTouchFrame(now);
+            if (GetSettings()->Verbose)
             {
-                ProcessMessage(indexedMessage);
+                PrintTouchFrame(frame);
             }
+            OutputSend(frame);
         }
-        else
+    }
+
+    SettingsThreadExit();
+}
+
+/*  Removes the sensors that dropped out from merging. Contacts only they tracked are released right away, the other
+ *  sensors keep working.
+*/
+static void UpdateSensorAvailability(void)
+{
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        if (digitizers[i].IsMerged && !__atomic_load_n(&digitizers[i].IsConnected, __ATOMIC_ACQUIRE))
         {
-            indexedMessage = sensorGroupHandler->SensorGroupQueue->Dequeue (sensorGroupHandler->SensorGroupQueue, QUEUE_TIMEOUT);
-            if (NULL != indexedMessage)
-            {
-                // This is where the magic happens that de-duplicates touches from right/left, before sending them along to the Main Thread's queue.
-                // You can either modify the IndexedMessage, or you can create a new one (don't forget to free the other one).
-                // The IndexedMessage is mutable, as is the Message object.
-                // IMPORTANT: ALWAYS use either your own malloc()/free() OR the OsAbstractionLayer-functions. This goes for everywhere.
-                // The following two are identical:
+            RemoveSensor(&digitizers[i]);
+        }
+    }
+}
 
-                // Using the EnqueueIndexMessage() helper function.
-                // EnqueueIndexedMessage(sensorGroupHandler->SensorGroupQueue, indexedMessage);
-                // printf("SensorGroupThread: \t%s\n", GetSensorPositionName(indexedMessage->SensorConfiguration->SensorPosition));
+/*  Starts merging the touches of a sensor that has been enabled, also when it rejoins after dropping out. A sensor whose
+ *  position is already taken by another sensor is left out.
+*/
+static void MergeSensor(Digitizer * digitizer)
+{
+    // The sensor came back before its drop out was noticed.
+    if (digitizer->IsMerged)
+    {
+        RemoveSensor(digitizer);
+    }
+
+    if (!AddSensorConfiguration(*(digitizer->SensorConfiguration)))
+    {
+        printf("Sensor %d: Not merging touches, check sensor_positions.csv. \n", digitizer->SensorIndex);
+        return;
+    }
 
-                // Using EnqueueMessage() like we do everywhere else.
-                // EnqueueMessage(sensorGroupHandler->SensorGroupQueue, indexedMessage->Message, indexedMessage->SensorConfiguration->SensorPosition, indexedMessage->SensorGroupHandler->SensorGroup, indexedMessage->Timestamp);
-                // zForceInstance->OsAbstractionLayer.Free(indexedMessage);
+    digitizer->IsMerged = true;
+    digitizer->MergedPosition = digitizer->SensorConfiguration->SensorPosition;
+    MetricsSetSensorActive(digitizer->SensorIndex, true);
+}
 
-                // IMPORTANT: Messages are fire-and-forget, so it's up to the receiver to destroy / free them.
+/*  Stops merging the touches of a sensor.  */
+static void RemoveSensor(Digitizer * digitizer)
+{
+    RemoveSensorConfiguration(digitizer->MergedPosition);
+    digitizer->IsMerged = false;
+    MetricsSetSensorActive(digitizer->SensorIndex, false);
+}
 
-                ProcessMessage(indexedMessage);
-            }
+/*  Finds the digitizer a sensor configuration belongs to. Every queued message carries the configuration of a digitizer.
+ *
+ *  @return digitizer, NULL if not found.
+*/
+static Digitizer * FindDigitizer(const SensorConfiguration * sensorConfiguration)
+{
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        if (digitizers[i].SensorConfiguration == sensorConfiguration)
+        {
+            return &digitizers[i];
         }
     }
+    return NULL;
 }
 
 /*  Creates a IndexedMessage struct and queues it from given parameters.  */
@@ -465,6 +1221,7 @@ static void EnqueueMessage(Queue * queue, Message * message, SensorConfiguration
     indexedMessage->SensorConfiguration = sensorConfiguration;
     indexedMessage->SensorGroupHandler = &groupHandler;
     indexedMessage->Timestamp = timestamp;
+    indexedMessage->QueuedAt = MetricsGetTimeMicroSeconds();
     indexedMessage->Message = message;
     EnqueueIndexedMessage(queue, indexedMessage);
 }
@@ -476,7 +1233,9 @@ static void EnqueueIndexedMessage(Queue * queue, IndexedMessage * indexedMessage
     {
         printf("Error: Failed queueing message.\n");
         shutDownNow = true;
+        return;
     }
+    MetricsQueueEnqueued(queue == mainMessageQueue ? MetricsQueueMain : MetricsQueueSensorGroup);
 }
 
 /*  Makes sure configurations are done, getting the touches ready for sending to host and deallocates the messages.  */
@@ -484,7 +1243,7 @@ static void ProcessMessage(IndexedMessage * indexedMessage)
 {
     Message * message = indexedMessage->Message;
 
-    // Enable message is the last message after setting up each sensor. Check configuration and enable touch handling when all configurations are done.
+    // Enable message is the last message after setting up each sensor. Check configuration and enable touch handling for the sensor.
     if (message->MessageType == EnableMessageType)
     {
         printf("Configuration for sensor position %s is: \n", GetSensorPositionName(indexedMessage->SensorConfiguration->SensorPosition));
@@ -492,17 +1251,19 @@ static void ProcessMessage(IndexedMessage * indexedMessage)
         printf("Height: %d \n", indexedMessage->SensorConfiguration->TouchActiveAreaHeight);
         printf("MCUID: %s \n", indexedMessage->SensorConfiguration->McuUniqueIdentifier);
 
-        if (!AddSensorConfiguration(*(indexedMessage->SensorConfiguration)))
+        MergeSensor(FindDigitizer(indexedMessage->SensorConfiguration));
+
+        // Create or overwrite sensor positions file if it does not exist or missing information, or to cache the configuration of sensors that were not cached.
+        bool isEverySensorCached = true;
+        for (int i = 0; i < GetSettings()->Sensors; i++)
         {
-            shutDownNow = true;
-            return;
+            isEverySensorCached &= digitizers[i].IsCached;
         }
 
-        // Create or overwrite sensor positions file if it does not exist or missing information.
-        if (allSensorConfigurationsReceived && !sensorPositionsFileExists)
+        if (allSensorConfigurationsReceived && (!sensorPositionsFileExists || !isEverySensorCached))
         {
-            SensorConfiguration writeConfigs[NUMBER_OF_SENSORS] = { 0 };
-            for (int i = 0; i < NUMBER_OF_SENSORS; i++)
+            SensorConfiguration writeConfigs[MAX_SENSORS] = { 0 };
+            for (int i = 0; i < GetSettings()->Sensors; i++)
             {
                 writeConfigs[i] = *(digitizers[i].SensorConfiguration);
             }
@@ -514,24 +1275,59 @@ static void ProcessMessage(IndexedMessage * indexedMessage)
             }
         }
     }
-    else if (message->MessageType == TouchMessageType && allSensorConfigurationsReceived)
+    else if (message->MessageType == McuUniqueIdentifierMessageType)
+    {
+        VerifyCachedMcuUniqueIdentifier(indexedMessage->SensorConfiguration, (McuUniqueIdentifierMessage *)message);
+    }
+    else if (message->MessageType == TouchActiveAreaMessageType)
+    {
+        VerifyCachedTouchActiveArea(indexedMessage->SensorConfiguration, (TouchActiveAreaMessage *)message);
+    }
+    else if (message->MessageType == FingerFrequencyMessageType)
     {
+        FingerFrequencyMessage * fingerFrequencyMessage = (FingerFrequencyMessage *)message;
+        printf("Finger frequency for sensor position %s is: %u Hz \n", GetSensorPositionName(indexedMessage->SensorConfiguration->SensorPosition), fingerFrequencyMessage->Frequency);
+        SetSensorFingerFrequency(indexedMessage->SensorConfiguration, fingerFrequencyMessage->Frequency);
+    }
+    else if (message->MessageType == TouchMessageType && FindDigitizer(indexedMessage->SensorConfiguration)->IsMerged)
+    {
+        uint64_t mergeStart = MetricsGetTimeMicroSeconds();
+        MetricsRecordLatency(MetricsStageQueue, mergeStart - indexedMessage->QueuedAt);
+
+        if (OutputWantsRawTouches())
+        {
+            TouchMessage * rawMessage = (TouchMessage *)message;
+            TouchInfo raw = {0};
+            CopyTouchInfo(&raw,
+                            rawMessage->X, rawMessage->Y,
+                            ConvertTouchEvent(rawMessage->Event), indexedMessage->Timestamp,
+                            indexedMessage->SensorConfiguration);
+            OutputSendRaw(&raw);
+        }
+
         IndexedMessage * pending = MergeTouch(indexedMessage);
 
+        uint64_t mergeEnd = MetricsGetTimeMicroSeconds();
+        MetricsRecordLatency(MetricsStageMerge, mergeEnd - mergeStart);
+
+        // Moves wait for the next tick when reports are paced, down and up events are sent right away.
+        if (NULL != pending && ReportSchedulerIsPaced() && ((TouchMessage *)pending->Message)->Event == (TouchEvent)App_MoveEvent)
+        {
+            pending = NULL;
+        }
+
         if(NULL != pending)
         {
-            TouchMessage * touchMessage = (TouchMessage *)(indexedMessage->Message);
-            TouchInfo info = {0};
-            ApplicationTouchEvent appEvent = ConvertTouchEvent(touchMessage->Event);
-            CopyTouchInfo(&info, 
-                            touchMessage->X, touchMessage->Y, 
-                            appEvent, indexedMessage->Timestamp, 
-                            indexedMessage->SensorConfiguration);
-            if (verbose)
+            const TouchFrame * frame = GetTouchFrame();
+            if (GetSettings()->Verbose)
             {
-                PrintTouchInfo(&info, 0);
+                PrintTouchFrame(frame);
             }
-            SendToHostAsAbsoluteMouse(&info);
+            OutputSend(frame);
+
+            uint64_t outputEnd = MetricsGetTimeMicroSeconds();
+            MetricsRecordLatency(MetricsStageOutput, outputEnd - mergeEnd);
+            MetricsRecordLatency(MetricsStageTotal, outputEnd - indexedMessage->QueuedAt);
         }
     }
 
@@ -573,43 +1369,14 @@ static void PrintTouchInfo(TouchInfo * info, int mode)
     }
 }
 
-/*  Converts the touch coordinates to absolute mouse coordinates and sends them to the host.  */
-static void SendToHostAsAbsoluteMouse(TouchInfo * info)
+/*  Prints out all contacts in given frame.  */
+static void PrintTouchFrame(const TouchFrame * frame)
 {
-    if(emulatedDevice < 0)
-    {
-        emulatedDevice = open("/dev/hidg0", O_RDWR | O_NONBLOCK);
-        if(emulatedDevice < 0)
-        {
-            printf("Error: Unable to open hidg0 (absolute mouse). \n");
-            shutDownNow = true;
-            return;
-        }
-    }
-
-    uint8_t data[5] = {0};
-    switch(info->Event)
-    {
-        case App_DownEvent: data[0] = 1; break;     // button press
-        case App_MoveEvent: data[0] = 1; break;     // button press
-        default: data[0] = 0;                   // button release
-    }
-
-    double normX = 1.0 * info->X / hostScreenWidth;
-    double normY = 1.0 * info->Y / hostScreenHeight;
-
-    uint16_t x = INT16_MAX * MIN(normX, 1.0);
-    uint16_t y = INT16_MAX * MIN(normY, 1.0);
-    
-    data[1] = x & 0xFF;
-    data[2] = x >> 8;
-    data[3] = y & 0xFF;
-    data[4] = y >> 8;
-    ssize_t written = write(emulatedDevice, data, 5);
-
-    if(written < 0)
+    for (int i = 0; i < frame->NumberOfContacts; i++)
     {
-        perror("Error: Writing to hidg0 (absolute mouse)");
+        TouchInfo info = frame->Contacts[i];
+        printf("#%u \t", info.ContactId);
+        PrintTouchInfo(&info, 0);
     }
 }
 
@@ -620,11 +1387,18 @@ static void SignalHandler (int sig)
     ShutDownNow("User input shutdown signal. \n");
 }
 
+/*  Reloads the settings on SIGHUP, see ReloadSettings. Only sets a flag for the main loop.  */
+static void ReloadSignalHandler(int sig)
+{
+    (void)sig;
+    reloadSettingsNow = 1;
+}
+
 /*  Close the threads gracefully and free resources.  */
 static void Destroy(void)
 {
     // Signal Sensor threads to exit.
-    for (int sensorIndex = 0; sensorIndex < NUMBER_OF_SENSORS; sensorIndex++)
+    for (int sensorIndex = 0; sensorIndex < GetSettings()->Sensors; sensorIndex++)
     {
         Digitizer * digitizer = &digitizers[sensorIndex];
         if (digitizer->Thread != NULL)
@@ -634,7 +1408,7 @@ static void Destroy(void)
     }
 
     // Wait for them to exit and free their resources.
-    for (int sensorIndex = 0; sensorIndex < NUMBER_OF_SENSORS; sensorIndex++)
+    for (int sensorIndex = 0; sensorIndex < GetSettings()->Sensors; sensorIndex++)
     {
         Digitizer * digitizer = &digitizers[sensorIndex];
         if (digitizer->Thread != NULL)
@@ -671,7 +1445,15 @@ static void Destroy(void)
     }
 
     // Destroy the main message queue.
-    mainMessageQueue->Destructor(mainMessageQueue);
+    if (mainMessageQueue != NULL)
+    {
+        mainMessageQueue->Destructor(mainMessageQueue);
+        mainMessageQueue = NULL;
+    }
+
+    HotplugStop();
+    MetricsStop();
+    OutputClose();
 
     if (zForceInitialized)
     {
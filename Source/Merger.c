@@ -1,4 +1,7 @@
 #include "Merger.h"
+#include "Metrics.h"
+#include "Settings.h"
+#include "Kernels.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,7 +10,12 @@
 #include <errno.h>
 #include <Message.h>
 
-#define TOUCH_BUF_SIZE 16
+// Helper macros.
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+#define CONTACT_UNBOUND 0
+#define ASSOCIATION_SEARCH_RADIUS (ASSOCIATION_GATE * 2)   // Covers the gate plus the largest prediction step from the last position.
 
 typedef enum TouchInfoKey
 {
@@ -18,42 +26,98 @@ typedef enum TouchInfoKey
     TouchInfoSensorPosition = 4
 } TouchInfoKey;
 
-void HandleStateUpPending(void);
-void HandleStateReset(void);
-void PrintStateArbitratorError(TouchInfo * info);
-SensorState MapTouchstateToSensorstate(TouchInfo * info);
-
-void TouchBufSyncPushAndPopIndex(void);
-int TouchBufGetCurrentLoad(void);
-int TouchBufRewriteCurrent(TouchInfo * info);
-int TouchBufEmptyCurrent(void);
+/*  Inputs of the state machine, the touch events of the sensors.  */
+typedef enum StateInput
+{
+    StateInputDown = 0,
+    StateInputMove,
+    StateInputUp,
+    StateInputInvalid,
+    StateInputCount
+} StateInput;
+
+/*  What to do on a transition besides changing state.  */
+typedef enum StateAction
+{
+    StateActionNone = 0,
+    StateActionUpPending,           //!< Start the up timeout.
+    StateActionRetouch,             //!< Touched again while up pending, stop the up timeout.
+    StateActionRelease,             //!< Released while up pending.
+    StateActionDebounceUpPending,   //!< Touched again after release, start the up timeout unless debounced.
+    StateActionError                //!< Input not allowed in this state, reset the contact.
+} StateAction;
+
+typedef struct StateTransition
+{
+    SensorState Next;
+    StateAction Action;
+} StateTransition;
+
+_Static_assert(SENSOR_STATE_COUNT == METRICS_STATES, "SENSOR_STATE_COUNT does not match METRICS_STATES.");
+_Static_assert(StateInputCount == METRICS_STATE_INPUTS, "StateInputCount does not match METRICS_STATE_INPUTS.");
+
+void HandleStateUpPending(Contact * contact);
+void HandleStateReset(Contact * contact);
+void HandleStateError(Contact * contact, TouchInfo * info);
+StateInput MapTouchEventToStateInput(TouchInfo * info);
+
+void TouchBufSyncPushAndPopIndex(TouchBuffer * buffer);
+int TouchBufGetCurrentLoad(TouchBuffer * buffer);
+int TouchBufRewriteCurrent(TouchBuffer * buffer, TouchInfo * info);
+int TouchBufEmptyCurrent(TouchBuffer * buffer);
+void UpdateTouchFrame(TouchInfo * info);
+void UpdateFrameInterval(TouchInfo * info, uint32_t sensorTouchId);
+IndexedMessage * ReportTouch(IndexedMessage * indexedMessage, Contact * contact, TouchInfo * info);
+Contact * FindReportedContact(uint32_t contactId);
+
+Contact * AssociateContact(TouchInfo * info, uint32_t sensorTouchId);
+Contact * FindNearestContact(TouchInfo * info, int sensorIndex, uint64_t now);
+Contact * AllocateContact(uint64_t now);
+void FreeContact(Contact * contact);
+bool IsContactExpired(Contact * contact, uint64_t now);
+bool IsContactBoundToSensor(Contact * contact, int sensorIndex);
+void PredictPosition(Contact * contact, TouchInfo * info, int32_t * x, int32_t * y);
 
 TouchInfo * MapTouchCoordinates(TouchInfo * output, TouchInfo * input);
-TouchInfo * Debounce(TouchInfo * info);
-TouchInfo * Deghost(TouchInfo * info);
-TouchInfo * WeightedPosition(TouchInfo * info);
-TouchInfo * CoordinatesSmoother(TouchInfo * info);
-TouchInfo * StateArbitrator(TouchInfo * info);
-TouchInfo * FindHistoryBy(TouchInfo * info, TouchInfoKey key, bool searchSame);
-bool IsCloserToOppositeSensor(TouchInfo * info);
+TouchInfo * Debounce(Contact * contact, TouchInfo * info);
+TouchInfo * Deghost(Contact * contact, TouchInfo * info);
+TouchInfo * SeamHandover(Contact * contact, TouchInfo * info, int32_t seamDistance);
+bool IsObservationFresh(Contact * contact, int sensorIndex, uint64_t now);
+TouchInfo * ConsensusFilter(Contact * contact, TouchInfo * info, int32_t seamDistance);
+float GetSeamWeight(int32_t seamDistance, int32_t crossfade);
+TouchInfo * CoordinatesSmoother(Contact * contact, TouchInfo * info);
+TouchInfo * MotionPredictor(Contact * contact, TouchInfo * info);
+TouchInfo * StateArbitrator(Contact * contact, TouchInfo * info);
+TouchInfo * SpeculativeUp(Contact * contact, TouchInfo * info);
+void RecordUpPendingOutcome(Contact * contact, bool isRetouched);
+bool IsContactBound(Contact * contact);
+TouchInfo * FindHistoryBy(TouchBuffer * buffer, TouchInfo * info, TouchInfoKey key, bool searchSame);
+int32_t GetSeamDistance(TouchInfo * info);
 
 SensorConfiguration * GetSensorConfigurationForSensorPosition(SensorPosition sensorPosition);
+SensorConfiguration * GetLayoutConfiguration(SensorPosition sensorPosition);
+SensorPosition GetOppositeSensorPosition(SensorPosition sensorPosition);
 SensorConfiguration * GetOppositeSensorConfiguration(SensorConfiguration * sensorConfiguration);
 int GetActiveAreaOverlapY(SensorConfiguration * sensorConfig);
+int GetSensorIndex(SensorConfiguration * sensorConfiguration);
+int GetNumberOfActiveSensors(void);
+bool GetSensorArea(SensorConfiguration * sensorConfiguration, int32_t * area);
+void UpdateSensorCoverage(void);
 
 // Local (static) Variables
-static const int    touchBufSize = TOUCH_BUF_SIZE;
-static TouchInfo    touchBuf[TOUCH_BUF_SIZE] = {0};
-static volatile int touchBufPushIndex = 0;
-static volatile int touchBufPopIndex = 0;
-static volatile int touchBufLoad = 0;
- 
-static SensorState         global_sensor_state = SensorStateIdle;
-static SensorConfiguration sensorConfigurations[NUMBER_OF_SENSORS] = { 0 };
+static SensorConfiguration sensorConfigurations[MAX_SENSORS] = { 0 };
+static bool                sensorActive[MAX_SENSORS] = { 0 };    // Touches of the sensor are merged, false if it dropped out or is only known from the layout.
+
+static Contact    contacts[MAX_TRACKED_CONTACTS] = { 0 };
+static uint8_t    sensorBindings[MAX_SENSORS][MAX_CONTACTS] = { { 0 } };  // Contact index + 1 for each sensor touch id, CONTACT_UNBOUND if none.
+static int32_t    contactPositions[MAX_TRACKED_CONTACTS][2] = { { 0 } };    // X and Y of the last touch of each contact.
+static TouchFrame touchFrame = { 0 };
+static uint32_t   nextContactId = 1;
+static float      upRetouchRate = 0.25f;   // Moving average of releases touched again before the timeout, starts pessimistic.
+static float      frameIntervals[MAX_SENSORS] = { 0 };                    // Moving average in microseconds, 0 if unknown.
+static uint32_t   lastTouchTimes[MAX_SENSORS][MAX_CONTACTS] = { { 0 } };  // Sensor time in ms + 1 of the last touch of each sensor touch id, 0 if none.
 
 // Global variables
-bool    globalTriggerTimeout = false;
-int32_t globalTimeoutInMs = GLOBAL_TIMEOUT;
 bool    allSensorConfigurationsReceived = false;
 int     numberOfSensorConfigurationsReceived = 0;
 
@@ -62,39 +126,41 @@ extern volatile bool shutDownNow;
 
 /*  ********** Ring buffer ********** 
  * 
+ *  Every contact keeps the history of its touches in its own ring buffer.
  */
 
 /*  Gets the current push index for the buffer.
  * 
- *  @return touchBufPushIndex.
+ *  @return push index.
 */
-int TouchBufGetCurrentPushIndex()
+int TouchBufGetCurrentPushIndex(TouchBuffer * buffer)
 {
-    return touchBufPushIndex;
+    return buffer->PushIndex;
 }
 
 /*  Sets the pop index to the push index.  */
-void TouchBufSyncPushAndPopIndex()
+void TouchBufSyncPushAndPopIndex(TouchBuffer * buffer)
 {
-    touchBufPopIndex = touchBufPushIndex;
+    buffer->PopIndex = buffer->PushIndex;
 }
 
 /*  Gets the number of elements in buffer.
  * 
- *  @return touchBufLoad.
+ *  @return load.
 */
-int TouchBufGetCurrentLoad()
+int TouchBufGetCurrentLoad(TouchBuffer * buffer)
 {
-    return touchBufLoad;
+    return buffer->Load;
 }
 
 /*  Pops touch at custom position with the option of updating the pop index.
  * 
  *  @return touch, NULL if unsuccessful. 
 */
-TouchInfo * TouchBufPopCustom(int offset, bool updatePopIndex)
+TouchInfo * TouchBufPopCustom(TouchBuffer * buffer, int offset, bool updatePopIndex)
 {
-    int index = touchBufPopIndex + offset;
+    const int touchBufSize = GetSettings()->TouchHistory;
+    int index = buffer->PopIndex + offset;
 
     if(index >= touchBufSize)
     {
@@ -121,95 +187,99 @@ TouchInfo * TouchBufPopCustom(int offset, bool updatePopIndex)
 
     if(updatePopIndex)
     {
-        touchBufPopIndex = index;
+        buffer->PopIndex = index;
     }
 
-    return &touchBuf[index];
+    return &buffer->Touches[index];
 }
 
 /*  Pops last written touch from buffer.
  * 
  *  @return touch, NULL if buffer is empty.
 */
-TouchInfo * TouchBufPopLastWritten()
+TouchInfo * TouchBufPopLastWritten(TouchBuffer * buffer)
 {
-    if(touchBufLoad == 0)
+    if(buffer->Load == 0)
     {
         return NULL;
     }
     
-    return &touchBuf[touchBufPushIndex];
+    return &buffer->Touches[buffer->PushIndex];
 }
 
 /*  Pops touch from buffer and updates the pop index.
  * 
  *  @return touch, NULL if buffer is empty.
 */
-TouchInfo * TouchBufPop()
+TouchInfo * TouchBufPop(TouchBuffer * buffer)
 {
-    if(touchBufLoad == 0)
+    if(buffer->Load == 0)
     {
         return NULL;
     }
 
-    if(--touchBufPopIndex < 0)
+    if(--buffer->PopIndex < 0)
     {
-        touchBufPopIndex = touchBufLoad - 1;
+        buffer->PopIndex = buffer->Load - 1;
     }
 
-    return &touchBuf[touchBufPopIndex];
+    return &buffer->Touches[buffer->PopIndex];
 }
 
 /*  Copies touch to buffer at current push index.
  * 
  *  @return push index.
 */
-int TouchBufRewriteCurrent(TouchInfo * info)
+int TouchBufRewriteCurrent(TouchBuffer * buffer, TouchInfo * info)
 {
-    memcpy(&touchBuf[touchBufPushIndex], info, sizeof(TouchInfo));
-    return touchBufPushIndex;
+    memcpy(&buffer->Touches[buffer->PushIndex], info, sizeof(TouchInfo));
+    return buffer->PushIndex;
 }
 
 /*  Removes current touch.
  * 
  *  @return push index, -1 if buffer is empty.
 */
-int TouchBufEmptyCurrent()
+int TouchBufEmptyCurrent(TouchBuffer * buffer)
 {
-    if(touchBufLoad == 0)
+    const int touchBufSize = GetSettings()->TouchHistory;
+
+    if(buffer->Load == 0)
     {
         return -1;
     }
 
-    if(--touchBufPushIndex < 0)
+    if(--buffer->PushIndex < 0)
     {
-        touchBufLoad--;
-        touchBufPushIndex = touchBufSize;
+        buffer->Load--;
+        buffer->PushIndex = touchBufSize;
     }
-    return touchBufPushIndex;
+    return buffer->PushIndex;
 }
 
 /*  Push a touch to the ring buffer.
  * 
  *  @return push index.
 */
-int TouchBufPush(TouchInfo * info)
+int TouchBufPush(TouchBuffer * buffer, TouchInfo * info)
 {
-    if(touchBufLoad == 0)
+    const int touchBufSize = GetSettings()->TouchHistory;
+
+    if(buffer->Load == 0)
     {
-        touchBufPushIndex = 0;
+        buffer->PushIndex = 0;
     }
-    else if(++touchBufPushIndex >= touchBufSize)
+    else if(++buffer->PushIndex >= touchBufSize)
     {
-        touchBufPushIndex = 0;
+        buffer->PushIndex = 0;
     }
 
-    if(++touchBufLoad > touchBufSize)
+    if(++buffer->Load > touchBufSize)
     {
-        touchBufLoad = touchBufSize;
+        buffer->Load = touchBufSize;
     }
         
-    return TouchBufRewriteCurrent(info);
+    return TouchBufRewriteCurrent(buffer, info);
 }
 
 /*  ********** Touch info processing ********** 
@@ -220,13 +290,13 @@ int TouchBufPush(TouchInfo * info)
  * 
  *  @return history if matched, NULL otherwise.
 */
-TouchInfo * FindHistoryBy(TouchInfo * info, TouchInfoKey key, bool searchSame)
+TouchInfo * FindHistoryBy(TouchBuffer * buffer, TouchInfo * info, TouchInfoKey key, bool searchSame)
 {
-    TouchBufSyncPushAndPopIndex();
+    TouchBufSyncPushAndPopIndex(buffer);
     
-    for(int i = 0; i < TouchBufGetCurrentLoad(); i++)
+    for(int i = 0; i < TouchBufGetCurrentLoad(buffer); i++)
     {
-        TouchInfo *history = TouchBufPop();
+        TouchInfo *history = TouchBufPop(buffer);
         if(key == TouchInfoSensorPosition)
         {
             if(searchSame && info->SensorConfiguration->SensorPosition == history->SensorConfiguration->SensorPosition)
@@ -290,19 +360,19 @@ TouchInfo * FindHistoryBy(TouchInfo * info, TouchInfoKey key, bool searchSame)
     return NULL; // no match.
 }
 
-/*  Checks if touch is closer to opposite sensor in Y-axis.
+/*  Calculates how far past the middle of the overlap with the opposite sensor a touch is, in sensor coordinates.
  * 
- *  @return true if touch is closer to oppsite sensor, false if not.
+ *  @return distance in 1/10 mm, positive when the touch is closer to the opposite sensor.
 */
-bool IsCloserToOppositeSensor(TouchInfo *info)
+int32_t GetSeamDistance(TouchInfo * info)
 {
     int overlapY = GetActiveAreaOverlapY(info->SensorConfiguration);
     if (overlapY < 0)
     {
-        return false;
+        return 0;
     }
 
-    return info->Y > info->SensorConfiguration->TouchActiveAreaHeight - overlapY / 2;
+    return (int32_t)info->Y - ((int32_t)info->SensorConfiguration->TouchActiveAreaHeight - overlapY / 2);
 }
 
 /*    ********** Brief program flow **********
@@ -317,15 +387,21 @@ bool IsCloserToOppositeSensor(TouchInfo *info)
  *                      |   |
  *                      |   |- MapTouchCoordinates
  *                      |   v
+ *                      |   |- AssociateContact
+ *                      |   v
  *                      |   |- Debounce
  *                      |   v
  *                      |   |- StateArbitrator (see state machine flowchart)
  *                      |   v
+ *                      |   |- SeamHandover
+ *                      |   v
+ *                      |   |- ConsensusFilter
+ *                      |   v
  *                      |   |- Deghost
  *                      |   v
- *                      |   |- WeightedPosition
+ *                      |   |- CoordinatesSmoother
  *                      |   v
- *                      --- |- CoordinatesSmoother
+ *                      --- |- MotionPredictor
  *
  */
 
@@ -340,6 +416,13 @@ IndexedMessage * MergeTouch(IndexedMessage * indexedMessage)
 
     TouchMessage * touchMessage = (TouchMessage *)indexedMessage->Message;
     TouchInfo touchNew = {0};
+
+    // Touches still queued from a sensor that dropped out belong to contacts that have been released.
+    if (!IsSensorActive(indexedMessage->SensorConfiguration->SensorPosition))
+    {
+        return NULL;
+    }
+
     CopyTouchInfo(&touchNew, 
                     touchMessage->X, touchMessage->Y, 
                     touchMessage->Event, indexedMessage->Timestamp, 
@@ -351,7 +434,7 @@ IndexedMessage * MergeTouch(IndexedMessage * indexedMessage)
     memcpy(&touchTemp, &touchNew, sizeof(TouchInfo));
     TouchInfo * info = &touchTemp;
 
-    bool isCloserToOppositeSensor = IsCloserToOppositeSensor(info);
+    int32_t seamDistance = GetSeamDistance(info);
 
     info = MapTouchCoordinates(info, &touchNew);
     if (info == NULL)
@@ -361,31 +444,79 @@ IndexedMessage * MergeTouch(IndexedMessage * indexedMessage)
         return NULL;
     }
 
-    TouchBufPush(info);
+    UpdateFrameInterval(info, touchMessage->Id);
+
+    Contact * contact = AssociateContact(info, touchMessage->Id);
+    if (contact == NULL)
+    {
+        return NULL;
+    }
+
+    TouchBufPush(&contact->History, info);
+    contactPositions[contact - contacts][0] = info->X;
+    contactPositions[contact - contacts][1] = info->Y;
     
     // ***** Post procesing touch info data *****
  
-    if(Debounce(info) == NULL)
+    if(Debounce(contact, info) == NULL)
     {
         return NULL;
     }
 
-    if(StateArbitrator(info) == NULL)
+    if(StateArbitrator(contact, info) == NULL)
+    {
+        // An up pending contact may still be reported as released right away, see SpeculativeUp.
+        if(SpeculativeUp(contact, info) == NULL)
+        {
+            return NULL;
+        }
+        return ReportTouch(indexedMessage, contact, info);
+    }
+
+    if(SeamHandover(contact, info, seamDistance) == NULL)
     {
         return NULL;
     }
 
-    if(Deghost(info) == NULL)
+    if(ConsensusFilter(contact, info, seamDistance) == NULL)
     {
         return NULL;
     }
 
-    if (isCloserToOppositeSensor)
+    if(Deghost(contact, info) == NULL)
     {
-        info = WeightedPosition(info);
+        return NULL;
     }
-    
-    info = CoordinatesSmoother(info);
+
+    info = CoordinatesSmoother(contact, info);
+    info = MotionPredictor(contact, info);
+
+    return ReportTouch(indexedMessage, contact, info);
+}
+
+/*  Assigns the contact id, updates the touch frame and writes the processed touch back to the message.
+ * 
+ *  @return indexedMessage, NULL if there is nothing to report.
+*/
+IndexedMessage * ReportTouch(IndexedMessage * indexedMessage, Contact * contact, TouchInfo * info)
+{
+    // The host must see a down event first, also when the down event itself was filtered out.
+    if (!contact->IsReported)
+    {
+        if (info->Event == App_UpEvent)
+        {
+            return NULL;
+        }
+        info->Event = App_DownEvent;
+    }
+
+    if (info->Event == App_DownEvent)
+    {
+        contact->ContactId = nextContactId++;
+    }
+    contact->IsReported = info->Event != App_UpEvent;
+    info->ContactId = contact->ContactId;
+    UpdateTouchFrame(info);
 
     // ***** assemble data back to the indexedMessage *****
     
@@ -393,10 +524,108 @@ IndexedMessage * MergeTouch(IndexedMessage * indexedMessage)
     merged->X = info->X;
     merged->Y = info->Y;
     merged->Event = info->Event;
+    merged->Id = info->ContactId;
 
     return indexedMessage;
 }
 
+/*  Gets the contacts as of the last merged touch or timeout. Contacts released since the previous frame are included
+ *  once with App_UpEvent so the host sees them lift.
+ *
+ *  @return current frame, never NULL.
+*/
+const TouchFrame * GetTouchFrame(void)
+{
+    return &touchFrame;
+}
+
+/*  Gets the touching contacts with their positions extrapolated to given monotonic time in microseconds, for reports
+ *  paced by the report scheduler. Down and up events have already been sent, so all contacts are reported as moves.
+ *  Extrapolation follows the same velocity and direction change handling as MotionPredictor.
+ *
+ *  @return resampled frame, never NULL.
+*/
+const TouchFrame * GetResampledTouchFrame(uint64_t now)
+{
+    static TouchFrame resampledFrame = { 0 };
+    const Settings * settings = GetSettings();
+
+    resampledFrame.NumberOfContacts = 0;
+
+    for (int i = 0; i < touchFrame.NumberOfContacts; i++)
+    {
+        if (touchFrame.Contacts[i].Event == App_UpEvent)
+        {
+            continue;
+        }
+
+        TouchInfo * info = &resampledFrame.Contacts[resampledFrame.NumberOfContacts++];
+        *info = touchFrame.Contacts[i];
+        info->Event = App_MoveEvent;
+
+        Contact * contact = FindReportedContact(info->ContactId);
+        if (contact == NULL || contact->PredictionWeight == 0 || now <= contact->LastUpdate)
+        {
+            continue;
+        }
+
+        float elapsed = MIN(now - contact->LastUpdate, RESAMPLE_MAX_EXTRAPOLATION) / 1000000.0f;
+        float x = info->X + contact->Filter.SpeedX * elapsed * contact->PredictionWeight;
+        float y = info->Y + contact->Filter.SpeedY * elapsed * contact->PredictionWeight;
+
+        info->X = MIN(MAX(x + 0.5f, 0), settings->ScreenWidth);
+        info->Y = MIN(MAX(y + 0.5f, 0), settings->ScreenHeight);
+    }
+
+    return &resampledFrame;
+}
+
+/*  Checks if any contact of the touch frame touches the screen.
+ *
+ *  @return true if touching.
+*/
+bool IsTouchFrameTouching(void)
+{
+    for (int i = 0; i < touchFrame.NumberOfContacts; i++)
+    {
+        if (touchFrame.Contacts[i].Event != App_UpEvent)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*  Updates the contact of given touch in the touch frame, adding it if new. Contacts released in the previous frame are removed.  */
+void UpdateTouchFrame(TouchInfo * info)
+{
+    int count = 0;
+    int index = -1;
+
+    for (int i = 0; i < touchFrame.NumberOfContacts; i++)
+    {
+        if (touchFrame.Contacts[i].Event == App_UpEvent)
+        {
+            continue;
+        }
+        if (touchFrame.Contacts[i].ContactId == info->ContactId)
+        {
+            index = count;
+        }
+        touchFrame.Contacts[count++] = touchFrame.Contacts[i];
+    }
+
+    if (index < 0 && count < MAX_CONTACTS)
+    {
+        index = count++;
+    }
+    if (index >= 0)
+    {
+        touchFrame.Contacts[index] = *info;
+    }
+    touchFrame.NumberOfContacts = count;
+}
+
 /*  Copy parameters into a Touchinfo struct for later processing. */
 void CopyTouchInfo(TouchInfo * dest, 
                     const uint32_t xInput,
@@ -412,6 +641,317 @@ void CopyTouchInfo(TouchInfo * dest,
     dest->SensorConfiguration = configurationInput;
 }
 
+/*  ********** Contact tracking **********
+ *
+ *  Every sensor reports up to tracked-objects touches, each with a touch id of its own. A touch is associated with a
+ *  contact once, on its down event, and then bound to it by sensor index and touch id until its up event. New touches
+ *  are associated with the contact whose predicted position is nearest, within ASSOCIATION_GATE, as long as the contact
+ *  is not already bound to another touch of the same sensor. This is how the same finger seen by two sensors in the
+ *  overlapping area ends up as one contact. Touches that match no contact start a new one.
+ *
+ *  Released contacts are kept for the debounce window so a quick re-press can be debounced against their history.
+ *
+ *  There are at most MAX_TRACKED_CONTACTS contacts, so matching scans all of them. Contacts whose last position is
+ *  further than ASSOCIATION_SEARCH_RADIUS from the touch in either axis are skipped before predicting their position.
+ */
+
+/*  Finds or creates the contact for a touch, and updates the binding of the sensor touch id.
+ *
+ *  @return contact, NULL if all contacts are in use.
+*/
+Contact * AssociateContact(TouchInfo * info, uint32_t sensorTouchId)
+{
+    uint64_t now = MetricsGetTimeMicroSeconds();
+    int sensorIndex = GetSensorIndex(info->SensorConfiguration);
+    uint8_t * binding = (sensorIndex >= 0 && sensorTouchId < MAX_CONTACTS) ? &sensorBindings[sensorIndex][sensorTouchId] : NULL;
+    Contact * contact = NULL;
+
+    if (binding != NULL && *binding != CONTACT_UNBOUND && info->Event != App_DownEvent)
+    {
+        contact = &contacts[*binding - 1];
+    }
+    else
+    {
+        contact = FindNearestContact(info, sensorIndex, now);
+        if (contact == NULL)
+        {
+            contact = AllocateContact(now);
+        }
+        if (contact == NULL)
+        {
+            MetricsIncrement(MetricsCounterContactsExhausted);
+            if (GetSettings()->Verbose)
+            {
+                printf("No free contact for touch %u of sensor %d. \n", sensorTouchId, sensorIndex);
+            }
+            return NULL;
+        }
+        if (binding != NULL)
+        {
+            *binding = (contact - contacts) + 1;
+        }
+    }
+
+    if (binding != NULL && info->Event == App_UpEvent)
+    {
+        *binding = CONTACT_UNBOUND;
+    }
+    contact->LastUpdate = now;
+
+    return contact;
+}
+
+/*  Finds the contact with the predicted position nearest to given touch, within ASSOCIATION_GATE.
+ *
+ *  @return contact, NULL if no contact is near enough.
+*/
+Contact * FindNearestContact(TouchInfo * info, int sensorIndex, uint64_t now)
+{
+    Contact * nearest = NULL;
+    uint64_t nearestDistance = (uint64_t)ASSOCIATION_GATE * ASSOCIATION_GATE;
+
+    for (int i = 0; i < MAX_TRACKED_CONTACTS; i++)
+    {
+        Contact * contact = &contacts[i];
+
+        // The last position is much cheaper to check than the prediction and rules out most contacts.
+        if (!contact->InUse ||
+            abs((int32_t)info->X - contactPositions[i][0]) > ASSOCIATION_SEARCH_RADIUS ||
+            abs((int32_t)info->Y - contactPositions[i][1]) > ASSOCIATION_SEARCH_RADIUS ||
+            IsContactExpired(contact, now) || IsContactBoundToSensor(contact, sensorIndex))
+        {
+            continue;
+        }
+
+        int32_t x, y;
+        PredictPosition(contact, info, &x, &y);
+        uint64_t distance = KernelDistanceSquared(info->X, info->Y, x, y);
+        if (distance <= nearestDistance)
+        {
+            nearest = contact;
+            nearestDistance = distance;
+        }
+    }
+
+    return nearest;
+}
+
+/*  Takes a free contact, reclaiming expired contacts.
+ *
+ *  @return contact, NULL if all contacts are in use.
+*/
+Contact * AllocateContact(uint64_t now)
+{
+    for (int i = 0; i < MAX_TRACKED_CONTACTS; i++)
+    {
+        Contact * contact = &contacts[i];
+        if (contact->InUse && IsContactExpired(contact, now))
+        {
+            FreeContact(contact);
+        }
+        if (!contact->InUse)
+        {
+            memset(contact, 0, sizeof(Contact));
+            contact->InUse = true;
+            contact->State = SensorStateIdle;
+            return contact;
+        }
+    }
+    return NULL;
+}
+
+/*  Returns a contact to the pool and removes all bindings to it.  */
+void FreeContact(Contact * contact)
+{
+    uint8_t index = (contact - contacts) + 1;
+    const int sensors = GetSettings()->Sensors;
+
+    for (int sensor = 0; sensor < sensors; sensor++)
+    {
+        for (int id = 0; id < MAX_CONTACTS; id++)
+        {
+            if (sensorBindings[sensor][id] == index)
+            {
+                sensorBindings[sensor][id] = CONTACT_UNBOUND;
+            }
+        }
+    }
+    contact->InUse = false;
+}
+
+/*  Finds the contact that is reported to the host with given contact id.
+ *
+ *  @return contact, NULL if not found.
+*/
+Contact * FindReportedContact(uint32_t contactId)
+{
+    for (int i = 0; i < MAX_TRACKED_CONTACTS; i++)
+    {
+        if (contacts[i].InUse && contacts[i].IsReported && contacts[i].ContactId == contactId)
+        {
+            return &contacts[i];
+        }
+    }
+    return NULL;
+}
+
+/*  Checks if a contact that is not touching has been left alone for longer than the debounce interval.
+ *
+ *  @return true if the contact can be reclaimed.
+*/
+bool IsContactExpired(Contact * contact, uint64_t now)
+{
+    if (contact->State != SensorStateIdle && contact->State != SesnorStateDownPending)
+    {
+        return false;
+    }
+    return now - contact->LastUpdate > (uint64_t)GetDebounceInterval() * 1000;
+}
+
+/*  Checks if any touch of given sensor is bound to the contact.
+ *
+ *  @return true if bound.
+*/
+bool IsContactBoundToSensor(Contact * contact, int sensorIndex)
+{
+    uint8_t index = (contact - contacts) + 1;
+
+    if (sensorIndex < 0)
+    {
+        return false;
+    }
+
+    for (int id = 0; id < MAX_CONTACTS; id++)
+    {
+        if (sensorBindings[sensorIndex][id] == index)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*  Predicts the position of a contact at the time of given touch, assuming constant velocity since its last two touches.
+ *  The step from the last position is limited to half the association gate in each axis, see ASSOCIATION_SEARCH_RADIUS.
+*/
+void PredictPosition(Contact * contact, TouchInfo * info, int32_t * x, int32_t * y)
+{
+    TouchBufSyncPushAndPopIndex(&contact->History);
+    TouchInfo * last = TouchBufPopLastWritten(&contact->History);
+    TouchInfo * previous = TouchBufGetCurrentLoad(&contact->History) > 1 ? TouchBufPop(&contact->History) : NULL;
+
+    if (last == NULL)
+    {
+        *x = info->X;
+        *y = info->Y;
+        return;
+    }
+
+    *x = last->X;
+    *y = last->Y;
+
+    if (previous != NULL && previous->Event != App_UpEvent && last->Event != App_UpEvent)
+    {
+        uint32_t interval = GetTimestampDiff(last, previous);
+        uint32_t elapsed = GetTimestampDiff(info, last);
+        if (interval > 0 && elapsed < (uint32_t)GetDebounceInterval())
+        {
+            int32_t stepX = ((int32_t)last->X - (int32_t)previous->X) * (int32_t)elapsed / (int32_t)interval;
+            int32_t stepY = ((int32_t)last->Y - (int32_t)previous->Y) * (int32_t)elapsed / (int32_t)interval;
+            *x += MAX(-ASSOCIATION_GATE / 2, MIN(stepX, ASSOCIATION_GATE / 2));
+            *y += MAX(-ASSOCIATION_GATE / 2, MIN(stepY, ASSOCIATION_GATE / 2));
+        }
+    }
+}
+
+/*  ********** Sensor frame rate **********
+ *
+ *  The up pending timeout and the debounce window have to cover a few sensor frames without a touch, which is much
+ *  less than the up-timeout and debounce-interval settings at high finger frequencies. The frame interval of every sensor is
+ *  measured online from consecutive touches of the same touch id and averaged over FRAME_INTERVAL_WINDOW frames. The
+ *  windows are then the up-timeout-frames and debounce-frames settings times the interval of the slowest sensor,
+ *  between MIN_TIMEOUT and the fixed maximum. Until a sensor has reported touches its finger frequency is used, if known.
+ */
+
+/*  Measures the frame interval of the sensor of given touch on the sensor timestamps, so queueing delays of the sensor
+ *  and group threads do not show up as frame intervals.
+ */
+void UpdateFrameInterval(TouchInfo * info, uint32_t sensorTouchId)
+{
+    int sensorIndex = GetSensorIndex(info->SensorConfiguration);
+    uint32_t now = GetMillisecond(info->Timestamp);
+
+    if (sensorIndex < 0 || sensorTouchId >= MAX_CONTACTS)
+    {
+        return;
+    }
+
+    uint32_t * lastTouchTime = &lastTouchTimes[sensorIndex][sensorTouchId];
+    uint32_t interval = now - (*lastTouchTime - 1);
+
+    // Intervals across a release or a gap in the touches of the sensor are not frame intervals. The sensor time wraps
+    // every hour, the interval is then out of range too.
+    if (*lastTouchTime != 0 && info->Event != App_DownEvent && interval > 0 && interval < (uint32_t)GetSettings()->UpTimeout)
+    {
+        float * average = &frameIntervals[sensorIndex];
+        *average = *average == 0 ? interval * 1000.0f : *average + (interval * 1000.0f - *average) / FRAME_INTERVAL_WINDOW;
+    }
+
+    *lastTouchTime = info->Event == App_UpEvent ? 0 : now + 1;
+}
+
+/*  Seeds the frame interval estimate of a sensor from its finger frequency in Hz, until frames have been measured.  */
+void SetSensorFingerFrequency(SensorConfiguration * sensorConfiguration, uint32_t frequency)
+{
+    int sensorIndex = GetSensorIndex(sensorConfiguration);
+
+    if (sensorIndex >= 0 && frequency > 0 && frameIntervals[sensorIndex] == 0)
+    {
+        frameIntervals[sensorIndex] = 1000000.0f / frequency;
+    }
+}
+
+/*  Gets the up pending timeout, a number of frame periods of the slowest sensor.
+ *
+ *  @return timeout in milliseconds.
+*/
+int32_t GetUpTimeout(void)
+{
+    return GetFramePeriods(GetSettings()->UpTimeoutFrames, GetSettings()->UpTimeout);
+}
+
+/*  Gets the debounce window, a number of frame periods of the slowest sensor.
+ *
+ *  @return window in milliseconds.
+*/
+int32_t GetDebounceInterval(void)
+{
+    return GetFramePeriods(GetSettings()->DebounceFrames, GetSettings()->DebounceInterval);
+}
+
+/*  Gets the duration of a number of frame periods of the slowest sensor, limited to MIN_TIMEOUT and given maximum.
+ *
+ *  @return duration in milliseconds, maxTimeout if no frame interval is known or periods is 0.
+*/
+int32_t GetFramePeriods(int32_t periods, int32_t maxTimeout)
+{
+    float slowest = 0;
+    const int sensors = GetSettings()->Sensors;
+
+    for (int i = 0; i < sensors; i++)
+    {
+        slowest = MAX(slowest, frameIntervals[i]);
+    }
+
+    if (periods <= 0 || slowest == 0)
+    {
+        return maxTimeout;
+    }
+
+    int32_t timeout = (int32_t)(periods * slowest / 1000 + 0.999f);
+    return MIN(MAX(timeout, MIN_TIMEOUT), maxTimeout);
+}
+
 /*  ********** Sensor orientations **********
  *
  *     HORIZONTAL 1            HORIZONTAL 0 (i.e. vertical)
@@ -437,7 +977,7 @@ void CopyTouchInfo(TouchInfo * dest,
 */
 TouchInfo * MapTouchCoordinates(TouchInfo *output, TouchInfo *input)
 {
-    if (SENSOR_ORIENTATION_HORIZONTAL)
+    if (GetSettings()->HorizontalSensors)
     {
         if (output->SensorConfiguration->SensorPosition == SensorPositionTopLeft)
         {
@@ -446,7 +986,7 @@ TouchInfo * MapTouchCoordinates(TouchInfo *output, TouchInfo *input)
         }
         else if (output->SensorConfiguration->SensorPosition == SensorPositionTopRight)
         {
-            SensorConfiguration * topLeftConfig = GetSensorConfigurationForSensorPosition(SensorPositionTopLeft);
+            SensorConfiguration * topLeftConfig = GetLayoutConfiguration(SensorPositionTopLeft);
             if (topLeftConfig == NULL)
             {
                 return NULL;
@@ -458,7 +998,7 @@ TouchInfo * MapTouchCoordinates(TouchInfo *output, TouchInfo *input)
         }
         else if (output->SensorConfiguration->SensorPosition == SensorPositionBottomLeft)
         {
-            SensorConfiguration * topLeftConfig = GetSensorConfigurationForSensorPosition(SensorPositionTopLeft);
+            SensorConfiguration * topLeftConfig = GetLayoutConfiguration(SensorPositionTopLeft);
             if (topLeftConfig == NULL)
             {
                 return NULL;
@@ -475,8 +1015,8 @@ TouchInfo * MapTouchCoordinates(TouchInfo *output, TouchInfo *input)
         }
         else if (output->SensorConfiguration->SensorPosition == SensorPositionBottomRight)
         {
-            SensorConfiguration * bottomLeftConfig = GetSensorConfigurationForSensorPosition(SensorPositionBottomLeft);
-            SensorConfiguration * topRightConfig = GetSensorConfigurationForSensorPosition(SensorPositionTopRight);
+            SensorConfiguration * bottomLeftConfig = GetLayoutConfiguration(SensorPositionBottomLeft);
+            SensorConfiguration * topRightConfig = GetLayoutConfiguration(SensorPositionTopRight);
             if (bottomLeftConfig == NULL  || topRightConfig == NULL)
             {
                 return NULL;
@@ -509,7 +1049,7 @@ TouchInfo * MapTouchCoordinates(TouchInfo *output, TouchInfo *input)
         }
         else if (output->SensorConfiguration->SensorPosition == SensorPositionTopRight)
         {
-            SensorConfiguration * topLeftConfig = GetSensorConfigurationForSensorPosition(SensorPositionTopLeft);
+            SensorConfiguration * topLeftConfig = GetLayoutConfiguration(SensorPositionTopLeft);
             if (topLeftConfig == NULL)
             {
                 return NULL;
@@ -527,7 +1067,7 @@ TouchInfo * MapTouchCoordinates(TouchInfo *output, TouchInfo *input)
         }
         else if (output->SensorConfiguration->SensorPosition == SensorPositionBottomLeft)
         {
-            SensorConfiguration * topLeftConfig = GetSensorConfigurationForSensorPosition(SensorPositionTopLeft);
+            SensorConfiguration * topLeftConfig = GetLayoutConfiguration(SensorPositionTopLeft);
             if (topLeftConfig == NULL)
             {
                 return NULL;
@@ -540,8 +1080,8 @@ TouchInfo * MapTouchCoordinates(TouchInfo *output, TouchInfo *input)
         }
         else if (output->SensorConfiguration->SensorPosition == SensorPositionBottomRight)
         {
-            SensorConfiguration * topRightConfig = GetSensorConfigurationForSensorPosition(SensorPositionTopRight);
-            SensorConfiguration * bottomLeftConfig = GetSensorConfigurationForSensorPosition(SensorPositionBottomLeft);
+            SensorConfiguration * topRightConfig = GetLayoutConfiguration(SensorPositionTopRight);
+            SensorConfiguration * bottomLeftConfig = GetLayoutConfiguration(SensorPositionBottomLeft);
             if (topRightConfig == NULL || bottomLeftConfig == NULL)
             {
                 return NULL;
@@ -574,36 +1114,45 @@ TouchInfo * MapTouchCoordinates(TouchInfo *output, TouchInfo *input)
  * 
  *  @return processed info, NULL if touch meets condition of unwanted touch.
 */
-TouchInfo * Debounce(TouchInfo *info)
+TouchInfo * Debounce(Contact * contact, TouchInfo *info)
 {
     // search for different event
-    TouchInfo * history = FindHistoryBy(info, TouchInfoEvent, SEARCH_UNMATCH);
+    TouchInfo * history = FindHistoryBy(&contact->History, info, TouchInfoEvent, SEARCH_UNMATCH);
 
     if (history == NULL)
         return info;
 
-    if (GetTimestampDiff(info, history) < DEBOUNCE_INTERVAL)
+    if (GetTimestampDiff(info, history) < (uint32_t)GetDebounceInterval())
     {
         if (info->Event == App_UpEvent && history->Event == App_DownEvent)
         {
-            if (verbose)
+            if (GetSettings()->Verbose)
             {
                 printf("Debounce removed up event. \n");
             }
 
             info->Event = App_MoveEvent;
-            TouchBufRewriteCurrent(info);
+            TouchBufRewriteCurrent(&contact->History, info);
+            MetricsIncrement(MetricsCounterDebounceDrops);
+
+            // The touch id is unbound, so no later touch of it releases the contact. Leave the release to the up
+            // timeout unless another sensor still tracks the contact, a quick re-press continues it.
+            if (!IsContactBound(contact))
+            {
+                HandleStateUpPending(contact);
+            }
             return NULL;
         }
         else if (info->Event == App_DownEvent && history->Event == App_UpEvent)
         {
-            if (verbose)
+            if (GetSettings()->Verbose)
             {
                 printf("Debounce removed down event. \n");
             }
 
             info->Event = App_MoveEvent;
-            TouchBufRewriteCurrent(info);
+            TouchBufRewriteCurrent(&contact->History, info);
+            MetricsIncrement(MetricsCounterDebounceDrops);
             return NULL;
         }
     }
@@ -618,7 +1167,7 @@ TouchInfo * Debounce(TouchInfo *info)
  * 
  *  @return processed info, NULL if touch meets condition of unwanted touch.
 */
-TouchInfo * Deghost(TouchInfo *info)
+TouchInfo * Deghost(Contact * contact, TouchInfo *info)
 {
     if (info->Event == App_UpEvent)
     {
@@ -626,8 +1175,8 @@ TouchInfo * Deghost(TouchInfo *info)
     }
 
     // ***** search for different event *****
-    TouchBufSyncPushAndPopIndex();
-    TouchInfo * history = TouchBufPop();
+    TouchBufSyncPushAndPopIndex(&contact->History);
+    TouchInfo * history = TouchBufPop(&contact->History);
 
     if (history == NULL)
     {
@@ -639,9 +1188,11 @@ TouchInfo * Deghost(TouchInfo *info)
         return info;
     }
 
-    float distance = sqrtf(pow(abs(info->X - history->X), 2) +
-                           pow(abs(info->Y - history->Y), 2)) /
-                     10;
+    int32_t dx = (int32_t)info->X - (int32_t)history->X;
+    int32_t dy = (int32_t)info->Y - (int32_t)history->Y;
+
+    // Only needed for printing, the speed check below compares squares.
+    float distance = GetSettings()->Verbose ? sqrtf(KernelDistanceSquared(0, 0, dx, dy)) / 10 : 0;
 
     uint32_t time_diff = GetTimestampDiff(info, history);
 
@@ -650,11 +1201,12 @@ TouchInfo * Deghost(TouchInfo *info)
         time_diff = 1;
     }
 
-    if (distance / time_diff > 5)
+    if (KernelIsFasterThan(dx, dy, time_diff, GetSettings()->DeghostSpeedLimit))
     { // too fast movement is sketchy, do not put into the buffer.
-        TouchBufEmptyCurrent();
+        TouchBufEmptyCurrent(&contact->History);
+        MetricsIncrement(MetricsCounterDeghostDrops);
 
-        if (verbose)
+        if (GetSettings()->Verbose)
         {
             printf("\ndeghost %f mm for %d ms\t\t\tx %d\ty %d\n", distance, time_diff, info->X, info->Y);
         }
@@ -665,14 +1217,14 @@ TouchInfo * Deghost(TouchInfo *info)
     {
         if (time_diff > 100)
         { // very long interval
-            if (verbose)
+            if (GetSettings()->Verbose)
             {
                 printf("t0 %d, t-1 %d\n", GetMillisecond(info->Timestamp), GetMillisecond(history->Timestamp));
             }
         }
         if (distance > 0 && info->Event != App_DownEvent)
         {
-            if (verbose)
+            if (GetSettings()->Verbose)
             {
                 printf("%f mm for %d ms\n", distance, time_diff);
             }
@@ -682,83 +1234,300 @@ TouchInfo * Deghost(TouchInfo *info)
     return info;
 }
 
-/*  Make a weight adjusted position in the overlapping zone among sensors.
- *  The basic concept is to trust the positon coming from a closer sensor.
+/*  ********** Seam handover **********
+ *
+ *  Where the active areas of opposite sensors overlap, a contact is usually seen by both of them, each with its own
+ *  small offset. Every contact has an owner sensor whose touches drive the reports, touches of the other sensor only
+ *  update its observation of the contact. The owner hands over to the other sensor once the contact is more than the
+ *  seam-hysteresis setting past the middle of the overlap, or when the owner no longer sees the contact, so a finger
+ *  resting on the seam does not flip between the sensors.
+ *
+ *  The reported position fuses the fresh observations of all sensors, each weighted by how far it is on its own side
+ *  of the seam. The weight of a sensor fades from 1 to 0 over the seam-crossfade distance centred on the middle of the
+ *  overlap, so the position moves continuously from one sensor to the other instead of jumping at the seam.
+ */
+
+/*  Updates the observation of the touch sensor, hands the contact over between sensors and fuses the observations
+ *  into the reported position. The history is rewritten with the fused position so later stages see a continuous track.
  * 
- *  @return processed info.
+ *  @return processed info, NULL if the touch is from a sensor that does not own the contact.
 */
-TouchInfo * WeightedPosition(TouchInfo * info)
+TouchInfo * SeamHandover(Contact * contact, TouchInfo * info, int32_t seamDistance)
 {
-    TouchInfo * history = FindHistoryBy(info, TouchInfoSensorPosition, SEARCH_UNMATCH);
-    if(history != NULL && history->Event != App_UpEvent)
+    const Settings * settings = GetSettings();
+    int sensorIndex = GetSensorIndex(info->SensorConfiguration);
+    uint64_t now = MetricsGetTimeMicroSeconds();
+
+    if (sensorIndex < 0 || info->Event == App_UpEvent)
+    {
+        return info;
+    }
+
+    SeamObservation * observation = &contact->Observations[sensorIndex];
+    observation->X = info->X;
+    observation->Y = info->Y;
+    observation->SeamDistance = seamDistance;
+    observation->Time = now;
+
+    int owner = contact->OwnerSensor - 1;
+
+    if (owner < 0 || !IsObservationFresh(contact, owner, now))
+    {
+        contact->OwnerSensor = sensorIndex + 1;
+    }
+    else if (owner != sensorIndex &&
+             (contact->Observations[owner].SeamDistance > settings->SeamHysteresis || seamDistance < -settings->SeamHysteresis))
     {
-        if(verbose)
+        if (GetSettings()->Verbose)
         {
-            printf("was %d now %d\n", info->X, (info->X + history->X * 4) / 5);
+            printf("handover from %s to %s\n", GetSensorPositionName(sensorConfigurations[owner].SensorPosition),
+                GetSensorPositionName(info->SensorConfiguration->SensorPosition));
         }
-        info->X = (info->X + history->X * 4) / 5; // use 20% of current position and 80% of history.
-        info->Y = (info->Y + history->Y * 4) / 5; // use 20% of current position and 80% of history.
+        contact->OwnerSensor = sensorIndex + 1;
     }
-    
+
+    int overlapY = GetActiveAreaOverlapY(info->SensorConfiguration);
+    int32_t crossfade = (settings->SeamCrossfade > 0 && settings->SeamCrossfade < overlapY) ? settings->SeamCrossfade : overlapY;
+    float sumX = 0;
+    float sumY = 0;
+    float sumWeight = 0;
+
+    for (int i = 0; i < settings->Sensors; i++)
+    {
+        if (!IsObservationFresh(contact, i, now))
+        {
+            continue;
+        }
+
+        float weight = GetSeamWeight(contact->Observations[i].SeamDistance, crossfade);
+        sumX += weight * contact->Observations[i].X;
+        sumY += weight * contact->Observations[i].Y;
+        sumWeight += weight;
+    }
+
+    if (sumWeight > 0)
+    {
+        info->X = sumX / sumWeight + 0.5f;
+        info->Y = sumY / sumWeight + 0.5f;
+        TouchBufRewriteCurrent(&contact->History, info);
+    }
+
+    // Only moves are left to the owner, down and up events are needed by the state of the contact.
+    if (contact->OwnerSensor != sensorIndex + 1 && info->Event == App_MoveEvent)
+    {
+        return NULL;
+    }
+
     return info;
 }
 
-/*  Smooth the eventual coordinates by a simple rolling average method.
+/*  Holds back a new contact that starts inside an overlap until the opposite sensor sees it too. A point only one of
+ *  two sensors reports where both should see it is most likely stray light. The contact is rejected if no confirmation
+ *  arrives within the consensus-window setting, which is the latency cost for real touches in the overlap. Touches
+ *  outside the overlaps and contacts that have already been reported are never delayed.
  * 
- *  @return processed info.
+ *  @return processed info, NULL while waiting for confirmation or if rejected.
 */
-TouchInfo * CoordinatesSmoother(TouchInfo * info)
-{   // Rolling average the coordinates.
-    int xTotal = info->X;
-    int yTotal = info->Y;
-    const uint32_t sampleSize = 8;
-    uint32_t samples = 1;
-
-    TouchBufSyncPushAndPopIndex();
-    for(uint32_t i = 0; i < sampleSize - 1; i++)
-    {
-        TouchInfo * history = TouchBufPop();
-        if(history != NULL && (history->Event == App_MoveEvent || history->Event == App_DownEvent))
+TouchInfo * ConsensusFilter(Contact * contact, TouchInfo * info, int32_t seamDistance)
+{
+    const int32_t window = GetSettings()->ConsensusWindow;
+    uint64_t now = MetricsGetTimeMicroSeconds();
+    int overlapY = GetActiveAreaOverlapY(info->SensorConfiguration);
+
+    if (window <= 0 || contact->IsReported || info->Event == App_UpEvent || overlapY <= 0 || seamDistance < -overlapY / 2)
+    {
+        return info;
+    }
+
+    // Nothing can confirm the touch while the opposite sensor is missing.
+    if (!IsSensorActive(GetOppositeSensorPosition(info->SensorConfiguration->SensorPosition)))
+    {
+        contact->ConsensusDeadline = 0;
+        return info;
+    }
+
+    int observers = 0;
+    const int sensors = GetSettings()->Sensors;
+    for (int i = 0; i < sensors; i++)
+    {
+        if (IsObservationFresh(contact, i, now))
         {
-            samples++;
-            xTotal += history->X;
-            yTotal += history->Y;
+            observers++;
         }
-        else
+    }
+
+    if (observers > 1)
+    {
+        contact->ConsensusDeadline = 0;
+        return info;
+    }
+
+    if (contact->ConsensusDeadline == 0)
+    {
+        contact->ConsensusDeadline = now + (uint64_t)window * 1000;
+    }
+    else if (now > contact->ConsensusDeadline)
+    {
+        if (contact->ConsensusDeadline != UINT64_MAX)
         {
-            break;
+            MetricsIncrement(MetricsCounterConsensusRejects);
+            if (GetSettings()->Verbose)
+            {
+                printf("consensus reject\tx %d\ty %d\n", info->X, info->Y);
+            }
         }
+        contact->ConsensusDeadline = UINT64_MAX; // Count a rejected contact once.
+    }
+
+    return NULL;
+}
+
+/*  Checks if a sensor has seen a contact recently and still tracks it.
+ *
+ *  @return true if the observation of the sensor can be used.
+*/
+bool IsObservationFresh(Contact * contact, int sensorIndex, uint64_t now)
+{
+    const SeamObservation * observation = &contact->Observations[sensorIndex];
+
+    return observation->Time != 0 &&
+           now - observation->Time <= SEAM_FUSION_WINDOW &&
+           IsContactBoundToSensor(contact, sensorIndex);
+}
+
+/*  Calculates the fusion weight of an observation from its distance past the middle of the overlap.
+ *
+ *  @return weight from 1 on the sensor's own side to 0 on the opposite side.
+*/
+float GetSeamWeight(int32_t seamDistance, int32_t crossfade)
+{
+    if (crossfade <= 0)
+    {
+        return seamDistance > 0 ? 0.0f : 1.0f;
+    }
+
+    float weight = 0.5f - (float)seamDistance / crossfade;
+    return MIN(MAX(weight, 0.0f), 1.0f);
+}
+
+/*  Smooth the eventual coordinates with a speed adaptive One Euro filter, see OneEuroFilter.h.
+ *  The filter starts over for every new contact.
+ * 
+ *  @return processed info.
+*/
+TouchInfo * CoordinatesSmoother(Contact * contact, TouchInfo * info)
+{
+    const Settings * settings = GetSettings();
+    const OneEuroParameters parameters =
+    {
+        .MinCutoff = settings->SmoothingMinCutoff,
+        .Beta = settings->SmoothingBeta,
+        .DerivateCutoff = settings->SmoothingDerivateCutoff
+    };
+
+    if (!contact->IsReported)
+    {
+        OneEuroFilterReset(&contact->Filter);
+    }
+
+    float elapsed = (GetMillisecond(info->Timestamp) - GetMillisecond(contact->FilterTimestamp)) / 1000.0f;
+    float x = info->X;
+    float y = info->Y;
+    OneEuroFilterApply(&contact->Filter, &parameters, elapsed, &x, &y);
+    contact->FilterTimestamp = info->Timestamp;
+
+    info->X = x + 0.5f;
+    info->Y = y + 0.5f;
+
+    if(GetSettings()->Verbose)
+    {
+        printf("elapsed %f\tx %d\ty %d\n", elapsed, info->X, info->Y);
+    }
+
+    return info;
+}
+
+/*  Extrapolate the smoothed position by the prediction-horizon setting along the velocity estimated by the smoother.
+ *  This hides the sensor scan period, the up timeout and the USB transfer from the perceived lag during drags.
+ *  The prediction is dropped as soon as the finger moves against the estimated velocity and fades back in over
+ *  PREDICTION_RAMP_TOUCHES touches, so turning fingers do not overshoot.
+ * 
+ *  @return processed info.
+*/
+TouchInfo * MotionPredictor(Contact * contact, TouchInfo * info)
+{
+    const Settings * settings = GetSettings();
+    const float horizon = settings->PredictionHorizon / 1000.0f;
+    const float x = contact->Filter.X;
+    const float y = contact->Filter.Y;
+    const float speedX = contact->Filter.SpeedX;
+    const float speedY = contact->Filter.SpeedY;
+
+    if (!contact->IsReported || info->Event != App_MoveEvent)
+    {
+        contact->PredictionWeight = 0;
+    }
+    else if ((x - contact->SmoothedX) * speedX + (y - contact->SmoothedY) * speedY < 0)
+    { // direction change, the velocity estimate lags behind.
+        contact->PredictionWeight = 0;
+    }
+    else
+    {
+        contact->PredictionWeight = MIN(contact->PredictionWeight + 1.0f / PREDICTION_RAMP_TOUCHES, 1.0f);
+    }
+    contact->SmoothedX = x;
+    contact->SmoothedY = y;
+
+    if (horizon <= 0 || contact->PredictionWeight == 0)
+    {
+        return info;
     }
 
-    info->X = xTotal / samples;
-    info->Y = yTotal / samples;
+    float offsetX = speedX * horizon * contact->PredictionWeight;
+    float offsetY = speedY * horizon * contact->PredictionWeight;
+    float distance = sqrtf(offsetX * offsetX + offsetY * offsetY);
 
-    if(verbose)
+    if (distance > PREDICTION_MAX_DISTANCE)
     {
-        printf("size %d\tx %d\ty %d\n", samples, info->X, info->Y);
+        offsetX *= PREDICTION_MAX_DISTANCE / distance;
+        offsetY *= PREDICTION_MAX_DISTANCE / distance;
+    }
+
+    info->X = MIN(MAX(x + offsetX + 0.5f, 0), settings->ScreenWidth);
+    info->Y = MIN(MAX(y + offsetY + 0.5f, 0), settings->ScreenHeight);
+
+    if(GetSettings()->Verbose)
+    {
+        printf("predict %f %f\tx %d\ty %d\n", offsetX, offsetY, info->X, info->Y);
     }
 
     return info;
 }
 
 /*  Adds sensor configuration to internal array and sets flag when all configurations are added. The configuartions are used for mapping coordniates.
+ *  A sensor position that was removed or only added as layout before is activated again with the new configuration.
  * 
  *  @return true on success, false on fail.
 */
 bool AddSensorConfiguration(SensorConfiguration sensorConfiguration)
 {
-    for (int i = 0; i < numberOfSensorConfigurationsReceived; i++)
+    int index = GetSensorIndex(&sensorConfiguration);
+
+    if (index >= 0 && sensorActive[index])
     {
-        if (sensorConfigurations[i].SensorPosition == sensorConfiguration.SensorPosition)
-        {
-            printf("Error: duplicate configurations of sensor position: %s. \n", GetSensorPositionName(sensorConfiguration.SensorPosition));
-            return false;
-        }
+        printf("Error: duplicate configurations of sensor position: %s. \n", GetSensorPositionName(sensorConfiguration.SensorPosition));
+        return false;
     }
 
-    sensorConfigurations[numberOfSensorConfigurationsReceived++] = sensorConfiguration;
+    if (index < 0)
+    {
+        index = numberOfSensorConfigurationsReceived++;
+    }
+    sensorConfigurations[index] = sensorConfiguration;
+    sensorActive[index] = true;
+    UpdateSensorCoverage();
 
-    if (numberOfSensorConfigurationsReceived == NUMBER_OF_SENSORS)
+    if (GetNumberOfActiveSensors() == GetSettings()->Sensors)
     {
         allSensorConfigurationsReceived = true;
         printf("Sensor configurations done. \n");
@@ -767,68 +1536,198 @@ bool AddSensorConfiguration(SensorConfiguration sensorConfiguration)
     return true;
 }
 
-/*  Gets the sensor configuration for a certain sensor position. 
- * 
- *  @return SensorConfiguration * if found, NULL otherwise.
+/*  Adds the size of a sensor that is not connected, e.g. from sensor_positions.csv, so the other sensors are laid out
+ *  as usual while it is missing. Ignored if the sensor position was added before.
 */
-SensorConfiguration * GetSensorConfigurationForSensorPosition(SensorPosition sensorPosition)
+void AddSensorLayout(SensorConfiguration sensorConfiguration)
 {
-    for (int i = 0; i < NUMBER_OF_SENSORS; i++)
+    if (GetSensorIndex(&sensorConfiguration) >= 0 || numberOfSensorConfigurationsReceived >= GetSettings()->Sensors)
     {
-        if (sensorConfigurations[i].SensorPosition == sensorPosition)
-        {
-            return &sensorConfigurations[i];
-        }
+        return;
     }
-    return NULL;
+
+    sensorConfigurations[numberOfSensorConfigurationsReceived++] = sensorConfiguration;
+    UpdateSensorCoverage();
 }
 
-/*  Gets the sensor configuration opposite of given configuration in Y axis.
+/*  Takes a sensor that dropped out out of merging. Its configuration is kept for the layout of the other sensors, and
+ *  the contacts no other sensor tracks are released on the next TimeoutCallback.
  * 
- *  @return SensorConfiguration * if found, NULL otherwise.
+ *  @return true on success, false if the sensor position is not active.
 */
-SensorConfiguration * GetOppositeSensorConfiguration(SensorConfiguration * sensorConfiguration)
+bool RemoveSensorConfiguration(SensorPosition sensorPosition)
 {
-    if (SENSOR_ORIENTATION_HORIZONTAL)
+    SensorConfiguration sensorConfiguration = { .SensorPosition = sensorPosition };
+    int index = GetSensorIndex(&sensorConfiguration);
+
+    if (index < 0 || !sensorActive[index])
     {
-        if (sensorConfiguration->SensorPosition == SensorPositionTopLeft)
+        return false;
+    }
+
+    sensorActive[index] = false;
+    allSensorConfigurationsReceived = false;
+
+    for (int i = 0; i < MAX_TRACKED_CONTACTS; i++)
+    {
+        Contact * contact = &contacts[i];
+        if (!contact->InUse || !IsContactBoundToSensor(contact, index))
         {
-            return GetSensorConfigurationForSensorPosition(SensorPositionBottomLeft);
+            continue;
         }
-        else if (sensorConfiguration->SensorPosition == SensorPositionTopRight)
+
+        for (int id = 0; id < MAX_CONTACTS; id++)
         {
-            return GetSensorConfigurationForSensorPosition(SensorPositionBottomRight);
+            if (sensorBindings[index][id] == i + 1)
+            {
+                sensorBindings[index][id] = CONTACT_UNBOUND;
+            }
         }
-        else if (sensorConfiguration->SensorPosition == SensorPositionBottomLeft)
+        contact->Observations[index].Time = 0;
+        if (contact->OwnerSensor == index + 1)
         {
-            return GetSensorConfigurationForSensorPosition(SensorPositionTopLeft);
+            contact->OwnerSensor = 0;
         }
-        else if (sensorConfiguration->SensorPosition == SensorPositionBottomRight)
+
+        // The sensor will not send the up event, release right away unless another sensor still tracks the contact.
+        if (!IsContactBound(contact) && contact->State != SensorStateIdle && contact->State != SensorStateUp)
         {
-            return GetSensorConfigurationForSensorPosition(SensorPositionTopRight);
+            contact->State = SensorStateUpPending;
+            contact->IsReleasing = false;
+            TriggerTimeout(contact, 0);
         }
     }
-    else
+
+    memset(lastTouchTimes[index], 0, sizeof(lastTouchTimes[index]));
+    UpdateSensorCoverage();
+
+    printf("Sensor position %s removed, %d of %d sensors active. \n", GetSensorPositionName(sensorPosition),
+        GetNumberOfActiveSensors(), GetSettings()->Sensors);
+
+    return true;
+}
+
+/*  Updates the touch active area of a sensor configuration added before.
+ * 
+ *  @return true on success, false if the sensor position was not added.
+*/
+bool UpdateSensorConfiguration(SensorConfiguration sensorConfiguration)
+{
+    int index = GetSensorIndex(&sensorConfiguration);
+
+    if (index < 0)
     {
-        if (sensorConfiguration->SensorPosition == SensorPositionTopLeft)
-        {
-            return GetSensorConfigurationForSensorPosition(SensorPositionTopRight);
-        }
-        else if (sensorConfiguration->SensorPosition == SensorPositionTopRight)
-        {
-            return GetSensorConfigurationForSensorPosition(SensorPositionTopLeft);
-        }
-        else if (sensorConfiguration->SensorPosition == SensorPositionBottomLeft)
+        return false;
+    }
+
+    sensorConfigurations[index].TouchActiveAreaWidth = sensorConfiguration.TouchActiveAreaWidth;
+    sensorConfigurations[index].TouchActiveAreaHeight = sensorConfiguration.TouchActiveAreaHeight;
+    UpdateSensorCoverage();
+
+    return true;
+}
+
+/*  Gets the sensor configuration for a certain sensor position. 
+ * 
+ *  @return SensorConfiguration * if found, NULL otherwise.
+*/
+SensorConfiguration * GetSensorConfigurationForSensorPosition(SensorPosition sensorPosition)
+{
+    for (int i = 0; i < numberOfSensorConfigurationsReceived; i++)
+    {
+        if (sensorConfigurations[i].SensorPosition == sensorPosition)
         {
-            return GetSensorConfigurationForSensorPosition(SensorPositionBottomRight);
+            return &sensorConfigurations[i];
         }
-        else if (sensorConfiguration->SensorPosition == SensorPositionBottomRight)
+    }
+    return NULL;
+}
+
+/*  Gets the sensor configuration used to lay out the other sensors. A sensor position that has never been added, a
+ *  sensor missing since start that is not in sensor_positions.csv, is assumed to be the same size as the first sensor.
+ * 
+ *  @return SensorConfiguration *, NULL if no sensor has been added.
+*/
+SensorConfiguration * GetLayoutConfiguration(SensorPosition sensorPosition)
+{
+    SensorConfiguration * sensorConfiguration = GetSensorConfigurationForSensorPosition(sensorPosition);
+
+    if (sensorConfiguration == NULL && numberOfSensorConfigurationsReceived > 0)
+    {
+        sensorConfiguration = &sensorConfigurations[0];
+    }
+    return sensorConfiguration;
+}
+
+/*  Gets the index of a sensor among the received sensor configurations.
+ * 
+ *  @return index, -1 if not found.
+*/
+int GetSensorIndex(SensorConfiguration * sensorConfiguration)
+{
+    for (int i = 0; i < numberOfSensorConfigurationsReceived; i++)
+    {
+        if (sensorConfigurations[i].SensorPosition == sensorConfiguration->SensorPosition)
         {
-            return GetSensorConfigurationForSensorPosition(SensorPositionBottomLeft);
+            return i;
         }
     }
+    return -1;
+}
 
-    return NULL;
+/*  Checks if the touches of a sensor position are merged.
+ * 
+ *  @return true if the sensor is active.
+*/
+bool IsSensorActive(SensorPosition sensorPosition)
+{
+    SensorConfiguration sensorConfiguration = { .SensorPosition = sensorPosition };
+    int index = GetSensorIndex(&sensorConfiguration);
+
+    return index >= 0 && sensorActive[index];
+}
+
+/*  Gets the number of sensors whose touches are merged.
+ * 
+ *  @return number of active sensors.
+*/
+int GetNumberOfActiveSensors(void)
+{
+    int count = 0;
+    for (int i = 0; i < numberOfSensorConfigurationsReceived; i++)
+    {
+        count += sensorActive[i] ? 1 : 0;
+    }
+    return count;
+}
+
+/*  Gets the sensor position opposite of given position in Y axis.
+ * 
+ *  @return opposite sensor position.
+*/
+SensorPosition GetOppositeSensorPosition(SensorPosition sensorPosition)
+{
+    switch (sensorPosition)
+    {
+        case SensorPositionTopLeft:
+            return GetSettings()->HorizontalSensors ? SensorPositionBottomLeft : SensorPositionTopRight;
+        case SensorPositionTopRight:
+            return GetSettings()->HorizontalSensors ? SensorPositionBottomRight : SensorPositionTopLeft;
+        case SensorPositionBottomLeft:
+            return GetSettings()->HorizontalSensors ? SensorPositionTopLeft : SensorPositionBottomRight;
+        case SensorPositionBottomRight:
+        default:
+            return GetSettings()->HorizontalSensors ? SensorPositionTopRight : SensorPositionBottomLeft;
+    }
+}
+
+/*  Gets the sensor configuration opposite of given configuration in Y axis, see GetLayoutConfiguration.
+ * 
+ *  @return SensorConfiguration * if found, NULL otherwise.
+*/
+SensorConfiguration * GetOppositeSensorConfiguration(SensorConfiguration * sensorConfiguration)
+{
+    return GetLayoutConfiguration(GetOppositeSensorPosition(sensorConfiguration->SensorPosition));
 }
 
 /*  Calculates the overlap in Y axis between given sensor configuration and it's Y axis opposite configuration.
@@ -845,7 +1744,8 @@ int GetActiveAreaOverlapY(SensorConfiguration * sensorConfig)
         return -1;
     }
 
-    int hostActiveAreaHeight = SENSOR_ORIENTATION_HORIZONTAL ? hostScreenHeight : hostScreenWidth;
+    const Settings * settings = GetSettings();
+    int hostActiveAreaHeight = settings->HorizontalSensors ? settings->ScreenHeight : settings->ScreenWidth;
 
     int overlapY = (hostActiveAreaHeight - sensorConfig->TouchActiveAreaHeight - oppositeConfig->TouchActiveAreaHeight);
 
@@ -859,6 +1759,87 @@ int GetActiveAreaOverlapY(SensorConfiguration * sensorConfig)
     return abs(overlapY);
 }
 
+/*  Gets the part of the screen a sensor covers, by mapping the corners of its touch active area.
+ * 
+ *  @return true on success with left, top, right and bottom in area, false if the sensor can not be laid out.
+*/
+bool GetSensorArea(SensorConfiguration * sensorConfiguration, int32_t * area)
+{
+    TouchInfo corners[2] = { { .X = 0, .Y = 0 }, { .X = 0, .Y = 0 } };
+    corners[1].X = sensorConfiguration->TouchActiveAreaWidth;
+    corners[1].Y = sensorConfiguration->TouchActiveAreaHeight;
+
+    for (int i = 0; i < 2; i++)
+    {
+        TouchInfo input = corners[i];
+        input.SensorConfiguration = sensorConfiguration;
+        corners[i].SensorConfiguration = sensorConfiguration;
+        if (MapTouchCoordinates(&corners[i], &input) == NULL)
+        {
+            return false;
+        }
+    }
+
+    area[0] = MIN(corners[0].X, corners[1].X);
+    area[1] = MIN(corners[0].Y, corners[1].Y);
+    area[2] = MAX(corners[0].X, corners[1].X);
+    area[3] = MAX(corners[0].Y, corners[1].Y);
+
+    return true;
+}
+
+/*  Samples which parts of the screen no active sensor covers and publishes the uncovered fraction and its bounds as
+ *  metrics. Called whenever a sensor is added, removed or resized, never per touch.
+*/
+void UpdateSensorCoverage(void)
+{
+    int32_t areas[MAX_SENSORS][4];
+    int numberOfAreas = 0;
+    const int32_t screenWidth = GetSettings()->ScreenWidth;
+    const int32_t screenHeight = GetSettings()->ScreenHeight;
+    int32_t bounds[4] = { screenWidth, screenHeight, 0, 0 };
+    int uncovered = 0;
+
+    for (int i = 0; i < numberOfSensorConfigurationsReceived; i++)
+    {
+        if (sensorActive[i] && GetSensorArea(&sensorConfigurations[i], areas[numberOfAreas]))
+        {
+            numberOfAreas++;
+        }
+    }
+
+    for (int row = 0; row < COVERAGE_GRID; row++)
+    {
+        for (int column = 0; column < COVERAGE_GRID; column++)
+        {
+            // Sample the center of the cell.
+            int32_t x = (2 * column + 1) * screenWidth / (2 * COVERAGE_GRID);
+            int32_t y = (2 * row + 1) * screenHeight / (2 * COVERAGE_GRID);
+            bool isCovered = false;
+
+            for (int i = 0; i < numberOfAreas && !isCovered; i++)
+            {
+                isCovered = x >= areas[i][0] && x <= areas[i][2] && y >= areas[i][1] && y <= areas[i][3];
+            }
+
+            if (!isCovered)
+            {
+                uncovered++;
+                bounds[0] = MIN(bounds[0], column * screenWidth / COVERAGE_GRID);
+                bounds[1] = MIN(bounds[1], row * screenHeight / COVERAGE_GRID);
+                bounds[2] = MAX(bounds[2], (column + 1) * screenWidth / COVERAGE_GRID);
+                bounds[3] = MAX(bounds[3], (row + 1) * screenHeight / COVERAGE_GRID);
+            }
+        }
+    }
+
+    if (uncovered == 0)
+    {
+        memset(bounds, 0, sizeof(bounds));
+    }
+    MetricsSetUncoveredArea((float)uncovered / (COVERAGE_GRID * COVERAGE_GRID), bounds[0], bounds[1], bounds[2], bounds[3]);
+}
+
 /*    ********** State machine [StateArbitrator] ********** 
  *
  *      Idle  ->  DownPending  ->  Down  ---------
@@ -870,166 +1851,315 @@ int GetActiveAreaOverlapY(SensorConfiguration * sensorConfig)
  *        -------------------------------------  Up
  */
 
-/*  State machine for handling touches from multiple sensors.
+/*  Transition table of the state machine, indexed by current state and input. Being constant, the compiler can fold
+ *  it into the lookup of StateArbitrator.
+*/
+static const StateTransition stateTransitions[SENSOR_STATE_COUNT][StateInputCount] =
+{
+    [SensorStateIdle] =
+    {
+        [StateInputDown]    = { SesnorStateDownPending, StateActionNone },
+        [StateInputMove]    = { SesnorStateDownPending, StateActionNone },
+        [StateInputUp]      = { SensorStateIdle, StateActionError },
+        [StateInputInvalid] = { SensorStateIdle, StateActionError }
+    },
+    [SesnorStateDownPending] =
+    {
+        [StateInputDown]    = { SensorStateDown, StateActionNone },
+        [StateInputMove]    = { SensorStateDown, StateActionNone },
+        [StateInputUp]      = { SensorStateUpPending, StateActionUpPending },
+        [StateInputInvalid] = { SensorStateIdle, StateActionError }
+    },
+    [SensorStateDown] =
+    {
+        [StateInputDown]    = { SensorStateMove, StateActionNone },
+        [StateInputMove]    = { SensorStateMove, StateActionNone },
+        [StateInputUp]      = { SensorStateUpPending, StateActionUpPending },
+        [StateInputInvalid] = { SensorStateIdle, StateActionError }
+    },
+    [SensorStateMove] =
+    {
+        [StateInputDown]    = { SensorStateMove, StateActionNone },
+        [StateInputMove]    = { SensorStateMove, StateActionNone },
+        [StateInputUp]      = { SensorStateUpPending, StateActionUpPending },
+        [StateInputInvalid] = { SensorStateIdle, StateActionError }
+    },
+    [SensorStateUpPending] =
+    {
+        [StateInputDown]    = { SensorStateMove, StateActionRetouch },
+        [StateInputMove]    = { SensorStateMove, StateActionRetouch },
+        [StateInputUp]      = { SensorStateUp, StateActionRelease },
+        [StateInputInvalid] = { SensorStateIdle, StateActionError }
+    },
+    [SensorStateUp] =
+    {
+        [StateInputDown]    = { SensorStateUp, StateActionDebounceUpPending },
+        [StateInputMove]    = { SensorStateUp, StateActionDebounceUpPending },
+        [StateInputUp]      = { SensorStateUp, StateActionNone },
+        [StateInputInvalid] = { SensorStateUp, StateActionNone }
+    }
+};
+
+/*  Events reported for the states that are reported to the host, App_InvalidEvent for states that are not.  */
+static const ApplicationTouchEvent stateEvents[SENSOR_STATE_COUNT] =
+{
+    [SensorStateIdle]           = App_InvalidEvent,
+    [SesnorStateDownPending]    = App_InvalidEvent,
+    [SensorStateDown]           = App_DownEvent,
+    [SensorStateMove]           = App_MoveEvent,
+    [SensorStateUpPending]      = App_InvalidEvent,
+    [SensorStateUp]             = App_UpEvent
+};
+
+/*  State machine for handling touches from multiple sensors. Every contact runs its own state machine, driven by the
+ *  stateTransitions table. Every transition is counted in the metrics.
  * 
- *  @return processed info, NULL if error occurs.
+ *  @return processed info, NULL if the touch is not reported or error occurs.
 */
-TouchInfo * StateArbitrator(TouchInfo * info)
+TouchInfo * StateArbitrator(Contact * contact, TouchInfo * info)
 {
-    SensorState state = MapTouchstateToSensorstate(info);
-    
-    if(global_sensor_state == SensorStateIdle)
+    StateInput input = MapTouchEventToStateInput(info);
+    const StateTransition * transition = &stateTransitions[contact->State][input];
+
+    MetricsStateTransition(contact->State, input);
+    contact->State = transition->Next;
+
+    switch (transition->Action)
     {
-        if(state == SensorStateDown || state == SensorStateMove)
-        {
-            global_sensor_state = SesnorStateDownPending;
-        }
-        else
-        {
-            PrintStateArbitratorError(info);
+        case StateActionNone:
+        break;
+        case StateActionUpPending:
+            TriggerTimeout(contact, GetUpTimeout());
+        break;
+        case StateActionRetouch:
+            contact->Deadline = 0;
+            RecordUpPendingOutcome(contact, true);
+        break;
+        case StateActionRelease:
+            RecordUpPendingOutcome(contact, false);
+        break;
+        case StateActionDebounceUpPending:
+            if (Debounce(contact, info) != NULL)
+            {
+                HandleStateUpPending(contact);
+            }
+        break;
+        case StateActionError:
+            HandleStateError(contact, info);
             return NULL;
-        }
     }
 
-    else if(global_sensor_state == SesnorStateDownPending)
+    ApplicationTouchEvent event = stateEvents[contact->State];
+    if (event == App_InvalidEvent)
     {
-        if(state == SensorStateDown || state == SensorStateMove)
-        {
-            global_sensor_state = SensorStateDown;
-        }
-        else if(state == SensorStateUp)
-        {
-            // Debounce(); // TODO: deal with Up without Down.
-            HandleStateUpPending();
-        }
-        else
-        {
-            PrintStateArbitratorError(info);
-            return NULL;
-        }
+        return NULL;
     }
 
-    else if(global_sensor_state == SensorStateDown || global_sensor_state == SensorStateMove)
+    info->Event = event;
+    if (event == App_UpEvent)
     {
-        if(state == SensorStateDown || state == SensorStateMove)
-        {
-            global_sensor_state = SensorStateMove;
-        }
-        else if(state == SensorStateUp)
-        {
-            HandleStateUpPending();
-        }
-        else
-        {
-            PrintStateArbitratorError(info);
-            return NULL;
-        }
+        HandleStateReset(contact);
     }
+    TouchBufRewriteCurrent(&contact->History, info);
 
-    else if(global_sensor_state == SensorStateUpPending)
+    return info;
+}
+
+/*  Reports an up pending contact as released right away instead of after the up timeout, when the speculative-up
+ *  setting is on. If the contact is touched again before the timeout the up was interference, and the contact is
+ *  corrected by reporting it pressed again with a new down event. Whether speculation pays off depends on how often
+ *  an installation sees such interference, so it is only done while the measured re-touch rate of releases is below
+ *  the speculative-up-max-rate setting. The rate is measured whether speculating or not.
+ *
+ *  Only releases of the last sensor tracking the contact are candidates, an up from one sensor of an overlap while
+ *  the other still sees the finger is not a release.
+ * 
+ *  @return processed info with App_UpEvent, NULL if the up is left to the timeout.
+*/
+TouchInfo * SpeculativeUp(Contact * contact, TouchInfo * info)
+{
+    const Settings * settings = GetSettings();
+
+    if (contact->State != SensorStateUpPending || info->Event != App_UpEvent || IsContactBound(contact))
     {
-        if(state == SensorStateDown || state == SensorStateMove)
-        {
-            global_sensor_state = SensorStateMove;
-        }
-        else if(state == SensorStateUp)
-        {
-            global_sensor_state = SensorStateUp;
-        }
-        else
-        {
-            PrintStateArbitratorError(info);
-            return NULL;
-        }
+        return NULL;
     }
 
-    else if(global_sensor_state == SensorStateUp)
+    contact->IsReleasing = true;
+
+    if (!settings->SpeculativeUp || !contact->IsReported || upRetouchRate > settings->SpeculativeUpMaxRate)
     {
-        if(state == SensorStateDown || state == SensorStateMove)
+        return NULL;
+    }
+
+    // Release at the last reported position, the position of an up event is not reliable.
+    for (int i = 0; i < touchFrame.NumberOfContacts; i++)
+    {
+        if (touchFrame.Contacts[i].ContactId == contact->ContactId)
         {
-            if(Debounce(info) != NULL)
-            {
-                HandleStateUpPending();
-            }
+            info->X = touchFrame.Contacts[i].X;
+            info->Y = touchFrame.Contacts[i].Y;
         }
     }
-    else
+
+    contact->IsSpeculativelyUp = true;
+    MetricsIncrement(MetricsCounterSpeculativeUps);
+
+    return info;
+}
+
+/*  Updates the re-touch rate when an up pending contact is either touched again or released.  */
+void RecordUpPendingOutcome(Contact * contact, bool isRetouched)
+{
+    if (contact->IsReleasing)
     {
-        PrintStateArbitratorError(info);
-        return NULL;
+        upRetouchRate += ((isRetouched ? 1.0f : 0.0f) - upRetouchRate) / UP_RETOUCH_RATE_WINDOW;
+    }
+
+    if (isRetouched)
+    {
+        MetricsIncrement(MetricsCounterUpRetouches);
     }
 
-    if(global_sensor_state == SensorStateDown || global_sensor_state == SensorStateMove || global_sensor_state == SensorStateUp)
+    if (isRetouched && contact->IsSpeculativelyUp)
     {
-        switch(global_sensor_state)
+        MetricsIncrement(MetricsCounterSpeculativeCorrections);
+        if (GetSettings()->Verbose)
         {
-            case SensorStateDown: info->Event = App_DownEvent; break;
-            case SensorStateMove: info->Event = App_MoveEvent; break;
-            case SensorStateUp: info->Event = App_UpEvent; HandleStateReset(); break;
-            default: PrintStateArbitratorError(info); return NULL;
+            printf("speculative up corrected, re-touch rate %f\n", upRetouchRate);
         }
-        TouchBufRewriteCurrent(info); 
     }
-    else
+
+    contact->IsReleasing = false;
+    contact->IsSpeculativelyUp = false;
+}
+
+/*  Checks if any touch of any sensor is bound to the contact.
+ *
+ *  @return true if bound.
+*/
+bool IsContactBound(Contact * contact)
+{
+    const int sensors = GetSettings()->Sensors;
+
+    for (int i = 0; i < sensors; i++)
     {
-        return NULL;
+        if (IsContactBoundToSensor(contact, i))
+        {
+            return true;
+        }
     }
+    return false;
+}
 
-    return info;
+/*  Sets the time when an up pending contact is released unless it is touched again.  */
+void TriggerTimeout(Contact * contact, int32_t timeout)
+{
+    contact->Deadline = MetricsGetTimeMicroSeconds() + (uint64_t)timeout * 1000;
 }
 
-/*  Sets the timeout flags.  */
-void TriggerTimeout(int32_t timeout)
+/*  Gets the time until the next up pending contact times out.
+ *
+ *  @return timeout in milliseconds, -1 if no contact is up pending.
+*/
+int32_t GetTimeoutInMs(void)
 {
-    globalTriggerTimeout = true;
-    globalTimeoutInMs = timeout;
+    uint64_t deadline = 0;
+
+    for (int i = 0; i < MAX_TRACKED_CONTACTS; i++)
+    {
+        if (contacts[i].InUse && contacts[i].Deadline != 0 && (deadline == 0 || contacts[i].Deadline < deadline))
+        {
+            deadline = contacts[i].Deadline;
+        }
+    }
+
+    if (deadline == 0)
+    {
+        return -1;
+    }
+
+    uint64_t now = MetricsGetTimeMicroSeconds();
+    return deadline > now ? (int32_t)((deadline - now + 999) / 1000) : 0;
 }
 
-/*  Timeout handle function. Resets the internal state machine.  */
-void TimeoutCallback()
+/*  Timeout handle function. Releases the up pending contacts whose timeout has expired.
+ *
+ *  @return true if any contact was released and the touch frame should be sent.
+*/
+bool TimeoutCallback(void)
 {
-    global_sensor_state = SensorStateUp;
-    TouchInfo * info = TouchBufPopLastWritten();
-    info->Event = App_UpEvent;
-    TouchBufRewriteCurrent(info); 
-    HandleStateReset();
+    uint64_t now = MetricsGetTimeMicroSeconds();
+    bool released = false;
+
+    for (int i = 0; i < MAX_TRACKED_CONTACTS; i++)
+    {
+        Contact * contact = &contacts[i];
+        if (!contact->InUse || contact->Deadline == 0 || contact->Deadline > now)
+        {
+            continue;
+        }
+
+        MetricsIncrement(MetricsCounterTimeouts);
+        RecordUpPendingOutcome(contact, false);
+        contact->State = SensorStateUp;
+        TouchInfo * info = TouchBufPopLastWritten(&contact->History);
+        info->Event = App_UpEvent;
+        info->ContactId = contact->ContactId;
+        TouchBufRewriteCurrent(&contact->History, info);
+        HandleStateReset(contact);
+
+        if (contact->IsReported)
+        {
+            contact->IsReported = false;
+            UpdateTouchFrame(info);
+            released = true;
+        }
+    }
+
+    return released;
 }
 
-/*  Convert touch events to state machine events.
+/*  Convert touch events to state machine inputs.
  * 
- *  @return processed state.
+ *  @return state machine input.
 */
-SensorState MapTouchstateToSensorstate(TouchInfo * info)
+StateInput MapTouchEventToStateInput(TouchInfo * info)
 {
-    SensorState state = SensorStateIdle;
     switch(info->Event)
     {
-        case App_DownEvent: state = SensorStateDown; break;
-        case App_MoveEvent: state = SensorStateMove; break;
-        case App_UpEvent: state = SensorStateUp; break;
-        default: break;
+        case App_DownEvent: return StateInputDown;
+        case App_MoveEvent: return StateInputMove;
+        case App_UpEvent: return StateInputUp;
+        default: return StateInputInvalid;
     }
-    return state;
 }
 
-/*  Sets the internal state to up pending and triggers timeout.  */ 
-void HandleStateUpPending()
+/*  Sets the contact state to up pending and triggers timeout.  */ 
+void HandleStateUpPending(Contact * contact)
 {
-    global_sensor_state = SensorStateUpPending;
-    TriggerTimeout(GLOBAL_TIMEOUT);
+    contact->State = SensorStateUpPending;
+    TriggerTimeout(contact, GetUpTimeout());
 }
 
-/*  Resets the internal state to idle.  */ 
-void HandleStateReset()
+/*  Resets the contact state to idle.  */ 
+void HandleStateReset(Contact * contact)
 {
-    global_sensor_state = SensorStateIdle;
+    contact->State = SensorStateIdle;
+    contact->Deadline = 0;
+    contact->ConsensusDeadline = 0;
 }
 
-/*  Print out state machine error for given touch.  */ 
-void PrintStateArbitratorError(TouchInfo * info)
+/*  Counts a state machine error for given touch and resets the contact.  */ 
+void HandleStateError(Contact * contact, TouchInfo * info)
 {
-    global_sensor_state = SensorStateIdle;
-    printf("Error: Faulty StateArbitrator touch state: %s\t", GetTouchStateName(info->Event));
+    MetricsIncrement(MetricsCounterStateArbitratorErrors);
+    HandleStateReset(contact);
+
+    if (GetSettings()->Verbose)
+    {
+        printf("Error: Faulty StateArbitrator touch state: %s\n", GetTouchStateName(info->Event));
+    }
 }
 
 /*  ********** Helper functions ********** 
@@ -4,11 +4,20 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "Utility.h"
+#include "OneEuroFilter.h"
 
-#define DEBOUNCE_INTERVAL (100)
-#define GLOBAL_TIMEOUT (100)
+#define MIN_TIMEOUT (20)                            // Shortest up pending timeout and debounce window in ms.
+#define FRAME_INTERVAL_WINDOW 16                    // Number of sensor frames the measured frame interval is averaged over.
 #define SEARCH_MATCH 1
 #define SEARCH_UNMATCH 0
+#define MAX_TRACKED_CONTACTS (MAX_CONTACTS * 2)     // Contacts being tracked, including pending and recently released ones.
+#define ASSOCIATION_GATE 300                        // Maximum distance in 1/10 mm between a touch and the predicted position of the contact it is associated with.
+#define PREDICTION_MAX_DISTANCE 150                 // Maximum distance in 1/10 mm a position is extrapolated by motion prediction.
+#define PREDICTION_RAMP_TOUCHES 4                   // Number of touches over which motion prediction fades back in after a direction change.
+#define RESAMPLE_MAX_EXTRAPOLATION 20000            // Maximum microseconds a paced report extrapolates a contact past its last touch.
+#define SEAM_FUSION_WINDOW 50000                    // Microseconds a sensor observation of a contact is used for fusion in the overlap.
+#define COVERAGE_GRID 60                            // Samples per axis of the screen area covered by the active sensors, reported as metrics.
+#define UP_RETOUCH_RATE_WINDOW 16                   // Number of releases the re-touch rate for speculative up events is averaged over.
 
 typedef enum SensorState
 {
@@ -20,17 +29,79 @@ typedef enum SensorState
     SensorStateUp
 }SensorState;
 
-extern bool    globalTriggerTimeout;
-extern int32_t globalTimeoutInMs;
+#define SENSOR_STATE_COUNT (SensorStateUp + 1)
+
+typedef struct TouchBuffer
+{
+    TouchInfo Touches[MAX_TOUCH_BUF_SIZE];     // The touch-history setting gives the number used.
+    int       PushIndex;
+    int       PopIndex;
+    int       Load;
+} TouchBuffer;
+
+typedef struct SeamObservation
+{
+    int32_t     X;              // Mapped position of the latest touch of the sensor.
+    int32_t     Y;
+    int32_t     SeamDistance;   // Distance in 1/10 mm past the middle of the overlap, negative on the sensor's own side.
+    uint64_t    Time;           // Monotonic time in microseconds of the observation, 0 if none.
+} SeamObservation;
+
+typedef struct Contact
+{
+    bool        InUse;
+    bool        IsReported;     // A down event has been sent to the host and no up event yet.
+    SensorState State;
+    uint32_t    ContactId;      // Global contact id, new for every down event.
+    uint64_t    Deadline;       // Monotonic time in microseconds when the up pending contact is released, 0 if not pending.
+    uint64_t    LastUpdate;     // Monotonic time in microseconds of the last touch associated with the contact.
+    TouchBuffer History;
+    OneEuroFilter Filter;       // Smoothing state of the reported position.
+    uint64_t    FilterTimestamp;// Timestamp of the last filtered touch.
+    float       PredictionWeight;   // 0 to 1, how much of the prediction horizon is applied.
+    float       SmoothedX;          // Smoothed position of the previous touch, used to detect direction changes.
+    float       SmoothedY;
+    uint8_t     OwnerSensor;        // Sensor index + 1 of the sensor whose touches drive the reports, 0 if none.
+    uint64_t    ConsensusDeadline;  // Monotonic time in microseconds until a new contact in an overlap waits for confirmation, 0 if not waiting.
+    bool        IsReleasing;        // Up pending because no sensor tracks the contact any more.
+    bool        IsSpeculativelyUp;  // Up pending and already reported released, see SpeculativeUp.
+    SeamObservation Observations[MAX_SENSORS];
+} Contact;
+
 extern bool    allSensorConfigurationsReceived;
 extern int     numberOfSensorConfigurationsReceived;
 
 /*  Adds sensor configuration to internal array and sets flag when all configurations are added. The configuartions are used for mapping coordniates.
+ *  A sensor position that was removed or only added as layout before is activated again with the new configuration.
  * 
  *  @return true on success, false on fail.
 */
 bool AddSensorConfiguration(SensorConfiguration sensorConfiguration);
 
+/*  Adds the size of a sensor that is not connected, e.g. from sensor_positions.csv, so the other sensors are laid out
+ *  as usual while it is missing. Ignored if the sensor position was added before.
+*/
+void AddSensorLayout(SensorConfiguration sensorConfiguration);
+
+/*  Takes a sensor that dropped out out of merging. Its configuration is kept for the layout of the other sensors, and
+ *  the contacts no other sensor tracks are released on the next TimeoutCallback.
+ * 
+ *  @return true on success, false if the sensor position is not active.
+*/
+bool RemoveSensorConfiguration(SensorPosition sensorPosition);
+
+/*  Checks if the touches of a sensor position are merged.
+ * 
+ *  @return true if the sensor is active.
+*/
+bool IsSensorActive(SensorPosition sensorPosition);
+
+/*  Updates the touch active area of a sensor configuration added before.
+ * 
+ *  @return true on success, false if the sensor position was not added.
+*/
+bool UpdateSensorConfiguration(SensorConfiguration sensorConfiguration);
+
 /*  Merge touch and process the touch according to the above flowchart.
  *  This is the single entry point for incoming touch.
  * 
@@ -38,35 +109,55 @@ bool AddSensorConfiguration(SensorConfiguration sensorConfiguration);
 */
 IndexedMessage * MergeTouch(IndexedMessage * indexedMessage);
 
+/*  Gets the contacts as of the last merged touch or timeout. Contacts released since the previous frame are included
+ *  once with App_UpEvent so the host sees them lift.
+ *
+ *  @return current frame, never NULL.
+*/
+const TouchFrame * GetTouchFrame(void);
+
+/*  Gets the touching contacts with their positions extrapolated to given monotonic time in microseconds, for reports
+ *  paced by the report scheduler. Down and up events have already been sent, so all contacts are reported as moves.
+ *
+ *  @return resampled frame, never NULL.
+*/
+const TouchFrame * GetResampledTouchFrame(uint64_t now);
+
+/*  Checks if any contact of the touch frame touches the screen.
+ *
+ *  @return true if touching.
+*/
+bool IsTouchFrameTouching(void);
+
 /*  Gets the current push index for the buffer.
  * 
- *  @return touchBufPushIndex.
+ *  @return push index.
 */
-int TouchBufGetCurrentPushIndex(void);
+int TouchBufGetCurrentPushIndex(TouchBuffer * buffer);
 
 /*  Pops touch at custom position with the option of updating the pop index.
  * 
  *  @return touch, NULL if unsuccessful. 
 */
-TouchInfo * TouchBufPopCustom(int offset, bool updatePopIndex);
+TouchInfo * TouchBufPopCustom(TouchBuffer * buffer, int offset, bool updatePopIndex);
 
 /*  Pops last written touch from buffer.
  * 
  *  @return touch, NULL if buffer is empty.
 */
-TouchInfo * TouchBufPopLastWritten(void);
+TouchInfo * TouchBufPopLastWritten(TouchBuffer * buffer);
 
 /*  Pops touch from buffer and updates the pop index.
  * 
  *  @return touch, NULL if buffer is empty.
 */
-TouchInfo * TouchBufPop(void);
+TouchInfo * TouchBufPop(TouchBuffer * buffer);
 
 /*  Push a touch to the buffer and updates the push index.
  * 
  *  @return push index.
 */
-int TouchBufPush(TouchInfo * info);
+int TouchBufPush(TouchBuffer * buffer, TouchInfo * info);
 
 /*  Copy parameters into a Touchinfo struct for later processing. */
 void CopyTouchInfo(TouchInfo * dest, 
@@ -76,11 +167,41 @@ void CopyTouchInfo(TouchInfo * dest,
                     const uint64_t timestampInput,
                     SensorConfiguration * configurationInput);
 
-/*  Timeout handle function. Resets the internal state machine.  */
-void TimeoutCallback(void);
+/*  Timeout handle function. Releases the up pending contacts whose timeout has expired.
+ *
+ *  @return true if any contact was released and the touch frame should be sent.
+*/
+bool TimeoutCallback(void);
+
+/*  Seeds the frame interval estimate of a sensor from its finger frequency in Hz, until frames have been measured.  */
+void SetSensorFingerFrequency(SensorConfiguration * sensorConfiguration, uint32_t frequency);
+
+/*  Gets the up pending timeout, a number of frame periods of the slowest sensor.
+ *
+ *  @return timeout in milliseconds.
+*/
+int32_t GetUpTimeout(void);
+
+/*  Gets the debounce window, a number of frame periods of the slowest sensor.
+ *
+ *  @return window in milliseconds.
+*/
+int32_t GetDebounceInterval(void);
+
+/*  Gets the duration of a number of frame periods of the slowest sensor, limited to MIN_TIMEOUT and given maximum.
+ *
+ *  @return duration in milliseconds, maxTimeout if no frame interval is known or periods is 0.
+*/
+int32_t GetFramePeriods(int32_t periods, int32_t maxTimeout);
+
+/*  Gets the time until the next up pending contact times out.
+ *
+ *  @return timeout in milliseconds, -1 if no contact is up pending.
+*/
+int32_t GetTimeoutInMs(void);
 
-/*  Sets the timeout flags.  */
-void TriggerTimeout(int32_t timeout);
+/*  Sets the time when an up pending contact is released unless it is touched again.  */
+void TriggerTimeout(Contact * contact, int32_t timeout);
 
 /*  Prints out the timestamp and state for a touch.  */
 void DumpTouchInfo(TouchInfo * info);
@@ -0,0 +1,654 @@
+#include "Metrics.h"
+#include "Settings.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <grp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <zForce.h>
+
+#define METRICS_BUFFER_SIZE 8192
+#define METRICS_RATE_INTERVAL 1000     // Interval in ms for updating the per sensor message rates.
+#define METRICS_MAX_THREADS 16         // Threads with counters of their own, any further threads share the last block.
+#define METRICS_CACHE_LINE 64
+
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+
+/*  Counters of one thread. Every thread increments only its own block, which starts on a cache line of its own, so the
+ *  sensor threads and the touch path never share a cache line. A scrape sums the blocks of all threads.
+ */
+typedef struct MetricsThreadCounters
+{
+    uint64_t Counters[MetricsCounterCount];
+    uint64_t SensorMessages[MAX_SENSORS];
+    uint64_t QueueEnqueued[MetricsQueueCount];
+    uint64_t QueueDequeued[MetricsQueueCount];
+    uint64_t LatencyBuckets[MetricsStageCount][METRICS_LATENCY_BUCKETS];
+    uint64_t LatencySum[MetricsStageCount];
+    uint64_t StateTransitions[METRICS_STATES][METRICS_STATE_INPUTS];
+} __attribute__((aligned(METRICS_CACHE_LINE))) MetricsThreadCounters;
+
+typedef struct MetricsBuffer
+{
+    char   Data[METRICS_BUFFER_SIZE];
+    size_t Length;
+} MetricsBuffer;
+
+static void MetricsThread(void * parameters);
+static void MetricsUpdateRates(void);
+static void MetricsWriteSnapshot(int fd);
+static void MetricsAppend(MetricsBuffer * buffer, const char * format, ...);
+static int LatencyBucketIndex(uint64_t microSeconds);
+static uint64_t LatencyBucketUpperBound(int index);
+static uint64_t LatencyQuantile(MetricsStage stage, double quantile);
+static MetricsThreadCounters * GetThreadCounters(void);
+static uint64_t SumThreads(const uint64_t * field);
+
+// Counters, only accessed through relaxed atomics so the touch path never waits for a scrape.
+static MetricsThreadCounters threadCounters[METRICS_MAX_THREADS];
+static uint32_t numberOfThreadCounters = 0;
+static __thread MetricsThreadCounters * ownCounters = NULL;    // Block of the calling thread, NULL until it counts.
+
+// Gauges, only accessed through relaxed atomics.
+static uint64_t bringUpDurations[MAX_SENSORS][METRICS_BRINGUP_STEPS] = { { 0 } };
+static uint64_t reconnectDurations[MAX_SENSORS] = { 0 };
+static bool     sensorActive[MAX_SENSORS] = { 0 };
+static uint32_t uncoveredArea = 10000;          // Uncovered fraction of the screen in 1/10000.
+static int32_t  uncoveredBounds[4] = { 0 };     // Left, top, right and bottom in 1/10 mm, set to the whole screen by MetricsStart.
+static uint64_t replayTime = 0;                 // Time in microseconds returned instead of the monotonic clock, 0 if none.
+
+// Only accessed by the metrics thread.
+static uint64_t sensorMessagesLastSample[MAX_SENSORS] = { 0 };
+static double   sensorMessagesPerSecond[MAX_SENSORS] = { 0 };
+static uint64_t lastRateSampleTime = 0;
+static uint64_t startTime = 0;
+
+static zForceThread * metricsThread = NULL;
+static volatile bool  metricsShutDownNow = false;
+static int            listenSocket = -1;
+static char           listenSocketPath[sizeof(((struct sockaddr_un *)0)->sun_path)] = { 0 };
+
+static const char * counterNames[MetricsCounterCount] =
+{
+    "debounce_drops_total",
+    "deghost_drops_total",
+    "state_arbitrator_errors_total",
+    "up_timeouts_total",
+    "hid_write_eagain_total",
+    "hid_write_failures_total",
+    "touches_sent_total",
+    "consensus_rejects_total",
+    "speculative_ups_total",
+    "speculative_corrections_total",
+    "sensor_dropouts_total",
+    "settings_reloads_total",
+    "up_retouches_total",
+    "auto_tune_updates_total",
+    "contacts_exhausted_total"
+};
+
+static const char * queueNames[MetricsQueueCount] =
+{
+    "sensor_group",
+    "main"
+};
+
+static const char * stateNames[METRICS_STATES] =
+{
+    "idle",
+    "down_pending",
+    "down",
+    "move",
+    "up_pending",
+    "up"
+};
+
+static const char * stateInputNames[METRICS_STATE_INPUTS] =
+{
+    "down",
+    "move",
+    "up",
+    "invalid"
+};
+
+static const char * bringUpStepNames[METRICS_BRINGUP_STEPS] =
+{
+    "connect",
+    "operation_modes",
+    "mcu_unique_identifier",
+    "touch_active_area",
+    "number_of_tracked_objects",
+    "enable",
+    "first_touch"
+};
+
+static const char * stageNames[MetricsStageCount] =
+{
+    "queue",
+    "merge",
+    "output",
+    "total"
+};
+
+/*  ********** Counters **********
+ *
+ */
+
+/*  Increments a counter. Never blocks.  */
+void MetricsIncrement(MetricsCounter counter)
+{
+    __atomic_fetch_add(&GetThreadCounters()->Counters[counter], 1, __ATOMIC_RELAXED);
+}
+
+/*  Gets the value of a counter. Never blocks.
+ *
+ *  @return counter value.
+*/
+uint64_t MetricsGetCounter(MetricsCounter counter)
+{
+    return SumThreads(&threadCounters[0].Counters[counter]);
+}
+
+/*  Counts a touch message received from a sensor. Never blocks.  */
+void MetricsSensorMessage(int sensorIndex)
+{
+    if (sensorIndex >= 0 && sensorIndex < MAX_SENSORS)
+    {
+        __atomic_fetch_add(&GetThreadCounters()->SensorMessages[sensorIndex], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/*  Gets the number of touch messages received from all sensors. Never blocks.
+ *
+ *  @return number of touch messages.
+*/
+uint64_t MetricsGetSensorMessages(void)
+{
+    uint64_t total = 0;
+
+    for (int i = 0; i < MAX_SENSORS; i++)
+    {
+        total += SumThreads(&threadCounters[0].SensorMessages[i]);
+    }
+
+    return total;
+}
+
+/*  Counts a message put on a queue. Never blocks.  */
+void MetricsQueueEnqueued(MetricsQueue queue)
+{
+    __atomic_fetch_add(&GetThreadCounters()->QueueEnqueued[queue], 1, __ATOMIC_RELAXED);
+}
+
+/*  Counts a message taken from a queue. Never blocks.  */
+void MetricsQueueDequeued(MetricsQueue queue)
+{
+    __atomic_fetch_add(&GetThreadCounters()->QueueDequeued[queue], 1, __ATOMIC_RELAXED);
+}
+
+/*  Adds a latency sample in microseconds to the histogram of a stage. Never blocks.  */
+void MetricsRecordLatency(MetricsStage stage, uint64_t microSeconds)
+{
+    MetricsThreadCounters * own = GetThreadCounters();
+
+    __atomic_fetch_add(&own->LatencyBuckets[stage][LatencyBucketIndex(microSeconds)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&own->LatencySum[stage], microSeconds, __ATOMIC_RELAXED);
+}
+
+/*  Counts a transition of the contact state machine from given state on given input. Never blocks.  */
+void MetricsStateTransition(int state, int input)
+{
+    if (state >= 0 && state < METRICS_STATES && input >= 0 && input < METRICS_STATE_INPUTS)
+    {
+        __atomic_fetch_add(&GetThreadCounters()->StateTransitions[state][input], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/*  Sets the duration of a sensor bring-up step in microseconds. Never blocks.  */
+void MetricsBringUpStep(int sensorIndex, int step, uint64_t microSeconds)
+{
+    if (sensorIndex >= 0 && sensorIndex < MAX_SENSORS && step >= 0 && step < METRICS_BRINGUP_STEPS)
+    {
+        __atomic_store_n(&bringUpDurations[sensorIndex][step], microSeconds, __ATOMIC_RELAXED);
+    }
+}
+
+/*  Sets the time in microseconds from a sensor coming back until it was enabled again. Never blocks.  */
+void MetricsSensorReconnect(int sensorIndex, uint64_t microSeconds)
+{
+    if (sensorIndex >= 0 && sensorIndex < MAX_SENSORS)
+    {
+        __atomic_store_n(&reconnectDurations[sensorIndex], microSeconds, __ATOMIC_RELAXED);
+    }
+}
+
+/*  Sets if the touches of a sensor are merged. Never blocks.  */
+void MetricsSetSensorActive(int sensorIndex, bool isActive)
+{
+    if (sensorIndex >= 0 && sensorIndex < MAX_SENSORS)
+    {
+        __atomic_store_n(&sensorActive[sensorIndex], isActive, __ATOMIC_RELAXED);
+    }
+}
+
+/*  Sets the fraction of the screen no active sensor covers, and the bounds of that region in 1/10 mm. Never blocks.  */
+void MetricsSetUncoveredArea(float fraction, int32_t left, int32_t top, int32_t right, int32_t bottom)
+{
+    __atomic_store_n(&uncoveredArea, (uint32_t)(fraction * 10000 + 0.5f), __ATOMIC_RELAXED);
+    __atomic_store_n(&uncoveredBounds[0], left, __ATOMIC_RELAXED);
+    __atomic_store_n(&uncoveredBounds[1], top, __ATOMIC_RELAXED);
+    __atomic_store_n(&uncoveredBounds[2], right, __ATOMIC_RELAXED);
+    __atomic_store_n(&uncoveredBounds[3], bottom, __ATOMIC_RELAXED);
+}
+
+/*  Gets a monotonic timestamp used for latency measurements.
+ *
+ *  @return the time in microseconds.
+*/
+uint64_t MetricsGetTimeMicroSeconds(void)
+{
+    if (replayTime != 0)
+    {
+        return replayTime;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/*  Gets the counters of the calling thread, taking a block on its first count. Threads beyond METRICS_MAX_THREADS
+ *  share the last block, which is why the counters are still incremented atomically.
+ *
+ *  @return counters of the thread.
+*/
+static MetricsThreadCounters * GetThreadCounters(void)
+{
+    if (ownCounters == NULL)
+    {
+        uint32_t index = __atomic_fetch_add(&numberOfThreadCounters, 1, __ATOMIC_RELAXED);
+        ownCounters = &threadCounters[MIN(index, METRICS_MAX_THREADS - 1)];
+    }
+
+    return ownCounters;
+}
+
+/*  Sums a counter over the blocks of all threads. The counter is given by its field in the first block.
+ *
+ *  @return sum of the counter.
+*/
+static uint64_t SumThreads(const uint64_t * field)
+{
+    size_t offset = (const char *)field - (const char *)&threadCounters[0];
+    uint32_t used = MIN(__atomic_load_n(&numberOfThreadCounters, __ATOMIC_RELAXED), METRICS_MAX_THREADS);
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < used; i++)
+    {
+        total += __atomic_load_n((const uint64_t *)((const char *)&threadCounters[i] + offset), __ATOMIC_RELAXED);
+    }
+
+    return total;
+}
+
+/*  ********** Latency histograms **********
+ *
+ *  Values below 4 us have one bucket each. Above that every power of two is split into 4 linear sub-buckets,
+ *  which keeps the quantile error below 25 % with a fixed number of buckets.
+ */
+
+/*  Gets the histogram bucket for a latency.
+ *
+ *  @return bucket index.
+*/
+static int LatencyBucketIndex(uint64_t microSeconds)
+{
+    if (microSeconds < 4)
+    {
+        return (int)microSeconds;
+    }
+
+    int msb = 63 - __builtin_clzll(microSeconds);
+    int index = (msb - 1) * 4 + (int)((microSeconds >> (msb - 2)) & 3);
+
+    return index < METRICS_LATENCY_BUCKETS ? index : METRICS_LATENCY_BUCKETS - 1;
+}
+
+/*  Gets the largest latency that falls into given bucket.
+ *
+ *  @return latency in microseconds.
+*/
+static uint64_t LatencyBucketUpperBound(int index)
+{
+    if (index < 4)
+    {
+        return index;
+    }
+
+    int msb = index / 4 + 1;
+    uint64_t subBucket = index % 4;
+
+    return ((4 + subBucket + 1) << (msb - 2)) - 1;
+}
+
+/*  Estimates a latency quantile for a stage from its histogram.
+ *
+ *  @return latency in microseconds, 0 if there are no samples.
+*/
+static uint64_t LatencyQuantile(MetricsStage stage, double quantile)
+{
+    uint64_t buckets[METRICS_LATENCY_BUCKETS];
+    uint64_t total = 0;
+
+    for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++)
+    {
+        buckets[i] = SumThreads(&threadCounters[0].LatencyBuckets[stage][i]);
+        total += buckets[i];
+    }
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(quantile * total + 0.5);
+    uint64_t cumulative = 0;
+    for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++)
+    {
+        cumulative += buckets[i];
+        if (cumulative >= rank && cumulative > 0)
+        {
+            return LatencyBucketUpperBound(i);
+        }
+    }
+
+    return LatencyBucketUpperBound(METRICS_LATENCY_BUCKETS - 1);
+}
+
+/*  ********** Socket server **********
+ *
+ */
+
+/*  Creates the metrics socket and starts the thread serving it.
+ *  Every connection to the socket receives a snapshot of all counters in text format and is then closed.
+ *
+ *  @return true on success, false on fail.
+*/
+bool MetricsStart(const char * socketPath)
+{
+    zForce * zForceInstance = zForce_GetInstance();
+    struct sockaddr_un address = { 0 };
+
+    // Nothing is covered until the first sensor is laid out.
+    uncoveredBounds[2] = GetSettings()->ScreenWidth;
+    uncoveredBounds[3] = GetSettings()->ScreenHeight;
+
+    if (zForceInstance == NULL || strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+    {
+        perror("Error: Creating metrics socket");
+        return false;
+    }
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+    unlink(socketPath); // Remove a stale socket left by a previous run.
+
+    if (bind(listenSocket, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listenSocket, 4) < 0)
+    {
+        perror("Error: Binding metrics socket");
+        close(listenSocket);
+        listenSocket = -1;
+        return false;
+    }
+    strcpy(listenSocketPath, socketPath);
+
+    // The application runs as root. Monitoring agents without privileges read the metrics as members of metrics-group,
+    // other users can not connect.
+    const char * groupName = GetSettings()->MetricsGroup;
+    struct group * group = groupName[0] != 0 ? getgrnam(groupName) : NULL;
+    if (groupName[0] != 0 && (group == NULL || chown(socketPath, (uid_t)-1, group->gr_gid) < 0))
+    {
+        printf("Error: Unable to give group %s access to the metrics socket, only root can read the metrics. \n", groupName);
+    }
+    chmod(socketPath, group != NULL ? 0660 : 0600);
+
+    startTime = MetricsGetTimeMicroSeconds();
+    lastRateSampleTime = startTime;
+    metricsShutDownNow = false;
+
+    if (!zForceInstance->OsAbstractionLayer.CreateThread(&metricsThread, MetricsThread, NULL))
+    {
+        printf("Error: Unable to create metrics thread. \n");
+        MetricsStop();
+        return false;
+    }
+
+    return true;
+}
+
+/*  Stops the metrics thread and removes the socket.
+ *  The thread is not joined since WaitForThreadExit may block forever, it closes the socket itself within one poll interval.
+*/
+void MetricsStop(void)
+{
+    if (metricsThread != NULL)
+    {
+        metricsShutDownNow = true;
+        metricsThread = NULL;
+    }
+    else if (listenSocket >= 0)
+    {
+        close(listenSocket);
+        listenSocket = -1;
+    }
+
+    if (listenSocketPath[0] != 0)
+    {
+        unlink(listenSocketPath);
+        listenSocketPath[0] = 0;
+    }
+}
+
+/*  Serves snapshots to connecting clients and samples the message rates.  */
+static void MetricsThread(void * parameters)
+{
+    (void)parameters;
+
+    while (!metricsShutDownNow)
+    {
+        SettingsQuiescentState();
+
+        struct pollfd pollDescriptor = { .fd = listenSocket, .events = POLLIN };
+        int result = poll(&pollDescriptor, 1, METRICS_RATE_INTERVAL);
+
+        if ((MetricsGetTimeMicroSeconds() - lastRateSampleTime) >= METRICS_RATE_INTERVAL * 1000)
+        {
+            MetricsUpdateRates();
+        }
+
+        if (result > 0 && (pollDescriptor.revents & POLLIN))
+        {
+            int client = accept(listenSocket, NULL, NULL);
+            if (client >= 0)
+            {
+                MetricsWriteSnapshot(client);
+                close(client);
+            }
+        }
+        else if (result < 0 && errno != EINTR)
+        {
+            perror("Error: Polling metrics socket");
+            break;
+        }
+    }
+
+    close(listenSocket);
+    listenSocket = -1;
+
+    SettingsThreadExit();
+}
+
+/*  Calculates the per sensor message rates since last sample.  */
+static void MetricsUpdateRates(void)
+{
+    uint64_t now = MetricsGetTimeMicroSeconds();
+    double elapsedSeconds = (now - lastRateSampleTime) / 1000000.0;
+
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        uint64_t messages = SumThreads(&threadCounters[0].SensorMessages[i]);
+        sensorMessagesPerSecond[i] = (messages - sensorMessagesLastSample[i]) / elapsedSeconds;
+        sensorMessagesLastSample[i] = messages;
+    }
+
+    lastRateSampleTime = now;
+}
+
+/*  Formats all counters and writes them to given socket.  */
+static void MetricsWriteSnapshot(int fd)
+{
+    static MetricsBuffer buffer;
+    buffer.Length = 0;
+
+    MetricsAppend(&buffer, "uptime_seconds %.3f\n", (MetricsGetTimeMicroSeconds() - startTime) / 1000000.0);
+
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        MetricsAppend(&buffer, "sensor_messages_total{sensor=\"%d\"} %" PRIu64 "\n", i, SumThreads(&threadCounters[0].SensorMessages[i]));
+        MetricsAppend(&buffer, "sensor_messages_per_second{sensor=\"%d\"} %.1f\n", i, sensorMessagesPerSecond[i]);
+    }
+
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        MetricsAppend(&buffer, "sensor_active{sensor=\"%d\"} %d\n", i, __atomic_load_n(&sensorActive[i], __ATOMIC_RELAXED) ? 1 : 0);
+    }
+
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        uint64_t duration = __atomic_load_n(&reconnectDurations[i], __ATOMIC_RELAXED);
+        if (duration > 0)
+        {
+            MetricsAppend(&buffer, "sensor_reconnect_milliseconds{sensor=\"%d\"} %.1f\n", i, duration / 1000.0);
+        }
+    }
+
+    // The bounds may be from a different update than the fraction, they are only read for display.
+    static const char * edgeNames[4] = { "left", "top", "right", "bottom" };
+    MetricsAppend(&buffer, "uncovered_area_ratio %.4f\n", __atomic_load_n(&uncoveredArea, __ATOMIC_RELAXED) / 10000.0);
+    for (int i = 0; i < 4; i++)
+    {
+        MetricsAppend(&buffer, "uncovered_area_bounds{edge=\"%s\"} %d\n", edgeNames[i], __atomic_load_n(&uncoveredBounds[i], __ATOMIC_RELAXED));
+    }
+
+    for (int i = 0; i < MetricsQueueCount; i++)
+    {
+        uint64_t dequeued = SumThreads(&threadCounters[0].QueueDequeued[i]);
+        uint64_t enqueued = SumThreads(&threadCounters[0].QueueEnqueued[i]);
+        MetricsAppend(&buffer, "queue_depth{queue=\"%s\"} %" PRIu64 "\n", queueNames[i], enqueued > dequeued ? enqueued - dequeued : 0);
+    }
+
+    for (int i = 0; i < MetricsCounterCount; i++)
+    {
+        MetricsAppend(&buffer, "%s %" PRIu64 "\n", counterNames[i], SumThreads(&threadCounters[0].Counters[i]));
+    }
+
+    for (int state = 0; state < METRICS_STATES; state++)
+    {
+        for (int input = 0; input < METRICS_STATE_INPUTS; input++)
+        {
+            uint64_t count = SumThreads(&threadCounters[0].StateTransitions[state][input]);
+            if (count > 0)
+            {
+                MetricsAppend(&buffer, "state_transitions_total{state=\"%s\",input=\"%s\"} %" PRIu64 "\n", stateNames[state], stateInputNames[input], count);
+            }
+        }
+    }
+
+    for (int i = 0; i < GetSettings()->Sensors; i++)
+    {
+        for (int step = 0; step < METRICS_BRINGUP_STEPS; step++)
+        {
+            uint64_t duration = __atomic_load_n(&bringUpDurations[i][step], __ATOMIC_RELAXED);
+            if (duration > 0)
+            {
+                MetricsAppend(&buffer, "sensor_bringup_milliseconds{sensor=\"%d\",step=\"%s\"} %.1f\n", i, bringUpStepNames[step], duration / 1000.0);
+            }
+        }
+    }
+
+    static const double quantiles[] = { 0.5, 0.9, 0.99 };
+    for (int stage = 0; stage < MetricsStageCount; stage++)
+    {
+        uint64_t count = 0;
+        for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++)
+        {
+            count += SumThreads(&threadCounters[0].LatencyBuckets[stage][i]);
+        }
+
+        for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++)
+        {
+            MetricsAppend(&buffer, "latency_microseconds{stage=\"%s\",quantile=\"%g\"} %" PRIu64 "\n",
+                stageNames[stage], quantiles[i], LatencyQuantile(stage, quantiles[i]));
+        }
+        MetricsAppend(&buffer, "latency_microseconds_sum{stage=\"%s\"} %" PRIu64 "\n", stageNames[stage], SumThreads(&threadCounters[0].LatencySum[stage]));
+        MetricsAppend(&buffer, "latency_microseconds_count{stage=\"%s\"} %" PRIu64 "\n", stageNames[stage], count);
+    }
+
+    const char * data = buffer.Data;
+    size_t remaining = buffer.Length;
+    while (remaining > 0)
+    {
+        ssize_t written = write(fd, data, remaining);
+        if (written <= 0)
+        {
+            break; // The client went away, nothing to do about it.
+        }
+        data += written;
+        remaining -= written;
+    }
+}
+
+/*  Appends formatted text to given buffer, silently truncating when full.  */
+static void MetricsAppend(MetricsBuffer * buffer, const char * format, ...)
+{
+    if (buffer->Length >= METRICS_BUFFER_SIZE - 1)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer->Data + buffer->Length, METRICS_BUFFER_SIZE - buffer->Length, format, args);
+    va_end(args);
+
+    if (length > 0)
+    {
+        buffer->Length += length;
+        if (buffer->Length > METRICS_BUFFER_SIZE - 1)
+        {
+            buffer->Length = METRICS_BUFFER_SIZE - 1;
+        }
+    }
+}
+
+/*  Replaces the monotonic clock by given time in microseconds, so a recorded trace can be replayed through the merger
+ *  faster than real time. 0 uses the monotonic clock again. Only for single threaded tools.
+*/
+void MetricsSetReplayTime(uint64_t microSeconds)
+{
+    replayTime = microSeconds;
+}
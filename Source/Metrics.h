@@ -0,0 +1,114 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Common.h"
+
+#define METRICS_SOCKET_PATH "/run/multi-sensor-app.sock"  // Not in /tmp, where any user could take the name first.
+#define METRICS_LATENCY_BUCKETS 128    // 4 linear sub-buckets for each power of two microseconds.
+#define METRICS_STATES 6               // Number of contact states, see SensorState in Merger.h.
+#define METRICS_STATE_INPUTS 4         // Number of state machine inputs: down, move, up and invalid.
+#define METRICS_BRINGUP_STEPS 7        // Number of sensor bring-up steps, see BringUpStep in SensorBringUp.h.
+
+/*  Runtime counters. All counters are monotonically increasing.  */
+typedef enum MetricsCounter
+{
+    MetricsCounterDebounceDrops = 0,        //!< Touches removed by Debounce.
+    MetricsCounterDeghostDrops,             //!< Touches removed by Deghost.
+    MetricsCounterStateArbitratorErrors,    //!< Faulty StateArbitrator transitions.
+    MetricsCounterTimeouts,                 //!< Up pending timeouts that fired.
+    MetricsCounterHidWriteAgain,            //!< Writes to hidg0 that returned EAGAIN.
+    MetricsCounterHidWriteFailures,         //!< Writes to hidg0 that failed for other reasons.
+    MetricsCounterTouchesSent,              //!< Touches sent to the host.
+    MetricsCounterConsensusRejects,         //!< New contacts in an overlap not confirmed by the opposite sensor.
+    MetricsCounterSpeculativeUps,           //!< Up events sent before the up timeout.
+    MetricsCounterSpeculativeCorrections,   //!< Speculative up events corrected by a new down event.
+    MetricsCounterSensorDropouts,           //!< Sensors that failed or disconnected after being enabled or during bring-up.
+    MetricsCounterSettingsReloads,          //!< Settings reloaded on SIGHUP.
+    MetricsCounterUpRetouches,              //!< Up pending contacts touched again before the up timeout.
+    MetricsCounterAutoTuneUpdates,          //!< Settings changed by the auto-tuner.
+    MetricsCounterContactsExhausted,        //!< Touches dropped because all contacts were in use.
+    MetricsCounterCount
+} MetricsCounter;
+
+/*  Queues whose depth is tracked. Depth is the number of enqueued minus dequeued messages.  */
+typedef enum MetricsQueue
+{
+    MetricsQueueSensorGroup = 0,
+    MetricsQueueMain,
+    MetricsQueueCount
+} MetricsQueue;
+
+/*  Stages of the touch path with latency histograms.  */
+typedef enum MetricsStage
+{
+    MetricsStageQueue = 0,      //!< From sensor thread enqueue to sensor group thread dequeue.
+    MetricsStageMerge,          //!< MergeTouch processing.
+    MetricsStageOutput,         //!< Writing the report to the host.
+    MetricsStageTotal,          //!< From sensor thread enqueue until the report is written.
+    MetricsStageCount
+} MetricsStage;
+
+/*  Creates the metrics socket and starts the thread serving it.
+ *  Every connection to the socket receives a snapshot of all counters in text format and is then closed.
+ *
+ *  @return true on success, false on fail.
+*/
+bool MetricsStart(const char * socketPath);
+
+/*  Stops the metrics thread and removes the socket.  */
+void MetricsStop(void);
+
+/*  Increments a counter. Never blocks.  */
+void MetricsIncrement(MetricsCounter counter);
+
+/*  Gets the value of a counter. Never blocks.
+ *
+ *  @return counter value.
+*/
+uint64_t MetricsGetCounter(MetricsCounter counter);
+
+/*  Counts a touch message received from a sensor. Never blocks.  */
+void MetricsSensorMessage(int sensorIndex);
+
+/*  Gets the number of touch messages received from all sensors. Never blocks.
+ *
+ *  @return number of touch messages.
+*/
+uint64_t MetricsGetSensorMessages(void);
+
+/*  Counts a message put on or taken from a queue. Never blocks.  */
+void MetricsQueueEnqueued(MetricsQueue queue);
+void MetricsQueueDequeued(MetricsQueue queue);
+
+/*  Adds a latency sample in microseconds to the histogram of a stage. Never blocks.  */
+void MetricsRecordLatency(MetricsStage stage, uint64_t microSeconds);
+
+/*  Counts a transition of the contact state machine from given state on given input. Never blocks.  */
+void MetricsStateTransition(int state, int input);
+
+/*  Sets the duration of a sensor bring-up step in microseconds. Never blocks.  */
+void MetricsBringUpStep(int sensorIndex, int step, uint64_t microSeconds);
+
+/*  Sets the time in microseconds from a sensor coming back until it was enabled again. Never blocks.  */
+void MetricsSensorReconnect(int sensorIndex, uint64_t microSeconds);
+
+/*  Sets if the touches of a sensor are merged. Never blocks.  */
+void MetricsSetSensorActive(int sensorIndex, bool isActive);
+
+/*  Sets the fraction of the screen no active sensor covers, and the bounds of that region in 1/10 mm. Never blocks.  */
+void MetricsSetUncoveredArea(float fraction, int32_t left, int32_t top, int32_t right, int32_t bottom);
+
+/*  Gets a monotonic timestamp used for latency measurements.
+ *
+ *  @return the time in microseconds.
+*/
+uint64_t MetricsGetTimeMicroSeconds(void);
+
+/*  Replaces the monotonic clock by given time in microseconds, so a recorded trace can be replayed through the merger
+ *  faster than real time. 0 uses the monotonic clock again. Only for single threaded tools.
+*/
+void MetricsSetReplayTime(uint64_t microSeconds);
+
+#endif // METRICS_H
@@ -0,0 +1,54 @@
+#include "OneEuroFilter.h"
+#include <math.h>
+
+#define MIN_ELAPSED (0.001f)
+
+static float GetSmoothingFactor(float cutoff, float elapsed);
+
+/*  Resets the filter so the next position is passed through unfiltered.  */
+void OneEuroFilterReset(OneEuroFilter * filter)
+{
+    filter->IsInitialized = false;
+}
+
+/*  Filters a position in place. elapsed is the time since the previous position in seconds.  */
+void OneEuroFilterApply(OneEuroFilter * filter, const OneEuroParameters * parameters, float elapsed, float * x, float * y)
+{
+    if (!filter->IsInitialized)
+    {
+        filter->IsInitialized = true;
+        filter->X = *x;
+        filter->Y = *y;
+        filter->SpeedX = 0;
+        filter->SpeedY = 0;
+        return;
+    }
+
+    if (elapsed < MIN_ELAPSED)
+    {
+        elapsed = MIN_ELAPSED;
+    }
+
+    // Low pass the speed first, the cutoff for the position adapts to it.
+    float alpha = GetSmoothingFactor(parameters->DerivateCutoff, elapsed);
+    filter->SpeedX += alpha * ((*x - filter->X) / elapsed - filter->SpeedX);
+    filter->SpeedY += alpha * ((*y - filter->Y) / elapsed - filter->SpeedY);
+
+    float speed = sqrtf(filter->SpeedX * filter->SpeedX + filter->SpeedY * filter->SpeedY);
+    alpha = GetSmoothingFactor(parameters->MinCutoff + parameters->Beta * speed, elapsed);
+    filter->X += alpha * (*x - filter->X);
+    filter->Y += alpha * (*y - filter->Y);
+
+    *x = filter->X;
+    *y = filter->Y;
+}
+
+/*  Gets the exponential smoothing factor of a first order low pass filter.
+ *
+ *  @return factor between 0 and 1.
+*/
+static float GetSmoothingFactor(float cutoff, float elapsed)
+{
+    float tau = 1.0f / (2.0f * (float)M_PI * cutoff);
+    return 1.0f / (1.0f + tau / elapsed);
+}
@@ -0,0 +1,40 @@
+#ifndef ONEEUROFILTER_H
+#define ONEEUROFILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*  ********** One Euro filter **********
+ *
+ *  Speed adaptive low pass filter for 2D positions (Casiez, Roussel and Vogel, CHI 2012). The cutoff frequency grows
+ *  with the filtered speed, so a still finger is smoothed hard while a fast drag follows the finger with little lag.
+ *
+ *      cutoff = MinCutoff + Beta * speed
+ *
+ *  Lower MinCutoff for less jitter at rest, raise Beta for less lag when moving. Positions are in 1/10 mm, so speed is
+ *  in 1/10 mm per second.
+ */
+
+typedef struct OneEuroParameters
+{
+    float MinCutoff;        // Cutoff frequency at rest in Hz.
+    float Beta;             // Cutoff increase per unit of speed.
+    float DerivateCutoff;   // Cutoff frequency in Hz for the speed estimate.
+} OneEuroParameters;
+
+typedef struct OneEuroFilter
+{
+    bool  IsInitialized;
+    float X;
+    float Y;
+    float SpeedX;
+    float SpeedY;
+} OneEuroFilter;
+
+/*  Resets the filter so the next position is passed through unfiltered.  */
+void OneEuroFilterReset(OneEuroFilter * filter);
+
+/*  Filters a position in place. elapsed is the time since the previous position in seconds.  */
+void OneEuroFilterApply(OneEuroFilter * filter, const OneEuroParameters * parameters, float elapsed, float * x, float * y);
+
+#endif // ONEEUROFILTER_H
@@ -0,0 +1,144 @@
+#include "Output.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct OutputBackendType
+{
+    const char      * Name;
+    OutputBackend * ( * New)(void);
+} OutputBackendType;
+
+static const OutputBackendType * FindBackendType(const char * name);
+
+static const OutputBackendType backendTypes[] =
+{
+    { "hidg", HidgOutputNew },
+    { "uinput", UinputOutputNew },
+    { "udp", UdpOutputNew },
+    { "shm", ShmOutputNew },
+};
+
+static OutputBackend * backends[MAX_OUTPUT_BACKENDS] = { 0 };
+static int             numberOfBackends = 0;
+static bool            wantsRawTouches = false;
+
+// Global error shutdown flag
+extern volatile bool shutDownNow;
+
+/*  Creates and opens the backends in given comma separated list.
+ *
+ *  @return true on success, false if the list is too long or a backend is unknown or failed to open.
+*/
+bool OutputOpen(const char * outputs)
+{
+    char list[MAX_OUTPUT_BACKENDS * 16] = { 0 };
+
+    if (strlen(outputs) >= sizeof(list))
+    {
+        printf("Error: Output backend list '%s' is longer than %zu characters. \n", outputs, sizeof(list) - 1);
+        return false;
+    }
+    strcpy(list, outputs);
+
+    for (char * name = strtok(list, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        if (numberOfBackends == MAX_OUTPUT_BACKENDS)
+        {
+            printf("Error: Too many output backends. \n");
+            return false;
+        }
+
+        const OutputBackendType * type = FindBackendType(name);
+        if (type == NULL)
+        {
+            printf("Error: Unknown output backend '%s'. \n", name);
+            return false;
+        }
+
+        OutputBackend * backend = type->New();
+        if (backend == NULL)
+        {
+            printf("Error: Out of memory creating output backend '%s'. \n", name);
+            return false;
+        }
+
+        if (!backend->Open(backend))
+        {
+            printf("Error: Unable to open output backend '%s'. \n", name);
+            backend->Close(backend);
+            return false;
+        }
+
+        printf("Output: %s \n", backend->Name);
+        backends[numberOfBackends++] = backend;
+        wantsRawTouches |= backend->SendRaw != NULL;
+    }
+
+    return numberOfBackends > 0;
+}
+
+/*  Sends a frame of merged contacts to all backends. Sets the global shutdown flag on unrecoverable errors.  */
+void OutputSend(const TouchFrame * frame)
+{
+    if (frame == NULL || frame->NumberOfContacts == 0)
+    {
+        return;
+    }
+
+    for (int i = 0; i < numberOfBackends; i++)
+    {
+        if (!backends[i]->Send(backends[i], frame))
+        {
+            shutDownNow = true;
+        }
+    }
+}
+
+/*  Sends an unprocessed sensor touch to the backends that want them.  */
+void OutputSendRaw(TouchInfo * info)
+{
+    for (int i = 0; i < numberOfBackends; i++)
+    {
+        if (backends[i]->SendRaw != NULL)
+        {
+            backends[i]->SendRaw(backends[i], info);
+        }
+    }
+}
+
+/*  Checks if any backend wants unprocessed sensor touches.
+ *
+ *  @return true if OutputSendRaw should be called.
+*/
+bool OutputWantsRawTouches(void)
+{
+    return wantsRawTouches;
+}
+
+/*  Closes all backends.  */
+void OutputClose(void)
+{
+    for (int i = 0; i < numberOfBackends; i++)
+    {
+        backends[i]->Close(backends[i]);
+        backends[i] = NULL;
+    }
+    numberOfBackends = 0;
+    wantsRawTouches = false;
+}
+
+/*  Finds a backend type by name.
+ *
+ *  @return backend type, NULL if the name is unknown.
+*/
+static const OutputBackendType * FindBackendType(const char * name)
+{
+    for (size_t i = 0; i < sizeof(backendTypes) / sizeof(backendTypes[0]); i++)
+    {
+        if (strcmp(backendTypes[i].Name, name) == 0)
+        {
+            return &backendTypes[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,77 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include "Common.h"
+
+#define MAX_OUTPUT_BACKENDS 8
+
+/*  ********** Output backends **********
+ *
+ *  Merged touch frames are handed to every backend selected with the output setting:
+ *
+ *      hidg    USB gadget on /dev/hidg0, absolute mouse or multi-touch digitizer, see Scripts/neonode_usb.
+ *      uinput  Linux multi-touch input device on the Raspberry Pi itself through /dev/uinput.
+ *      udp     TUIO 2Dcur messages over UDP to the udp-target setting.
+ *      shm     Shared memory touch stream for local processes, see TouchStream.h.
+ *
+ *  All functions are called from the sensor group thread.
+ */
+
+typedef struct OutputBackend OutputBackend;
+
+struct OutputBackend
+{
+    const char * Name;
+    void       * Private;   //!< Backend specific data.
+
+    /*  Opens the backend.
+     *
+     *  @return true on success, false on fail.
+    */
+    bool ( * Open)(OutputBackend * self);
+
+    /*  Sends a frame of merged contacts.
+     *
+     *  @return false on an unrecoverable error, true otherwise.
+    */
+    bool ( * Send)(OutputBackend * self, const TouchFrame * frame);
+
+    /*  Sends an unprocessed sensor touch. NULL if the backend is not interested in them.  */
+    void ( * SendRaw)(OutputBackend * self, TouchInfo * info);
+
+    /*  Closes the backend and frees it.  */
+    void ( * Close)(OutputBackend * self);
+};
+
+/*  Creates and opens the backends in given comma separated list.
+ *
+ *  @return true on success, false if the list is too long or a backend is unknown or failed to open.
+*/
+bool OutputOpen(const char * outputs);
+
+/*  Sends a frame of merged contacts to all backends. Sets the global shutdown flag on unrecoverable errors.  */
+void OutputSend(const TouchFrame * frame);
+
+/*  Sends an unprocessed sensor touch to the backends that want them.  */
+void OutputSendRaw(TouchInfo * info);
+
+/*  Checks if any backend wants unprocessed sensor touches.
+ *
+ *  @return true if OutputSendRaw should be called.
+*/
+bool OutputWantsRawTouches(void);
+
+/*  Closes all backends.  */
+void OutputClose(void);
+
+/*  Backend constructors.
+ *
+ *  @return new backend, NULL if out of memory.
+*/
+OutputBackend * HidgOutputNew(void);
+OutputBackend * UinputOutputNew(void);
+OutputBackend * UdpOutputNew(void);
+OutputBackend * ShmOutputNew(void);
+
+#endif // OUTPUT_H
@@ -0,0 +1,75 @@
+#include "ReportScheduler.h"
+
+static uint64_t tickInterval = 0;   // Microseconds between ticks, 0 if not paced.
+static uint64_t nextTick = 0;       // Monotonic time of the next tick, 0 if not active.
+
+/*  Sets the report rate in Hz, 0 sends every merged touch immediately.  */
+void ReportSchedulerSetRate(int32_t reportRate)
+{
+    tickInterval = reportRate > 0 ? 1000000 / reportRate : 0;
+    nextTick = 0;
+}
+
+/*  Checks if reports of moving contacts are paced.
+ *
+ *  @return true if moves should wait for ReportSchedulerIsTickDue.
+*/
+bool ReportSchedulerIsPaced(void)
+{
+    return tickInterval > 0;
+}
+
+/*  Starts or stops the ticks, depending on if any contact touches the screen.  */
+void ReportSchedulerSetActive(bool isActive, uint64_t now)
+{
+    if (!isActive || tickInterval == 0)
+    {
+        nextTick = 0;
+    }
+    else if (nextTick == 0)
+    {
+        nextTick = now + tickInterval;
+    }
+}
+
+/*  Gets the time until the next tick.
+ *
+ *  @return timeout in milliseconds, -1 if no tick is scheduled.
+*/
+int32_t ReportSchedulerGetTimeoutInMs(uint64_t now)
+{
+    if (nextTick == 0)
+    {
+        return -1;
+    }
+
+    if (nextTick <= now)
+    {
+        return 0;
+    }
+
+    // Round up so the thread does not wake up just before the tick.
+    return (nextTick - now + 999) / 1000;
+}
+
+/*  Checks if a tick is due and schedules the next one.
+ *
+ *  @return true if a report should be sent now.
+*/
+bool ReportSchedulerIsTickDue(uint64_t now)
+{
+    if (nextTick == 0 || nextTick > now)
+    {
+        return false;
+    }
+
+    nextTick += tickInterval;
+
+    // Skip ticks that were missed instead of sending a burst to catch up.
+    if (nextTick <= now)
+    {
+        nextTick = now + tickInterval;
+    }
+
+    return true;
+}
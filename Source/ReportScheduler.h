@@ -0,0 +1,41 @@
+#ifndef REPORTSCHEDULER_H
+#define REPORTSCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*  ********** Report scheduler **********
+ *
+ *  Paces reports of moving contacts to the report-rate setting instead of sending one report per sensor message.
+ *  With several sensors scanning at their own rates the host would otherwise see irregular report timing and bursts.
+ *  Down and up events are still sent as soon as they are merged, only moves wait for the next tick. Ticks only run
+ *  while a contact touches the screen, so the sensor group thread sleeps when the screen is idle.
+ *
+ *  All functions are called from the sensor group thread. Times are monotonic microseconds, see Metrics.h.
+ */
+
+/*  Sets the report rate in Hz, 0 sends every merged touch immediately.  */
+void ReportSchedulerSetRate(int32_t reportRate);
+
+/*  Checks if reports of moving contacts are paced.
+ *
+ *  @return true if moves should wait for ReportSchedulerIsTickDue.
+*/
+bool ReportSchedulerIsPaced(void);
+
+/*  Starts or stops the ticks, depending on if any contact touches the screen.  */
+void ReportSchedulerSetActive(bool isActive, uint64_t now);
+
+/*  Gets the time until the next tick.
+ *
+ *  @return timeout in milliseconds, -1 if no tick is scheduled.
+*/
+int32_t ReportSchedulerGetTimeoutInMs(uint64_t now);
+
+/*  Checks if a tick is due and schedules the next one.
+ *
+ *  @return true if a report should be sent now.
+*/
+bool ReportSchedulerIsTickDue(uint64_t now);
+
+#endif // REPORTSCHEDULER_H
@@ -0,0 +1,213 @@
+#include "SensorBringUp.h"
+#include "Metrics.h"
+#include <stdio.h>
+#include <string.h>
+
+#define STEP(step) (1u << (step))
+
+typedef struct BringUpStepDescription
+{
+    const char * Name;
+    uint32_t     Dependencies;  //!< Steps that must be done before this one is requested.
+    int32_t      Timeout;       //!< Response timeout in milliseconds, 0 waits forever.
+    uint8_t      Attempts;      //!< Times the request is sent, 0 for steps that are not requests.
+} BringUpStepDescription;
+
+_Static_assert(BringUpStepCount == METRICS_BRINGUP_STEPS, "BringUpStepCount does not match METRICS_BRINGUP_STEPS.");
+
+static uint32_t GetDependencies(const BringUp * bringUp, int step);
+
+static const BringUpStepDescription stepDescriptions[BringUpStepCount] =
+{
+    [BringUpStepConnect] = { "connect", 0, BRINGUP_CONNECT_TIMEOUT, 1 },
+    [BringUpStepOperationModes] = { "operation_modes", STEP(BringUpStepConnect), BRINGUP_STEP_TIMEOUT, BRINGUP_STEP_ATTEMPTS },
+    [BringUpStepMcuUniqueIdentifier] = { "mcu_unique_identifier", STEP(BringUpStepConnect), BRINGUP_STEP_TIMEOUT, BRINGUP_STEP_ATTEMPTS },
+    [BringUpStepTouchActiveArea] = { "touch_active_area", STEP(BringUpStepConnect), BRINGUP_STEP_TIMEOUT, BRINGUP_STEP_ATTEMPTS },
+    [BringUpStepNumberOfTrackedObjects] = { "number_of_tracked_objects", STEP(BringUpStepConnect), BRINGUP_STEP_TIMEOUT, BRINGUP_STEP_ATTEMPTS },
+    // Touches are only merged once the position and size of the sensor are known, so enable last unless they are cached.
+    [BringUpStepEnable] = { "enable",
+        STEP(BringUpStepOperationModes) | STEP(BringUpStepMcuUniqueIdentifier) | STEP(BringUpStepTouchActiveArea) | STEP(BringUpStepNumberOfTrackedObjects),
+        BRINGUP_STEP_TIMEOUT, BRINGUP_STEP_ATTEMPTS },
+    [BringUpStepFirstTouch] = { "first_touch", STEP(BringUpStepEnable), 0, 0 },
+};
+
+/*  Starts a new bring-up, all steps are idle.  */
+void BringUpStart(BringUp * bringUp, int sensorIndex, uint64_t now)
+{
+    memset(bringUp, 0, sizeof(BringUp));
+    bringUp->SensorIndex = sensorIndex;
+    bringUp->StartTime = now;
+}
+
+/*  Lets the sensor be enabled with its cached identifier and touch active area. Must be called before the first
+ *  request is sent.
+*/
+void BringUpUseCachedConfiguration(BringUp * bringUp)
+{
+    bringUp->IsCached = true;
+}
+
+/*  Gets the next request to send: a step whose dependencies are done and that is not requested yet, or a requested step
+ *  whose response timed out and that has attempts left. The step is marked as requested.
+ *
+ *  @return step to send, BringUpStepCount if there is nothing to send now.
+*/
+BringUpStep BringUpGetNextRequest(BringUp * bringUp, uint64_t now)
+{
+    uint32_t done = 0;
+    for (int step = 0; step < BringUpStepCount; step++)
+    {
+        done |= bringUp->State[step] == BringUpStepStateDone ? STEP(step) : 0;
+    }
+
+    for (int step = 0; step < BringUpStepCount; step++)
+    {
+        const BringUpStepDescription * description = &stepDescriptions[step];
+        uint32_t dependencies = GetDependencies(bringUp, step);
+        bool isReady = (dependencies & done) == dependencies;
+
+        if (bringUp->State[step] == BringUpStepStateIdle && isReady)
+        {
+            bringUp->State[step] = BringUpStepStateRequested;
+            bringUp->RequestTime[step] = now;
+            bringUp->Deadline[step] = description->Timeout > 0 ? now + description->Timeout * 1000ull : 0;
+            bringUp->Attempts[step] = description->Attempts > 0 ? 1 : 0;
+
+            if (description->Attempts > 0)
+            {
+                return step;
+            }
+        }
+        else if (bringUp->State[step] == BringUpStepStateRequested && bringUp->Deadline[step] != 0 &&
+                 now >= bringUp->Deadline[step] && bringUp->Attempts[step] < description->Attempts)
+        {
+            printf("Sensor %d: No %s response, sending again. \n", bringUp->SensorIndex, description->Name);
+            bringUp->Attempts[step]++;
+            bringUp->Deadline[step] = now + description->Timeout * 1000ull;
+            return step;
+        }
+    }
+
+    return BringUpStepCount;
+}
+
+/*  Marks a step as done when its response arrives.
+ *
+ *  @return true if the step was waiting for this response, false if it is a repeated or unrequested response.
+*/
+bool BringUpComplete(BringUp * bringUp, BringUpStep step, uint64_t now)
+{
+    if (bringUp->State[step] != BringUpStepStateRequested)
+    {
+        return false;
+    }
+
+    bringUp->State[step] = BringUpStepStateDone;
+    bringUp->DoneTime[step] = now;
+
+    // The first touch is measured from the start, the requests from when they were first sent.
+    MetricsBringUpStep(bringUp->SensorIndex, step,
+        now - (step == BringUpStepFirstTouch ? bringUp->StartTime : bringUp->RequestTime[step]));
+
+    return true;
+}
+
+/*  Checks if a step is done.
+ *
+ *  @return true if done.
+*/
+bool BringUpIsDone(const BringUp * bringUp, BringUpStep step)
+{
+    return bringUp->State[step] == BringUpStepStateDone;
+}
+
+/*  Gets a step that timed out on its last attempt.
+ *
+ *  @return failed step, BringUpStepCount if no step failed.
+*/
+BringUpStep BringUpGetFailedStep(const BringUp * bringUp, uint64_t now)
+{
+    for (int step = 0; step < BringUpStepCount; step++)
+    {
+        if (bringUp->State[step] == BringUpStepStateRequested && bringUp->Deadline[step] != 0 &&
+            now >= bringUp->Deadline[step] && bringUp->Attempts[step] >= stepDescriptions[step].Attempts)
+        {
+            return step;
+        }
+    }
+
+    return BringUpStepCount;
+}
+
+/*  Gets the time until the next response deadline.
+ *
+ *  @return timeout in milliseconds, at most maxTimeoutInMs.
+*/
+int32_t BringUpGetTimeoutInMs(const BringUp * bringUp, uint64_t now, int32_t maxTimeoutInMs)
+{
+    int32_t timeout = maxTimeoutInMs;
+
+    for (int step = 0; step < BringUpStepCount; step++)
+    {
+        if (bringUp->State[step] != BringUpStepStateRequested || bringUp->Deadline[step] == 0)
+        {
+            continue;
+        }
+
+        // Round up so the deadline has passed when the wait ends.
+        int32_t remaining = now >= bringUp->Deadline[step] ? 0 : (int32_t)((bringUp->Deadline[step] - now + 999) / 1000);
+        if (remaining < timeout)
+        {
+            timeout = remaining;
+        }
+    }
+
+    return timeout;
+}
+
+/*  Gets the name of a step.
+ *
+ *  @return name, never NULL.
+*/
+const char * BringUpGetStepName(BringUpStep step)
+{
+    return step < BringUpStepCount ? stepDescriptions[step].Name : "unknown";
+}
+
+/*  Gets the steps that must be done before a step is requested.
+ *
+ *  @return bit mask of steps.
+*/
+static uint32_t GetDependencies(const BringUp * bringUp, int step)
+{
+    uint32_t dependencies = stepDescriptions[step].Dependencies;
+
+    if (bringUp->IsCached && step == BringUpStepEnable)
+    {
+        dependencies &= ~(STEP(BringUpStepMcuUniqueIdentifier) | STEP(BringUpStepTouchActiveArea));
+    }
+
+    return dependencies;
+}
+
+/*  Prints the duration of every step and the time to first touch.  */
+void BringUpPrintDurations(const BringUp * bringUp)
+{
+    printf("Sensor %d: Bring-up durations: \n", bringUp->SensorIndex);
+    for (int step = 0; step < BringUpStepFirstTouch; step++)
+    {
+        if (bringUp->State[step] == BringUpStepStateDone)
+        {
+            printf("   %-26s %6.1f ms, %d attempts \n", stepDescriptions[step].Name,
+                (bringUp->DoneTime[step] - bringUp->RequestTime[step]) / 1000.0, bringUp->Attempts[step]);
+        }
+    }
+
+    if (bringUp->State[BringUpStepFirstTouch] == BringUpStepStateDone)
+    {
+        // The monotonic clock starts at boot, so its value is the time since boot.
+        printf("   first touch %.1f ms after start, %.1f ms after boot \n",
+            (bringUp->DoneTime[BringUpStepFirstTouch] - bringUp->StartTime) / 1000.0,
+            bringUp->DoneTime[BringUpStepFirstTouch] / 1000.0);
+    }
+}
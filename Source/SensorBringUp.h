@@ -0,0 +1,106 @@
+#ifndef SENSORBRINGUP_H
+#define SENSORBRINGUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*  ********** Sensor bring-up **********
+ *
+ *  Tracks the configuration handshake of a sensor as a set of steps with dependencies instead of a fixed chain.
+ *  Every step whose dependencies are done is requested right away, so the independent configuration requests are in
+ *  flight at the same time and bring-up takes two round trips after connecting instead of five. Each request has a
+ *  response timeout and is sent again a limited number of times before the bring-up fails.
+ *
+ *  With a cached configuration, see sensor_positions.csv, the sensor is enabled without waiting for the identifier and
+ *  touch active area. They are still requested and verified against the cache when their responses arrive.
+ *
+ *  The durations from request to response of every step and the time from start to the first touch are printed and
+ *  published as metrics, so time to first touch after boot can be measured.
+ *
+ *  Each sensor thread owns its BringUp, no locking is needed. Times are monotonic microseconds, see Metrics.h.
+ */
+
+#define BRINGUP_CONNECT_TIMEOUT 10000   // Milliseconds to wait for the connection message.
+#define BRINGUP_STEP_TIMEOUT 500        // Milliseconds to wait for the response of a configuration request.
+#define BRINGUP_STEP_ATTEMPTS 3         // Times a configuration request is sent before the bring-up fails.
+
+typedef enum BringUpStep
+{
+    BringUpStepConnect = 0,
+    BringUpStepOperationModes,
+    BringUpStepMcuUniqueIdentifier,
+    BringUpStepTouchActiveArea,
+    BringUpStepNumberOfTrackedObjects,
+    BringUpStepEnable,
+    BringUpStepFirstTouch,              //!< Not a request, done when the first touch arrives after enabling.
+    BringUpStepCount
+} BringUpStep;
+
+typedef enum BringUpStepState
+{
+    BringUpStepStateIdle = 0,
+    BringUpStepStateRequested,
+    BringUpStepStateDone
+} BringUpStepState;
+
+typedef struct BringUp
+{
+    int              SensorIndex;
+    bool             IsCached;                         //!< Enable without waiting for the identifier and touch active area.
+    uint64_t         StartTime;
+    BringUpStepState State[BringUpStepCount];
+    uint8_t          Attempts[BringUpStepCount];
+    uint64_t         RequestTime[BringUpStepCount];    //!< Time of the first request.
+    uint64_t         Deadline[BringUpStepCount];       //!< Response deadline of the last request.
+    uint64_t         DoneTime[BringUpStepCount];
+} BringUp;
+
+/*  Starts a new bring-up, all steps are idle.  */
+void BringUpStart(BringUp * bringUp, int sensorIndex, uint64_t now);
+
+/*  Lets the sensor be enabled with its cached identifier and touch active area. Must be called before the first
+ *  request is sent.
+*/
+void BringUpUseCachedConfiguration(BringUp * bringUp);
+
+/*  Gets the next request to send: a step whose dependencies are done and that is not requested yet, or a requested step
+ *  whose response timed out and that has attempts left. The step is marked as requested.
+ *
+ *  @return step to send, BringUpStepCount if there is nothing to send now.
+*/
+BringUpStep BringUpGetNextRequest(BringUp * bringUp, uint64_t now);
+
+/*  Marks a step as done when its response arrives.
+ *
+ *  @return true if the step was waiting for this response, false if it is a repeated or unrequested response.
+*/
+bool BringUpComplete(BringUp * bringUp, BringUpStep step, uint64_t now);
+
+/*  Checks if a step is done.
+ *
+ *  @return true if done.
+*/
+bool BringUpIsDone(const BringUp * bringUp, BringUpStep step);
+
+/*  Gets a step that timed out on its last attempt.
+ *
+ *  @return failed step, BringUpStepCount if no step failed.
+*/
+BringUpStep BringUpGetFailedStep(const BringUp * bringUp, uint64_t now);
+
+/*  Gets the time until the next response deadline.
+ *
+ *  @return timeout in milliseconds, at most maxTimeoutInMs.
+*/
+int32_t BringUpGetTimeoutInMs(const BringUp * bringUp, uint64_t now, int32_t maxTimeoutInMs);
+
+/*  Gets the name of a step.
+ *
+ *  @return name, never NULL.
+*/
+const char * BringUpGetStepName(BringUpStep step);
+
+/*  Prints the duration of every step and the time to first touch.  */
+void BringUpPrintDurations(const BringUp * bringUp);
+
+#endif // SENSORBRINGUP_H
@@ -0,0 +1,795 @@
+#include "Settings.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <ctype.h>
+
+typedef enum SettingType
+{
+    SettingTypeBool,
+    SettingTypeInt,
+    SettingTypeFloat,
+    SettingTypeString
+} SettingType;
+
+typedef struct SettingDescription
+{
+    const char * Name;
+    SettingType  Type;
+    size_t       Offset;
+    bool         IsReloadable;  // Takes effect on ReloadSettings, otherwise only at start.
+    const char * Description;
+} SettingDescription;
+
+static bool ReadSettings(Settings * settings);
+static bool ParseArguments(Settings * settings, const char * onlyName);
+static bool ParseSettingsFile(Settings * settings, const char * path);
+static bool ValidateSettings(const Settings * settings);
+static void KeepStartupSettings(Settings * settings, const Settings * current);
+static bool IsSettingEqual(const Settings * a, const Settings * b, const SettingDescription * description);
+static bool PublishSettings(Settings * settings, const Settings * current);
+static void ReclaimSettings(void);
+static bool SaveTunedSettings(const Settings * settings);
+static size_t GetSettingSize(SettingType type);
+static char * Trim(char * text);
+static bool ParseSetting(Settings * settings, const char * name, const char * value);
+static void PrintSettingValue(const Settings * settings, const SettingDescription * description);
+
+static const SettingDescription settingDescriptions[] =
+{
+    { "config", SettingTypeString, offsetof(Settings, ConfigFile), false, "Settings file with one name=value per line, read at start and again on SIGHUP." },
+    { "sensors", SettingTypeInt, offsetof(Settings, Sensors), false, "Number of sensors, 2 or 4." },
+    { "horizontal-sensors", SettingTypeBool, offsetof(Settings, HorizontalSensors), false, "Sensors are mounted at the top and bottom of the screen, false for the left and right sides." },
+    { "screen-width", SettingTypeInt, offsetof(Settings, ScreenWidth), false, "Width of the host screen in 1/10 mm." },
+    { "screen-height", SettingTypeInt, offsetof(Settings, ScreenHeight), false, "Height of the host screen in 1/10 mm." },
+    { "verbose", SettingTypeBool, offsetof(Settings, Verbose), true, "Print every merged touch and the merger decisions." },
+    { "output", SettingTypeString, offsetof(Settings, Outputs), false, "Output backends: hidg, uinput, udp, shm. Several can be combined, e.g. hidg,udp." },
+    { "udp-target", SettingTypeString, offsetof(Settings, UdpTarget), false, "Host:port the udp backend sends TUIO 2Dcur messages to." },
+    { "shm-raw", SettingTypeBool, offsetof(Settings, ShmRawTouches), false, "Also publish unprocessed sensor touches to the shm touch stream." },
+    { "hid-report", SettingTypeString, offsetof(Settings, HidReport), false, "Report format of the hidg backend: mouse or digitizer. Must match the descriptor set up by Scripts/neonode_usb." },
+    { "metrics-group", SettingTypeString, offsetof(Settings, MetricsGroup), false, "Group whose members may read the metrics socket, empty for root only." },
+    { "tracked-objects", SettingTypeInt, offsetof(Settings, TrackedObjects), false, "Number of simultaneous touches each sensor tracks, 1 to 5." },
+    { "smoothing-min-cutoff", SettingTypeFloat, offsetof(Settings, SmoothingMinCutoff), true, "Smoothing cutoff frequency in Hz when the finger is still. Lower gives less jitter." },
+    { "smoothing-beta", SettingTypeFloat, offsetof(Settings, SmoothingBeta), true, "Smoothing cutoff increase with speed. Higher gives less lag when moving." },
+    { "smoothing-d-cutoff", SettingTypeFloat, offsetof(Settings, SmoothingDerivateCutoff), true, "Cutoff frequency in Hz for the speed used by the smoothing." },
+    { "prediction-horizon", SettingTypeInt, offsetof(Settings, PredictionHorizon), true, "Milliseconds to extrapolate moving touches ahead to hide latency, 0 disables. Typically 10 to 30." },
+    { "report-rate", SettingTypeInt, offsetof(Settings, ReportRate), true, "Reports per second of moving touches, e.g. 125, 250 or 500. 0 reports every merged sensor touch." },
+    { "seam-hysteresis", SettingTypeInt, offsetof(Settings, SeamHysteresis), true, "Distance in 1/10 mm a touch must be past the middle of an overlap before the other sensor takes over." },
+    { "seam-crossfade", SettingTypeInt, offsetof(Settings, SeamCrossfade), true, "Distance in 1/10 mm over which the position fades between sensors in an overlap, 0 for the whole overlap." },
+    { "consensus-window", SettingTypeInt, offsetof(Settings, ConsensusWindow), true, "Milliseconds a new touch in an overlap waits for the opposite sensor to confirm it before it is rejected as a ghost, 0 disables." },
+    { "speculative-up", SettingTypeBool, offsetof(Settings, SpeculativeUp), true, "Report releases right away instead of after the up timeout, and press again if the touch comes back." },
+    { "speculative-up-max-rate", SettingTypeFloat, offsetof(Settings, SpeculativeUpMaxRate), true, "Fraction of releases touched again within the up timeout above which speculative-up pauses." },
+    { "up-timeout-frames", SettingTypeInt, offsetof(Settings, UpTimeoutFrames), true, "Sensor frames without a touch before a release is reported, measured from the sensor frame rate. 0 always waits up-timeout." },
+    { "up-timeout", SettingTypeInt, offsetof(Settings, UpTimeout), true, "Longest wait in ms before a release is reported, and the wait until the sensor frame rate is known." },
+    { "debounce-frames", SettingTypeInt, offsetof(Settings, DebounceFrames), true, "Sensor frames in which a bounce of a touch is removed, measured from the sensor frame rate. 0 always uses debounce-interval." },
+    { "debounce-interval", SettingTypeInt, offsetof(Settings, DebounceInterval), true, "Longest debounce window in ms, and the window until the sensor frame rate is known." },
+    { "touch-history", SettingTypeInt, offsetof(Settings, TouchHistory), false, "Touches kept per contact for debouncing and deghosting, 2 to 32." },
+    { "deghost-speed-limit", SettingTypeInt, offsetof(Settings, DeghostSpeedLimit), true, "Touches moving faster than this many mm per ms are dropped as ghosts." },
+    { "queue-timeout", SettingTypeInt, offsetof(Settings, QueueTimeout), true, "Longest wait in ms of the main and sensor group threads for messages, and so for a reload to be noticed." },
+    { "auto-tune", SettingTypeBool, offsetof(Settings, AutoTune), true, "Slowly adapt debounce-interval, up-timeout and deghost-speed-limit to the installation, learned values are kept in " SETTINGS_TUNED_FILE ". Frame derived windows are tuned by their frame counts." },
+    { "auto-tune-debounce-min", SettingTypeInt, offsetof(Settings, AutoTuneDebounceMin), true, "Shortest debounce window in ms auto-tune may choose." },
+    { "auto-tune-debounce-max", SettingTypeInt, offsetof(Settings, AutoTuneDebounceMax), true, "Longest debounce window in ms auto-tune may choose." },
+    { "auto-tune-up-timeout-min", SettingTypeInt, offsetof(Settings, AutoTuneUpTimeoutMin), true, "Shortest up timeout in ms auto-tune may choose." },
+    { "auto-tune-up-timeout-max", SettingTypeInt, offsetof(Settings, AutoTuneUpTimeoutMax), true, "Longest up timeout in ms auto-tune may choose." },
+    { "auto-tune-deghost-min", SettingTypeInt, offsetof(Settings, AutoTuneDeghostMin), true, "Lowest deghost-speed-limit in mm per ms auto-tune may choose." },
+    { "auto-tune-deghost-max", SettingTypeInt, offsetof(Settings, AutoTuneDeghostMax), true, "Highest deghost-speed-limit in mm per ms auto-tune may choose." },
+};
+
+static const Settings defaultSettings =
+{
+    .ConfigFile = SETTINGS_FILE,
+    .Sensors = 2,
+    .HorizontalSensors = true,
+    .ScreenWidth = 3000,
+    .ScreenHeight = 3000,
+    .Verbose = false,
+    .Outputs = "hidg,shm",
+    .UdpTarget = "127.0.0.1:3333",
+    .ShmRawTouches = false,
+    .HidReport = "mouse",
+    .MetricsGroup = "",
+    .TrackedObjects = MAX_CONTACTS,
+    .SmoothingMinCutoff = 1.0f,
+    .SmoothingBeta = 0.007f,
+    .SmoothingDerivateCutoff = 1.0f,
+    .PredictionHorizon = 0,
+    .ReportRate = 0,
+    .SeamHysteresis = 50,
+    .SeamCrossfade = 0,
+    .ConsensusWindow = 30,
+    .SpeculativeUp = false,
+    .SpeculativeUpMaxRate = 0.05f,
+    .UpTimeoutFrames = 4,
+    .UpTimeout = 100,
+    .DebounceFrames = 4,
+    .DebounceInterval = 100,
+    .TouchHistory = 16,
+    .DeghostSpeedLimit = 5,
+    .QueueTimeout = 1000,
+    .AutoTune = false,
+    .AutoTuneDebounceMin = 20,
+    .AutoTuneDebounceMax = 150,
+    .AutoTuneUpTimeoutMin = 20,
+    .AutoTuneUpTimeoutMax = 200,
+    .AutoTuneDeghostMin = 2,
+    .AutoTuneDeghostMax = 10,
+};
+
+typedef struct RetiredSettings RetiredSettings;
+
+struct RetiredSettings
+{
+    Settings        * Settings;
+    uint64_t          Epoch;        // Value of settingsEpoch after the snapshot was replaced.
+    RetiredSettings * Next;
+};
+
+static Settings           startupSettings;
+static const Settings   * currentSettings = &defaultSettings;     // Only replaced with an atomic store.
+static uint64_t           settingsEpoch = 1;                      // Incremented every time the current settings are replaced.
+static uint64_t           readerEpochs[SETTINGS_MAX_READERS] = { 0 };   // settingsEpoch at the last quiescent state of each reader, 0 if the slot is free.
+static bool               isReaderUnregistered = false;           // A reader found no free slot, so replaced snapshots are never freed.
+static __thread int       readerSlot = -1;                        // Slot of the calling thread in readerEpochs, -1 if not registered.
+static RetiredSettings  * retiredSettings = NULL;                 // Replaced snapshots, only used by the thread replacing the settings.
+static int              argumentCount = 0;
+static char          ** arguments = NULL;
+
+/*  Gets the current settings. Never blocks.
+ *
+ *  @return pointer to the settings, never NULL.
+*/
+const Settings * GetSettings(void)
+{
+    return __atomic_load_n(&currentSettings, __ATOMIC_ACQUIRE);
+}
+
+/*  Reports that the calling thread holds no pointer returned by GetSettings, and registers it as a reader on the first
+ *  call. Never blocks.
+*/
+void SettingsQuiescentState(void)
+{
+    uint64_t epoch = __atomic_load_n(&settingsEpoch, __ATOMIC_SEQ_CST);
+
+    if (readerSlot >= 0)
+    {
+        __atomic_store_n(&readerEpochs[readerSlot], epoch, __ATOMIC_SEQ_CST);
+    }
+    else
+    {
+        for (int i = 0; i < SETTINGS_MAX_READERS && readerSlot < 0; i++)
+        {
+            uint64_t expected = 0;
+            if (__atomic_compare_exchange_n(&readerEpochs[i], &expected, epoch, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            {
+                readerSlot = i;
+            }
+        }
+        if (readerSlot < 0)
+        {
+            __atomic_store_n(&isReaderUnregistered, true, __ATOMIC_SEQ_CST);
+        }
+    }
+
+    // Pairs with the fence in PublishSettings: either the replacing thread sees this state, or the next GetSettings
+    // of this thread returns the new snapshot.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/*  Unregisters the calling thread as a reader, it must not call GetSettings afterwards.  */
+void SettingsThreadExit(void)
+{
+    if (readerSlot >= 0)
+    {
+        __atomic_store_n(&readerEpochs[readerSlot], 0, __ATOMIC_SEQ_CST);
+        readerSlot = -1;
+    }
+}
+
+/*  Reads the settings file and parses command line arguments on the form --name=value into the settings. The arguments
+ *  are kept for ReloadSettings. Boolean settings can be given without a value to enable them.
+ *
+ *  @return true on success, false if a setting is unknown or has an invalid value.
+*/
+bool ParseSettingsArguments(int argc, char * argv[])
+{
+    argumentCount = argc;
+    arguments = argv;
+
+    if (!ReadSettings(&startupSettings))
+    {
+        return false;
+    }
+
+    __atomic_store_n(&currentSettings, &startupSettings, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*  Reads the settings file and the command line again and replaces the current settings. Settings used only at start
+ *  are not changed. Must not be called from a signal handler, and not from several threads at the same time.
+ *
+ *  @return true on success, false if the settings are invalid and the current ones are kept.
+*/
+bool ReloadSettings(void)
+{
+    const Settings * current = GetSettings();
+    Settings * settings = (Settings *)malloc(sizeof(Settings));
+
+    if (settings == NULL)
+    {
+        return false;
+    }
+
+    if (!ReadSettings(settings))
+    {
+        printf("Error: Keeping the current settings. \n");
+        free(settings);
+        return false;
+    }
+
+    KeepStartupSettings(settings, current);
+    return PublishSettings(settings, current);
+}
+
+/*  Replaces the debounce window, up timeout and deghost speed limit of the current settings with learned values, and
+ *  saves them to SETTINGS_TUNED_FILE. The windows are given as frame counts and fixed windows in ms, as the settings
+ *  hold them. Must not be called from several threads at the same time, nor at the same time as ReloadSettings.
+ *
+ *  @return true on success, false if the values are invalid or out of memory.
+*/
+bool UpdateTunedSettings(int32_t debounceFrames, int32_t debounceInterval, int32_t upTimeoutFrames, int32_t upTimeout,
+    int32_t deghostSpeedLimit)
+{
+    const Settings * current = GetSettings();
+    Settings * settings = (Settings *)malloc(sizeof(Settings));
+
+    if (settings == NULL)
+    {
+        return false;
+    }
+
+    *settings = *current;
+    settings->DebounceFrames = debounceFrames;
+    settings->DebounceInterval = debounceInterval;
+    settings->UpTimeoutFrames = upTimeoutFrames;
+    settings->UpTimeout = upTimeout;
+    settings->DeghostSpeedLimit = deghostSpeedLimit;
+
+    if (!ValidateSettings(settings))
+    {
+        free(settings);
+        return false;
+    }
+
+    // A value that could not be saved is learned again after a restart.
+    SaveTunedSettings(settings);
+    return PublishSettings(settings, current);
+}
+
+/*  Prints the available settings with their current values.  */
+void PrintSettingsUsage(const char * applicationName)
+{
+    printf("Usage: %s [--setting=value ...]\n\n", applicationName);
+    for (size_t i = 0; i < sizeof(settingDescriptions) / sizeof(settingDescriptions[0]); i++)
+    {
+        printf("  --%s=", settingDescriptions[i].Name);
+        PrintSettingValue(GetSettings(), &settingDescriptions[i]);
+        printf("\n      %s\n", settingDescriptions[i].Description);
+    }
+}
+
+/*  Reads the defaults, the settings file and the command line into given settings. The file named on the command line
+ *  is read first, and the other arguments override its values. With auto-tune the learned values override both.
+ *
+ *  @return true on success, false if a setting is unknown or has an invalid value.
+*/
+static bool ReadSettings(Settings * settings)
+{
+    *settings = defaultSettings;
+
+    return ParseArguments(settings, "config") &&
+           ParseSettingsFile(settings, settings->ConfigFile) &&
+           ParseArguments(settings, NULL) &&
+           (!settings->AutoTune || ParseSettingsFile(settings, SETTINGS_TUNED_FILE)) &&
+           ValidateSettings(settings);
+}
+
+/*  Parses the kept command line arguments into given settings.
+ *
+ *  @return true on success, false if an argument is unknown or has an invalid value.
+*/
+static bool ParseArguments(Settings * settings, const char * onlyName)
+{
+    for (int i = 1; i < argumentCount; i++)
+    {
+        char name[MAX_SETTING_STRING_SIZE] = { 0 };
+        const char * argument = arguments[i];
+
+        if (strncmp(argument, "--", 2) != 0)
+        {
+            printf("Error: Unexpected argument '%s'. \n", argument);
+            return false;
+        }
+        argument += 2;
+
+        if (strcmp(argument, "help") == 0)
+        {
+            return false;
+        }
+
+        const char * value = strchr(argument, '=');
+        size_t nameLength = value != NULL ? (size_t)(value - argument) : strlen(argument);
+        if (nameLength >= sizeof(name))
+        {
+            printf("Error: Unknown setting '%s'. \n", argument);
+            return false;
+        }
+        memcpy(name, argument, nameLength);
+
+        if (onlyName != NULL && strcmp(name, onlyName) != 0)
+        {
+            continue;
+        }
+
+        if (!ParseSetting(settings, name, value != NULL ? value + 1 : NULL))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*  Parses a settings file into given settings. Empty lines and text after # are ignored. The default file and the file
+ *  of learned values do not have to exist.
+ *
+ *  @return true on success, false if the file can not be read or a setting is unknown or has an invalid value.
+*/
+static bool ParseSettingsFile(Settings * settings, const char * path)
+{
+    char line[MAX_SETTING_STRING_SIZE * 2];
+    int lineNumber = 0;
+    bool result = true;
+    FILE * file = fopen(path, "r");
+
+    if (file == NULL)
+    {
+        if (errno == ENOENT && (strcmp(path, SETTINGS_FILE) == 0 || strcmp(path, SETTINGS_TUNED_FILE) == 0))
+        {
+            return true;
+        }
+        printf("Error: Reading settings file %s: %s. \n", path, strerror(errno));
+        return false;
+    }
+
+    while (result && fgets(line, sizeof(line), file))
+    {
+        lineNumber++;
+        line[strcspn(line, "#\r\n")] = 0;
+
+        char * value = strchr(line, '=');
+        if (value != NULL)
+        {
+            *value++ = 0;
+            value = Trim(value);
+        }
+
+        char * name = Trim(line);
+        if (name[0] == 0)
+        {
+            continue;
+        }
+
+        if (!ParseSetting(settings, name, value))
+        {
+            printf("Error: In %s line %d. \n", path, lineNumber);
+            result = false;
+        }
+    }
+
+    fclose(file);
+    return result;
+}
+
+/*  Checks that the values of the settings are in range.
+ *
+ *  @return true if valid.
+*/
+static bool ValidateSettings(const Settings * settings)
+{
+    if (settings->Sensors != 2 && settings->Sensors != 4)
+    {
+        printf("Error: sensors must be 2 or 4. \n");
+        return false;
+    }
+
+    if (settings->ScreenWidth <= 0 || settings->ScreenHeight <= 0)
+    {
+        printf("Error: screen-width and screen-height must be positive. \n");
+        return false;
+    }
+
+    if (settings->TrackedObjects < 1 || settings->TrackedObjects > MAX_CONTACTS)
+    {
+        printf("Error: tracked-objects must be between 1 and %d. \n", MAX_CONTACTS);
+        return false;
+    }
+
+    if (settings->SmoothingMinCutoff <= 0 || settings->SmoothingBeta < 0 || settings->SmoothingDerivateCutoff <= 0)
+    {
+        printf("Error: smoothing cutoffs must be positive and smoothing-beta not negative. \n");
+        return false;
+    }
+
+    if (settings->PredictionHorizon < 0 || settings->PredictionHorizon > 100)
+    {
+        printf("Error: prediction-horizon must be between 0 and 100 ms. \n");
+        return false;
+    }
+
+    if (settings->ReportRate < 0 || settings->ReportRate > 1000)
+    {
+        printf("Error: report-rate must be between 0 and 1000. \n");
+        return false;
+    }
+
+    if (settings->SeamHysteresis < 0 || settings->SeamCrossfade < 0)
+    {
+        printf("Error: seam-hysteresis and seam-crossfade must not be negative. \n");
+        return false;
+    }
+
+    if (settings->ConsensusWindow < 0 || settings->ConsensusWindow > 100)
+    {
+        printf("Error: consensus-window must be between 0 and 100 ms. \n");
+        return false;
+    }
+
+    if (settings->SpeculativeUpMaxRate < 0 || settings->SpeculativeUpMaxRate > 1)
+    {
+        printf("Error: speculative-up-max-rate must be between 0 and 1. \n");
+        return false;
+    }
+
+    if (settings->UpTimeoutFrames < 0 || settings->DebounceFrames < 0)
+    {
+        printf("Error: up-timeout-frames and debounce-frames must not be negative. \n");
+        return false;
+    }
+
+    // The shortest timeout is MIN_TIMEOUT in Merger.h.
+    if (settings->UpTimeout < 20 || settings->UpTimeout > 1000 || settings->DebounceInterval < 20 || settings->DebounceInterval > 1000)
+    {
+        printf("Error: up-timeout and debounce-interval must be between 20 and 1000 ms. \n");
+        return false;
+    }
+
+    if (settings->TouchHistory < 2 || settings->TouchHistory > MAX_TOUCH_BUF_SIZE)
+    {
+        printf("Error: touch-history must be between 2 and %d. \n", MAX_TOUCH_BUF_SIZE);
+        return false;
+    }
+
+    if (settings->DeghostSpeedLimit < 1)
+    {
+        printf("Error: deghost-speed-limit must be positive. \n");
+        return false;
+    }
+
+    if (settings->QueueTimeout < 1 || settings->QueueTimeout > 10000)
+    {
+        printf("Error: queue-timeout must be between 1 and 10000 ms. \n");
+        return false;
+    }
+
+    if (settings->AutoTuneDebounceMin < 20 || settings->AutoTuneDebounceMin > settings->AutoTuneDebounceMax || settings->AutoTuneDebounceMax > 1000 ||
+        settings->AutoTuneUpTimeoutMin < 20 || settings->AutoTuneUpTimeoutMin > settings->AutoTuneUpTimeoutMax || settings->AutoTuneUpTimeoutMax > 1000)
+    {
+        printf("Error: auto-tune debounce and up-timeout bounds must be between 20 and 1000 ms, min not above max. \n");
+        return false;
+    }
+
+    if (settings->AutoTuneDeghostMin < 1 || settings->AutoTuneDeghostMin > settings->AutoTuneDeghostMax)
+    {
+        printf("Error: auto-tune deghost bounds must be positive, min not above max. \n");
+        return false;
+    }
+
+    return true;
+}
+
+/*  Copies the settings used only at start from the current settings, and prints the settings that change.  */
+static void KeepStartupSettings(Settings * settings, const Settings * current)
+{
+    printf("Reloading settings from %s. \n", current->ConfigFile);
+
+    for (size_t i = 0; i < sizeof(settingDescriptions) / sizeof(settingDescriptions[0]); i++)
+    {
+        const SettingDescription * description = &settingDescriptions[i];
+        if (IsSettingEqual(settings, current, description))
+        {
+            continue;
+        }
+
+        if (!description->IsReloadable)
+        {
+            printf("   %s is only changed on the next start. \n", description->Name);
+            memcpy((char *)settings + description->Offset, (const char *)current + description->Offset, GetSettingSize(description->Type));
+            continue;
+        }
+
+        printf("   %s: ", description->Name);
+        PrintSettingValue(current, description);
+        printf(" -> ");
+        PrintSettingValue(settings, description);
+        printf("\n");
+    }
+}
+
+/*  Compares a setting of two snapshots.
+ *
+ *  @return true if equal.
+*/
+static bool IsSettingEqual(const Settings * a, const Settings * b, const SettingDescription * description)
+{
+    const void * fieldA = (const char *)a + description->Offset;
+    const void * fieldB = (const char *)b + description->Offset;
+
+    switch (description->Type)
+    {
+        case SettingTypeBool:
+            return *(const bool *)fieldA == *(const bool *)fieldB;
+        case SettingTypeInt:
+            return *(const int32_t *)fieldA == *(const int32_t *)fieldB;
+        case SettingTypeFloat:
+            return *(const float *)fieldA == *(const float *)fieldB;
+        case SettingTypeString:
+            return strcmp((const char *)fieldA, (const char *)fieldB) == 0;
+    }
+
+    return true;
+}
+
+/*  Gets the size of a setting field.
+ *
+ *  @return size in bytes.
+*/
+static size_t GetSettingSize(SettingType type)
+{
+    switch (type)
+    {
+        case SettingTypeBool:
+            return sizeof(bool);
+        case SettingTypeInt:
+            return sizeof(int32_t);
+        case SettingTypeFloat:
+            return sizeof(float);
+        case SettingTypeString:
+            return MAX_SETTING_STRING_SIZE;
+    }
+
+    return 0;
+}
+
+/*  Makes given settings the current ones. The replaced snapshot is freed once every reader has passed a quiescent
+ *  state, see ReclaimSettings. The startup snapshot is never freed.
+ *
+ *  @return true on success, false if out of memory and the current ones are kept.
+*/
+static bool PublishSettings(Settings * settings, const Settings * current)
+{
+    RetiredSettings * retired = NULL;
+
+    if (current != &startupSettings && current != &defaultSettings)
+    {
+        retired = (RetiredSettings *)malloc(sizeof(RetiredSettings));
+        if (retired == NULL)
+        {
+            printf("Error: Out of memory, keeping the current settings. \n");
+            free(settings);
+            return false;
+        }
+    }
+
+    __atomic_store_n(&currentSettings, settings, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint64_t epoch = __atomic_add_fetch(&settingsEpoch, 1, __ATOMIC_SEQ_CST);
+
+    if (retired != NULL)
+    {
+        retired->Settings = (Settings *)current;
+        retired->Epoch = epoch;
+        retired->Next = retiredSettings;
+        retiredSettings = retired;
+    }
+
+    ReclaimSettings();
+    return true;
+}
+
+/*  Frees the replaced snapshots that no reader can use any more, those replaced before the last quiescent state of
+ *  every registered reader. A reader passing a quiescent state at a later epoch loaded settingsEpoch after the
+ *  snapshot was replaced, so its following GetSettings calls return a newer one.
+*/
+static void ReclaimSettings(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&isReaderUnregistered, __ATOMIC_SEQ_CST))
+    {
+        return;
+    }
+
+    uint64_t oldestEpoch = UINT64_MAX;
+    for (int i = 0; i < SETTINGS_MAX_READERS; i++)
+    {
+        uint64_t epoch = __atomic_load_n(&readerEpochs[i], __ATOMIC_SEQ_CST);
+        if (epoch != 0 && epoch < oldestEpoch)
+        {
+            oldestEpoch = epoch;
+        }
+    }
+
+    RetiredSettings ** link = &retiredSettings;
+    while (*link != NULL)
+    {
+        RetiredSettings * retired = *link;
+        if (retired->Epoch <= oldestEpoch)
+        {
+            *link = retired->Next;
+            free(retired->Settings);
+            free(retired);
+        }
+        else
+        {
+            link = &retired->Next;
+        }
+    }
+}
+
+/*  Writes the learned values of given settings to SETTINGS_TUNED_FILE. A temporary file is renamed over the old one, so
+ *  a power loss leaves either the old or the new values.
+ *
+ *  @return true on success, false on fail.
+*/
+static bool SaveTunedSettings(const Settings * settings)
+{
+    const char * temporaryPath = SETTINGS_TUNED_FILE ".tmp";
+    FILE * file = fopen(temporaryPath, "w");
+
+    if (file == NULL)
+    {
+        perror("Error: Writing " SETTINGS_TUNED_FILE);
+        return false;
+    }
+
+    fprintf(file, "# Learned by auto-tune, delete this file to start over from the configured values.\n");
+    fprintf(file, "debounce-frames = %d\n", settings->DebounceFrames);
+    fprintf(file, "debounce-interval = %d\n", settings->DebounceInterval);
+    fprintf(file, "up-timeout-frames = %d\n", settings->UpTimeoutFrames);
+    fprintf(file, "up-timeout = %d\n", settings->UpTimeout);
+    fprintf(file, "deghost-speed-limit = %d\n", settings->DeghostSpeedLimit);
+
+    if (fclose(file) != 0 || rename(temporaryPath, SETTINGS_TUNED_FILE) != 0)
+    {
+        perror("Error: Writing " SETTINGS_TUNED_FILE);
+        remove(temporaryPath);
+        return false;
+    }
+
+    return true;
+}
+
+/*  Removes leading and trailing white space, in place.
+ *
+ *  @return trimmed text.
+*/
+static char * Trim(char * text)
+{
+    while (isspace((unsigned char)*text))
+    {
+        text++;
+    }
+
+    size_t length = strlen(text);
+    while (length > 0 && isspace((unsigned char)text[length - 1]))
+    {
+        text[--length] = 0;
+    }
+
+    return text;
+}
+
+/*  Parses the value of a single setting into given settings.
+ *
+ *  @return true on success, false if the setting is unknown or the value is invalid.
+*/
+static bool ParseSetting(Settings * settings, const char * name, const char * value)
+{
+    for (size_t i = 0; i < sizeof(settingDescriptions) / sizeof(settingDescriptions[0]); i++)
+    {
+        const SettingDescription * description = &settingDescriptions[i];
+        if (strcmp(description->Name, name) != 0)
+        {
+            continue;
+        }
+
+        void * field = (char *)settings + description->Offset;
+        char * end = NULL;
+        errno = 0;
+
+        if (value == NULL && description->Type != SettingTypeBool)
+        {
+            printf("Error: Setting '%s' needs a value. \n", name);
+            return false;
+        }
+
+        switch (description->Type)
+        {
+            case SettingTypeBool:
+                if (value == NULL || strcmp(value, "1") == 0 || strcmp(value, "true") == 0 || strcmp(value, "yes") == 0)
+                {
+                    *(bool *)field = true;
+                }
+                else if (strcmp(value, "0") == 0 || strcmp(value, "false") == 0 || strcmp(value, "no") == 0)
+                {
+                    *(bool *)field = false;
+                }
+                else
+                {
+                    end = (char *)value; // Flag as invalid.
+                }
+            break;
+            case SettingTypeInt:
+                *(int32_t *)field = strtol(value, &end, 0);
+            break;
+            case SettingTypeFloat:
+                *(float *)field = strtof(value, &end);
+            break;
+            case SettingTypeString:
+                if (strlen(value) >= MAX_SETTING_STRING_SIZE)
+                {
+                    end = (char *)value;
+                }
+                else
+                {
+                    strcpy((char *)field, value);
+                }
+            break;
+        }
+
+        if (errno != 0 || (end != NULL && (end == value || *end != 0)))
+        {
+            printf("Error: Invalid value '%s' for setting '%s'. \n", value, name);
+            return false;
+        }
+
+        return true;
+    }
+
+    printf("Error: Unknown setting '%s'. \n", name);
+    return false;
+}
+
+/*  Prints the value of a setting.  */
+static void PrintSettingValue(const Settings * settings, const SettingDescription * description)
+{
+    const void * field = (const char *)settings + description->Offset;
+
+    switch (description->Type)
+    {
+        case SettingTypeBool:
+            printf("%s", *(const bool *)field ? "true" : "false");
+        break;
+        case SettingTypeInt:
+            printf("%d", *(const int32_t *)field);
+        break;
+        case SettingTypeFloat:
+            printf("%g", *(const float *)field);
+        break;
+        case SettingTypeString:
+            printf("%s", (const char *)field);
+        break;
+    }
+}
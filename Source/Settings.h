@@ -0,0 +1,110 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Common.h"
+
+#define MAX_SETTING_STRING_SIZE 128
+#define SETTINGS_FILE "settings.conf"       // Read at start and on SIGHUP unless --config names another file.
+#define SETTINGS_MAX_READERS 16             // Threads reporting quiescent states, see SettingsQuiescentState.
+#define SETTINGS_TUNED_FILE "tuned.conf"    // Values learned by the auto-tuner, read after the settings and the command line.
+
+/*  ********** Settings **********
+ *
+ *  Settings are read from the settings file, one name=value per line with the names of the command line arguments, and
+ *  then from the command line, which takes precedence. On ReloadSettings the file and the command line are read again
+ *  into a new snapshot, which replaces the current one with an atomic pointer swap, so readers never wait. Settings
+ *  used only at start keep their values until the next start.
+ *
+ *  A replaced snapshot is freed once every reader thread has passed a quiescent state, a point where it holds no
+ *  pointer returned by GetSettings. Every thread that calls GetSettings reports one with SettingsQuiescentState before
+ *  its first GetSettings and at the top of its loop, and calls SettingsThreadExit when it ends. A reader that blocks
+ *  only delays the freeing, it never sees a freed snapshot.
+ *
+ *  With auto-tune the values learned for the installation are kept in SETTINGS_TUNED_FILE, in the same format, and
+ *  replace the configured ones until the file is deleted.
+ */
+
+/*  Settings that can be changed at runtime without rebuilding the application.  */
+typedef struct Settings
+{
+    char ConfigFile[MAX_SETTING_STRING_SIZE];   // Settings file, see SETTINGS_FILE.
+    int32_t Sensors;                            // Number of sensors, 2 or 4, at most MAX_SENSORS.
+    bool HorizontalSensors;                     // Sensors are mounted at the top and bottom of the screen, otherwise on the sides.
+    int32_t ScreenWidth;                        // Width of the host screen in 1/10 mm.
+    int32_t ScreenHeight;                       // Height of the host screen in 1/10 mm.
+    bool Verbose;                               // Print every merged touch and the merger decisions.
+    char Outputs[MAX_SETTING_STRING_SIZE];      // Comma separated list of output backends, see Output.h.
+    char UdpTarget[MAX_SETTING_STRING_SIZE];    // Host and port the udp backend sends TUIO messages to.
+    bool ShmRawTouches;                         // Also publish the unprocessed touches from each sensor to the touch stream.
+    char HidReport[MAX_SETTING_STRING_SIZE];    // Report format of the hidg backend, mouse or digitizer.
+    char MetricsGroup[MAX_SETTING_STRING_SIZE]; // Group allowed to read the metrics socket, empty for root only.
+    int32_t TrackedObjects;                     // Number of touches each sensor tracks, 1 to MAX_CONTACTS.
+    float SmoothingMinCutoff;                   // One Euro filter cutoff frequency at rest in Hz, see OneEuroFilter.h.
+    float SmoothingBeta;                        // One Euro filter cutoff increase per 1/10 mm/s of speed.
+    float SmoothingDerivateCutoff;              // One Euro filter cutoff frequency in Hz for the speed estimate.
+    int32_t PredictionHorizon;                  // Milliseconds the reported position is extrapolated ahead, 0 disables prediction.
+    int32_t ReportRate;                         // Reports per second of moving contacts, 0 reports every merged touch.
+    int32_t SeamHysteresis;                     // Distance in 1/10 mm past the middle of an overlap before a contact changes sensor.
+    int32_t SeamCrossfade;                      // Distance in 1/10 mm over which positions are faded between sensors, 0 for the whole overlap.
+    int32_t ConsensusWindow;                    // Milliseconds a new touch in an overlap waits for the opposite sensor, 0 disables.
+    bool SpeculativeUp;                         // Report releases right away and correct them if the touch comes back.
+    float SpeculativeUpMaxRate;                 // Highest re-touch rate of releases at which up events are still speculative.
+    int32_t UpTimeoutFrames;                    // Sensor frames without a touch before a release is confirmed, 0 for a fixed UpTimeout.
+    int32_t UpTimeout;                          // Longest up pending timeout in ms, used until the sensor frame rate is known.
+    int32_t DebounceFrames;                     // Sensor frames of the debounce window, 0 for a fixed DebounceInterval.
+    int32_t DebounceInterval;                   // Longest debounce window in ms, used until the sensor frame rate is known.
+    int32_t TouchHistory;                       // Touches kept per contact, at most MAX_TOUCH_BUF_SIZE.
+    int32_t DeghostSpeedLimit;                  // Touches moving faster than this many mm per ms are dropped as ghosts.
+    int32_t QueueTimeout;                       // Longest wait in ms of the main and sensor group threads for messages.
+    bool AutoTune;                              // Adapt the debounce window, up timeout and deghost speed limit, see AutoTune.h.
+    int32_t AutoTuneDebounceMin;                // Bounds of the learned debounce window in ms.
+    int32_t AutoTuneDebounceMax;
+    int32_t AutoTuneUpTimeoutMin;               // Bounds of the learned up pending timeout in ms.
+    int32_t AutoTuneUpTimeoutMax;
+    int32_t AutoTuneDeghostMin;                 // Bounds of the learned deghost-speed-limit in mm per ms.
+    int32_t AutoTuneDeghostMax;
+} Settings;
+
+/*  Gets the current settings. Never blocks.
+ *
+ *  @return pointer to the settings, never NULL.
+*/
+const Settings * GetSettings(void);
+
+/*  Reports that the calling thread holds no pointer returned by GetSettings, and registers it as a reader on the first
+ *  call. Never blocks.
+*/
+void SettingsQuiescentState(void);
+
+/*  Unregisters the calling thread as a reader, it must not call GetSettings afterwards.  */
+void SettingsThreadExit(void);
+
+/*  Reads the settings file and parses command line arguments on the form --name=value into the settings. The arguments
+ *  are kept for ReloadSettings.
+ *
+ *  @return true on success, false if a setting is unknown or has an invalid value.
+*/
+bool ParseSettingsArguments(int argc, char * argv[]);
+
+/*  Reads the settings file and the command line again and replaces the current settings. Settings used only at start
+ *  are not changed. Must not be called from a signal handler, and not from several threads at the same time.
+ *
+ *  @return true on success, false if the settings are invalid and the current ones are kept.
+*/
+bool ReloadSettings(void);
+
+/*  Replaces the debounce window, up timeout and deghost speed limit of the current settings with learned values, and
+ *  saves them to SETTINGS_TUNED_FILE. The windows are given as frame counts and fixed windows in ms, as the settings
+ *  hold them. Must not be called from several threads at the same time, nor at the same time as ReloadSettings.
+ *
+ *  @return true on success, false if the values are invalid or out of memory.
+*/
+bool UpdateTunedSettings(int32_t debounceFrames, int32_t debounceInterval, int32_t upTimeoutFrames, int32_t upTimeout,
+    int32_t deghostSpeedLimit);
+
+/*  Prints the available settings with their current values.  */
+void PrintSettingsUsage(const char * applicationName);
+
+#endif // SETTINGS_H
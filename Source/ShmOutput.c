@@ -0,0 +1,69 @@
+#include "Output.h"
+#include "Settings.h"
+#include "TouchStream.h"
+#include <stdlib.h>
+
+static bool ShmOpen(OutputBackend * self);
+static bool ShmSend(OutputBackend * self, const TouchFrame * frame);
+static void ShmSendRaw(OutputBackend * self, TouchInfo * info);
+static void ShmClose(OutputBackend * self);
+
+/*  Creates the shared memory touch stream backend.
+ *
+ *  @return new backend, NULL if out of memory.
+*/
+OutputBackend * ShmOutputNew(void)
+{
+    OutputBackend * backend = calloc(1, sizeof(OutputBackend));
+    if (backend == NULL)
+    {
+        return NULL;
+    }
+
+    backend->Name = "shm";
+    backend->Private = NULL;
+    backend->Open = ShmOpen;
+    backend->Send = ShmSend;
+    backend->SendRaw = GetSettings()->ShmRawTouches ? ShmSendRaw : NULL;
+    backend->Close = ShmClose;
+
+    return backend;
+}
+
+/*  Creates the shared memory ring buffer.
+ *
+ *  @return true on success, false on fail.
+*/
+static bool ShmOpen(OutputBackend * self)
+{
+    (void)self;
+    return TouchStreamOpen(TOUCH_STREAM_NAME);
+}
+
+/*  Publishes every contact in the frame as a merged touch.
+ *
+ *  @return always true.
+*/
+static bool ShmSend(OutputBackend * self, const TouchFrame * frame)
+{
+    (void)self;
+    for (int i = 0; i < frame->NumberOfContacts; i++)
+    {
+        TouchStreamPublish(&frame->Contacts[i], TouchStreamRecordMerged);
+    }
+    return true;
+}
+
+/*  Publishes an unprocessed sensor touch.  */
+static void ShmSendRaw(OutputBackend * self, TouchInfo * info)
+{
+    (void)self;
+    TouchStreamPublish(info, TouchStreamRecordRaw);
+}
+
+/*  Removes the shared memory ring buffer.  */
+static void ShmClose(OutputBackend * self)
+{
+    TouchStreamClose();
+    free(self);
+}
@@ -0,0 +1,395 @@
+#include "TouchStream.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static uint32_t NextSequence(uint32_t sequence);
+static size_t GetMappedSize(void);
+static bool GetWaitersName(const char * name, char * waitersName, size_t size);
+static int CreateSharedMemory(const char * name, mode_t mode, size_t size);
+static uint32_t * MapWaiters(const char * name, bool create);
+static long Futex(uint32_t * word, int operation, uint32_t value, const struct timespec * timeout);
+
+// Writer side, only used by the publishing thread.
+static TouchStreamHeader * header = NULL;
+static TouchStreamRecord * records = NULL;
+static uint32_t          * waiters = NULL;
+static char                streamName[NAME_MAX] = { 0 };
+
+/*  ********** Writer **********
+ *
+ */
+
+/*  Creates the shared memory ring buffer and starts publishing.
+ *
+ *  @return true on success, false on fail.
+*/
+bool TouchStreamOpen(const char * name)
+{
+    const size_t mappedSize = GetMappedSize();
+
+    if (strlen(name) >= sizeof(streamName))
+    {
+        return false;
+    }
+    strcpy(streamName, name);
+
+    // Readers register themselves as waiters, so they need write access to the waiter count even when not running as
+    // root. The ring itself is only readable for them.
+    waiters = MapWaiters(name, true);
+    if (waiters == NULL)
+    {
+        return false;
+    }
+
+    int fd = CreateSharedMemory(name, 0644, mappedSize);
+    if (fd < 0)
+    {
+        perror("Error: Creating touch stream");
+        TouchStreamClose();
+        return false;
+    }
+
+    void * memory = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        perror("Error: Mapping touch stream");
+        TouchStreamClose();
+        return false;
+    }
+
+    header = (TouchStreamHeader *)memory;
+    records = (TouchStreamRecord *)(header + 1);
+
+    // Invalidate records left by a previous run before readers can see the header.
+    __atomic_store_n(&header->Magic, 0, __ATOMIC_RELAXED);
+    memset(records, 0, TOUCH_STREAM_CAPACITY * sizeof(TouchStreamRecord));
+    header->Version = TOUCH_STREAM_VERSION;
+    header->Capacity = TOUCH_STREAM_CAPACITY;
+    header->RecordSize = sizeof(TouchStreamRecord);
+    header->WriteSequence = 0;
+    __atomic_store_n(waiters, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->Magic, TOUCH_STREAM_MAGIC, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/*  Removes the shared memory ring buffer. Readers that still have it mapped keep their mapping.  */
+void TouchStreamClose(void)
+{
+    char waitersName[NAME_MAX];
+
+    if (waiters != NULL)
+    {
+        munmap(waiters, sizeof(uint32_t));
+        waiters = NULL;
+        if (GetWaitersName(streamName, waitersName, sizeof(waitersName)))
+        {
+            shm_unlink(waitersName);
+        }
+    }
+
+    if (header != NULL)
+    {
+        munmap(header, GetMappedSize());
+        shm_unlink(streamName);
+        header = NULL;
+        records = NULL;
+    }
+}
+
+/*  Publishes a touch to all readers. Must only be called from one thread. Never blocks.  */
+void TouchStreamPublish(const TouchInfo * info, TouchStreamRecordType type)
+{
+    if (header == NULL || info == NULL)
+    {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint32_t sequence = NextSequence(header->WriteSequence);
+    TouchStreamRecord * record = &records[sequence & (TOUCH_STREAM_CAPACITY - 1)];
+
+    // Mark the slot as busy before touching the payload, see the protocol description in TouchStream.h.
+    __atomic_store_n(&record->Sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    record->Type = type;
+    record->Event = info->Event;
+    record->SensorPosition = info->SensorConfiguration != NULL ? info->SensorConfiguration->SensorPosition : 0;
+    record->X = info->X;
+    record->Y = info->Y;
+    record->ContactId = info->ContactId;
+    record->Timestamp = info->Timestamp;
+    record->PublishTime = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+    __atomic_store_n(&record->Sequence, sequence, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->WriteSequence, sequence, __ATOMIC_SEQ_CST);
+
+    // Only pay for the syscall when a reader is blocked in TouchStreamWait.
+    if (__atomic_load_n(waiters, __ATOMIC_SEQ_CST) > 0)
+    {
+        Futex(&header->WriteSequence, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
+
+/*  ********** Reader **********
+ *
+ */
+
+/*  Maps the ring buffer of a running application for reading. Reading starts with the next published record.
+ *
+ *  @return true on success, false on fail.
+*/
+bool TouchStreamOpenReader(TouchStreamReader * reader, const char * name)
+{
+    const size_t mappedSize = GetMappedSize();
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) < 0 || (size_t)status.st_size < mappedSize)
+    {
+        close(fd);
+        return false;
+    }
+
+    void * memory = mmap(NULL, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+
+    reader->Header = (TouchStreamHeader *)memory;
+    reader->Records = (TouchStreamRecord *)(reader->Header + 1);
+    reader->MappedSize = mappedSize;
+    reader->Waiters = MapWaiters(name, false);
+
+    if (reader->Waiters == NULL ||
+        __atomic_load_n(&reader->Header->Magic, __ATOMIC_ACQUIRE) != TOUCH_STREAM_MAGIC ||
+        reader->Header->Version != TOUCH_STREAM_VERSION ||
+        reader->Header->Capacity != TOUCH_STREAM_CAPACITY ||
+        reader->Header->RecordSize != sizeof(TouchStreamRecord))
+    {
+        TouchStreamCloseReader(reader);
+        return false;
+    }
+
+    reader->NextSequence = NextSequence(__atomic_load_n(&reader->Header->WriteSequence, __ATOMIC_ACQUIRE));
+
+    return true;
+}
+
+/*  Unmaps the ring buffer.  */
+void TouchStreamCloseReader(TouchStreamReader * reader)
+{
+    if (reader->Waiters != NULL)
+    {
+        munmap(reader->Waiters, sizeof(uint32_t));
+        reader->Waiters = NULL;
+    }
+    if (reader->Header != NULL)
+    {
+        munmap(reader->Header, reader->MappedSize);
+        reader->Header = NULL;
+        reader->Records = NULL;
+    }
+}
+
+/*  Reads the next record without blocking.
+ *
+ *  @return 1 if a record was read, 0 if no new record is available,
+ *          -1 if the reader was lapped by the writer and records were lost. Reading then continues with the oldest record.
+*/
+int TouchStreamRead(TouchStreamReader * reader, TouchStreamRecord * record)
+{
+    uint32_t writeSequence = __atomic_load_n(&reader->Header->WriteSequence, __ATOMIC_ACQUIRE);
+    int32_t available = (int32_t)(writeSequence - reader->NextSequence);
+
+    if (available < 0)
+    {
+        return 0;
+    }
+
+    // Leave one slot of margin since the writer may already be overwriting the oldest record.
+    if (available >= TOUCH_STREAM_CAPACITY - 1)
+    {
+        reader->NextSequence = NextSequence(writeSequence - (TOUCH_STREAM_CAPACITY - 2));
+        return -1;
+    }
+
+    TouchStreamRecord * slot = &reader->Records[reader->NextSequence & (TOUCH_STREAM_CAPACITY - 1)];
+
+    if (__atomic_load_n(&slot->Sequence, __ATOMIC_ACQUIRE) != reader->NextSequence)
+    {
+        reader->NextSequence = NextSequence(writeSequence - (TOUCH_STREAM_CAPACITY - 2));
+        return -1;
+    }
+
+    memcpy(record, slot, sizeof(TouchStreamRecord));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    if (__atomic_load_n(&slot->Sequence, __ATOMIC_RELAXED) != reader->NextSequence)
+    {
+        // Overwritten while copying.
+        reader->NextSequence = NextSequence(writeSequence - (TOUCH_STREAM_CAPACITY - 2));
+        return -1;
+    }
+
+    record->Sequence = reader->NextSequence;
+    reader->NextSequence = NextSequence(reader->NextSequence);
+
+    return 1;
+}
+
+/*  Waits on the futex until a new record is published or the timeout expires.
+ *
+ *  @return true if a new record is available, false on timeout.
+*/
+bool TouchStreamWait(TouchStreamReader * reader, int32_t timeoutInMs)
+{
+    uint32_t writeSequence = __atomic_load_n(&reader->Header->WriteSequence, __ATOMIC_SEQ_CST);
+
+    if ((int32_t)(writeSequence - reader->NextSequence) >= 0)
+    {
+        return true;
+    }
+
+    struct timespec timeout = { .tv_sec = timeoutInMs / 1000, .tv_nsec = (timeoutInMs % 1000) * 1000000L };
+
+    // FUTEX_WAIT only reads the futex word, so it works on the read-only mapping.
+    __atomic_fetch_add(reader->Waiters, 1, __ATOMIC_SEQ_CST);
+    Futex(&reader->Header->WriteSequence, FUTEX_WAIT, writeSequence, timeoutInMs < 0 ? NULL : &timeout);
+    __atomic_fetch_sub(reader->Waiters, 1, __ATOMIC_SEQ_CST);
+
+    writeSequence = __atomic_load_n(&reader->Header->WriteSequence, __ATOMIC_ACQUIRE);
+
+    return (int32_t)(writeSequence - reader->NextSequence) >= 0;
+}
+
+/*  ********** Helper functions **********
+ *
+ */
+
+/*  Gets the sequence number following given one. Sequence number 0 is reserved for busy slots.
+ *
+ *  @return next sequence number.
+*/
+static uint32_t NextSequence(uint32_t sequence)
+{
+    return (sequence + 1 == 0) ? 1 : sequence + 1;
+}
+
+/*  Gets the size of the shared memory.
+ *
+ *  @return size in bytes.
+*/
+static size_t GetMappedSize(void)
+{
+    return sizeof(TouchStreamHeader) + TOUCH_STREAM_CAPACITY * sizeof(TouchStreamRecord);
+}
+
+/*  Gets the name of the shared memory object with the waiter count of given stream.
+ *
+ *  @return true on success, false if the name is too long.
+*/
+static bool GetWaitersName(const char * name, char * waitersName, size_t size)
+{
+    return (size_t)snprintf(waitersName, size, "%s%s", name, TOUCH_STREAM_WAITERS_SUFFIX) < size;
+}
+
+/*  Creates a new shared memory object of given mode and size. An object left with the name, e.g. by a crashed run or
+ *  created in advance by another user to get write access to it, is removed first, and the new object must be created
+ *  by this call and owned by this process.
+ *
+ *  @return file descriptor, -1 on fail with errno set.
+*/
+static int CreateSharedMemory(const char * name, mode_t mode, size_t size)
+{
+    if (shm_unlink(name) < 0 && errno != ENOENT)
+    {
+        return -1;
+    }
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, mode);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    if (status.st_uid != geteuid())
+    {
+        close(fd);
+        errno = EPERM;
+        return -1;
+    }
+
+    // The mode given to shm_open is restricted by the umask.
+    if (fchmod(fd, mode) < 0 || ftruncate(fd, size) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*  Maps the waiter count of given stream, creating it with write access for everyone if create is set.
+ *
+ *  @return waiter count, NULL on fail.
+*/
+static uint32_t * MapWaiters(const char * name, bool create)
+{
+    char waitersName[NAME_MAX];
+
+    if (!GetWaitersName(name, waitersName, sizeof(waitersName)))
+    {
+        return NULL;
+    }
+
+    int fd = create ? CreateSharedMemory(waitersName, 0666, sizeof(uint32_t)) : shm_open(waitersName, O_RDWR, 0);
+    if (fd < 0)
+    {
+        if (create)
+        {
+            perror("Error: Creating touch stream waiters");
+        }
+        return NULL;
+    }
+
+    void * memory = mmap(NULL, sizeof(uint32_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    return memory != MAP_FAILED ? (uint32_t *)memory : NULL;
+}
+
+/*  Calls the futex syscall on a shared (not process private) futex word.
+ *
+ *  @return result of the syscall.
+*/
+static long Futex(uint32_t * word, int operation, uint32_t value, const struct timespec * timeout)
+{
+    return syscall(SYS_futex, word, operation, value, timeout, NULL, 0);
+}
@@ -0,0 +1,104 @@
+#ifndef TOUCHSTREAM_H
+#define TOUCHSTREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Common.h"
+
+/*  ********** Shared memory touch stream **********
+ *
+ *  The application publishes touches into a ring buffer in POSIX shared memory (/dev/shm/multi-sensor-touches).
+ *  There is a single writer, the sensor group thread, and any number of readers in other processes.
+ *
+ *  Every record carries a sequence number. The writer marks a slot as busy (Sequence = 0), writes the payload and then
+ *  publishes it by storing its sequence number. Readers copy a slot and check that its sequence number is unchanged, so a
+ *  slow reader detects when it has been lapped instead of reading a torn record.
+ *
+ *  The ring is only writable by the application, readers map it read-only, so other local users can not feed fake
+ *  touches to the consumers. The number of readers blocked on the futex, which lets the writer skip the wake syscall
+ *  when nobody is waiting, is kept in a separate shared memory object that every reader may write
+ *  (/dev/shm/multi-sensor-touches-waiters). At worst another user can delay the wake-up of a blocked reader.
+ *
+ *  All shared words are 32 bits wide so they are lock free on every supported architecture, sequence numbers wrap.
+ */
+
+#define TOUCH_STREAM_NAME "/multi-sensor-touches"
+#define TOUCH_STREAM_MAGIC 0x4D53544E       // "NTSM"
+#define TOUCH_STREAM_VERSION 2
+#define TOUCH_STREAM_WAITERS_SUFFIX "-waiters"  // Appended to the stream name for the waiter count.
+#define TOUCH_STREAM_CAPACITY 1024          // Number of records in the ring, must be a power of two.
+
+typedef enum TouchStreamRecordType
+{
+    TouchStreamRecordMerged = 0,    //!< Touch as sent to the host.
+    TouchStreamRecordRaw = 1        //!< Unprocessed touch from a single sensor, in sensor coordinates.
+} TouchStreamRecordType;
+
+typedef struct TouchStreamRecord
+{
+    uint32_t Sequence;          //!< Sequence number of the record, 0 while the slot is being written.
+    uint8_t  Type;              //!< TouchStreamRecordType.
+    uint8_t  Event;             //!< ApplicationTouchEvent.
+    uint8_t  SensorPosition;    //!< SensorPosition of the sensor reporting the touch.
+    uint8_t  Reserved;
+    uint32_t X;                 //!< X coordinate, unit is 1/10 mm.
+    uint32_t Y;                 //!< Y coordinate, unit is 1/10 mm.
+    uint32_t ContactId;         //!< Contact id of merged touches, 0 for raw touches.
+    uint64_t Timestamp;         //!< Timestamp of the touch message.
+    uint64_t PublishTime;       //!< CLOCK_MONOTONIC time in microseconds when the record was published.
+} TouchStreamRecord;
+
+typedef struct TouchStreamHeader
+{
+    uint32_t Magic;             //!< TOUCH_STREAM_MAGIC when the stream is initialized.
+    uint32_t Version;           //!< TOUCH_STREAM_VERSION.
+    uint32_t Capacity;          //!< Number of records in the ring.
+    uint32_t RecordSize;        //!< sizeof(TouchStreamRecord).
+    uint32_t WriteSequence;     //!< Sequence number of the last published record, also used as futex word.
+    uint32_t Reserved[11];
+} TouchStreamHeader;
+
+typedef struct TouchStreamReader
+{
+    TouchStreamHeader * Header;
+    TouchStreamRecord * Records;
+    uint32_t          * Waiters;        //!< Number of readers waiting on the futex, see TOUCH_STREAM_WAITERS_SUFFIX.
+    uint32_t            NextSequence;   //!< Sequence number of the next record to read.
+    size_t              MappedSize;
+} TouchStreamReader;
+
+/*  Creates the shared memory ring buffer and starts publishing.
+ *
+ *  @return true on success, false on fail.
+*/
+bool TouchStreamOpen(const char * name);
+
+/*  Removes the shared memory ring buffer. Readers that still have it mapped keep their mapping.  */
+void TouchStreamClose(void);
+
+/*  Publishes a touch to all readers. Must only be called from one thread. Never blocks.  */
+void TouchStreamPublish(const TouchInfo * info, TouchStreamRecordType type);
+
+/*  Maps the ring buffer of a running application for reading. Reading starts with the next published record.
+ *
+ *  @return true on success, false on fail.
+*/
+bool TouchStreamOpenReader(TouchStreamReader * reader, const char * name);
+
+/*  Unmaps the ring buffer.  */
+void TouchStreamCloseReader(TouchStreamReader * reader);
+
+/*  Reads the next record without blocking.
+ *
+ *  @return 1 if a record was read, 0 if no new record is available,
+ *          -1 if the reader was lapped by the writer and records were lost. Reading then continues with the oldest record.
+*/
+int TouchStreamRead(TouchStreamReader * reader, TouchStreamRecord * record);
+
+/*  Waits on the futex until a new record is published or the timeout expires.
+ *
+ *  @return true if a new record is available, false on timeout.
+*/
+bool TouchStreamWait(TouchStreamReader * reader, int32_t timeoutInMs);
+
+#endif // TOUCHSTREAM_H
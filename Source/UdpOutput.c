@@ -0,0 +1,235 @@
+#include "Output.h"
+#include "Settings.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define OSC_BUFFER_SIZE 1024
+#define TUIO_SOURCE "multi-sensor-app"
+
+typedef struct OscBuffer
+{
+    uint8_t Data[OSC_BUFFER_SIZE];
+    size_t  Length;
+    size_t  MessageStart;
+} OscBuffer;
+
+typedef struct UdpOutput
+{
+    int      Socket;
+    int32_t  FrameSequence;
+} UdpOutput;
+
+static bool UdpOpen(OutputBackend * self);
+static bool UdpSend(OutputBackend * self, const TouchFrame * frame);
+static void UdpClose(OutputBackend * self);
+
+static void OscBeginMessage(OscBuffer * buffer, const char * address, const char * types);
+static void OscEndMessage(OscBuffer * buffer);
+static void OscAppendString(OscBuffer * buffer, const char * string);
+static void OscAppendInt32(OscBuffer * buffer, int32_t value);
+static void OscAppendFloat(OscBuffer * buffer, float value);
+
+/*  Creates the TUIO over UDP backend.
+ *
+ *  @return new backend, NULL if out of memory.
+*/
+OutputBackend * UdpOutputNew(void)
+{
+    OutputBackend * backend = calloc(1, sizeof(OutputBackend) + sizeof(UdpOutput));
+    if (backend == NULL)
+    {
+        return NULL;
+    }
+
+    UdpOutput * udp = (UdpOutput *)(backend + 1);
+    udp->Socket = -1;
+
+    backend->Name = "udp";
+    backend->Private = udp;
+    backend->Open = UdpOpen;
+    backend->Send = UdpSend;
+    backend->SendRaw = NULL;
+    backend->Close = UdpClose;
+
+    return backend;
+}
+
+/*  Creates a UDP socket connected to the udp-target setting.
+ *
+ *  @return true on success, false on fail.
+*/
+static bool UdpOpen(OutputBackend * self)
+{
+    UdpOutput * udp = (UdpOutput *)self->Private;
+    char host[MAX_SETTING_STRING_SIZE] = { 0 };
+
+    strcpy(host, GetSettings()->UdpTarget);
+    char * port = strrchr(host, ':');
+    if (port == NULL)
+    {
+        printf("Error: udp-target must be on the form host:port. \n");
+        return false;
+    }
+    *port++ = 0;
+
+    struct addrinfo hints = { 0 };
+    struct addrinfo * address = NULL;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    int result = getaddrinfo(host, port, &hints, &address);
+    if (result != 0)
+    {
+        printf("Error: Resolving udp-target %s: %s \n", GetSettings()->UdpTarget, gai_strerror(result));
+        return false;
+    }
+
+    udp->Socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (udp->Socket < 0 || connect(udp->Socket, address->ai_addr, address->ai_addrlen) < 0)
+    {
+        perror("Error: Creating udp socket");
+        freeaddrinfo(address);
+        return false;
+    }
+    freeaddrinfo(address);
+
+    return true;
+}
+
+/*  Sends the frame as a TUIO 1.1 2Dcur bundle with normalized coordinates. The contact id is used as session id,
+ *  released contacts are left out of the alive list.
+ *
+ *  @return always true, send errors are not fatal.
+*/
+static bool UdpSend(OutputBackend * self, const TouchFrame * frame)
+{
+    UdpOutput * udp = (UdpOutput *)self->Private;
+    static OscBuffer buffer;
+    const TouchInfo * alive[MAX_CONTACTS];
+    char aliveTypes[MAX_CONTACTS + 3] = ",s";
+    int numberOfAlive = 0;
+
+    for (int i = 0; i < frame->NumberOfContacts && numberOfAlive < MAX_CONTACTS; i++)
+    {
+        if (frame->Contacts[i].Event == App_DownEvent || frame->Contacts[i].Event == App_MoveEvent)
+        {
+            alive[numberOfAlive] = &frame->Contacts[i];
+            aliveTypes[2 + numberOfAlive++] = 'i';
+        }
+    }
+
+    buffer.Length = 0;
+    OscAppendString(&buffer, "#bundle");
+    OscAppendInt32(&buffer, 0);    // Time tag 1 means immediately.
+    OscAppendInt32(&buffer, 1);
+
+    OscBeginMessage(&buffer, "/tuio/2Dcur", ",ss");
+    OscAppendString(&buffer, "source");
+    OscAppendString(&buffer, TUIO_SOURCE);
+    OscEndMessage(&buffer);
+
+    OscBeginMessage(&buffer, "/tuio/2Dcur", aliveTypes);
+    OscAppendString(&buffer, "alive");
+    for (int i = 0; i < numberOfAlive; i++)
+    {
+        OscAppendInt32(&buffer, alive[i]->ContactId);
+    }
+    OscEndMessage(&buffer);
+
+    for (int i = 0; i < numberOfAlive; i++)
+    {
+        float x = (float)alive[i]->X / GetSettings()->ScreenWidth;
+        float y = (float)alive[i]->Y / GetSettings()->ScreenHeight;
+
+        OscBeginMessage(&buffer, "/tuio/2Dcur", ",sifffff");
+        OscAppendString(&buffer, "set");
+        OscAppendInt32(&buffer, alive[i]->ContactId);
+        OscAppendFloat(&buffer, x > 1.0f ? 1.0f : x);
+        OscAppendFloat(&buffer, y > 1.0f ? 1.0f : y);
+        OscAppendFloat(&buffer, 0.0f);  // Velocity and acceleration are optional in TUIO.
+        OscAppendFloat(&buffer, 0.0f);
+        OscAppendFloat(&buffer, 0.0f);
+        OscEndMessage(&buffer);
+    }
+
+    OscBeginMessage(&buffer, "/tuio/2Dcur", ",si");
+    OscAppendString(&buffer, "fseq");
+    OscAppendInt32(&buffer, ++udp->FrameSequence);
+    OscEndMessage(&buffer);
+
+    // Nobody listening gives ECONNREFUSED on a connected socket, which is expected.
+    send(udp->Socket, buffer.Data, buffer.Length, MSG_DONTWAIT);
+
+    return true;
+}
+
+/*  Closes the socket.  */
+static void UdpClose(OutputBackend * self)
+{
+    UdpOutput * udp = (UdpOutput *)self->Private;
+
+    if (udp->Socket >= 0)
+    {
+        close(udp->Socket);
+    }
+    free(self);
+}
+
+/*  ********** OSC encoding **********
+ *
+ */
+
+/*  Starts a bundle element, the size is filled in by OscEndMessage.  */
+static void OscBeginMessage(OscBuffer * buffer, const char * address, const char * types)
+{
+    buffer->MessageStart = buffer->Length;
+    OscAppendInt32(buffer, 0);
+    OscAppendString(buffer, address);
+    OscAppendString(buffer, types);
+}
+
+/*  Writes the size of the current bundle element.  */
+static void OscEndMessage(OscBuffer * buffer)
+{
+    uint32_t size = htonl(buffer->Length - buffer->MessageStart - sizeof(uint32_t));
+    memcpy(&buffer->Data[buffer->MessageStart], &size, sizeof(size));
+}
+
+/*  Appends a NUL terminated string padded to a multiple of 4 bytes.  */
+static void OscAppendString(OscBuffer * buffer, const char * string)
+{
+    size_t length = strlen(string) + 1;
+    size_t padded = (length + 3) & ~(size_t)3;
+
+    if (buffer->Length + padded <= OSC_BUFFER_SIZE)
+    {
+        memset(&buffer->Data[buffer->Length], 0, padded);
+        memcpy(&buffer->Data[buffer->Length], string, length);
+        buffer->Length += padded;
+    }
+}
+
+/*  Appends a big endian 32 bit integer.  */
+static void OscAppendInt32(OscBuffer * buffer, int32_t value)
+{
+    uint32_t bigEndian = htonl((uint32_t)value);
+
+    if (buffer->Length + sizeof(bigEndian) <= OSC_BUFFER_SIZE)
+    {
+        memcpy(&buffer->Data[buffer->Length], &bigEndian, sizeof(bigEndian));
+        buffer->Length += sizeof(bigEndian);
+    }
+}
+
+/*  Appends a big endian 32 bit float.  */
+static void OscAppendFloat(OscBuffer * buffer, float value)
+{
+    int32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    OscAppendInt32(buffer, bits);
+}
@@ -0,0 +1,218 @@
+#include "Output.h"
+#include "Settings.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+#define UINPUT_DEVICE "/dev/uinput"
+#define UINPUT_DEVICE_NAME "Neonode Multi Sensor Touch"
+#define MAX_TRACKING_ID 0xFFFF
+
+typedef struct UinputOutput
+{
+    int      Device;
+    bool     IsTouching;
+    bool     SlotInUse[MAX_CONTACTS];
+    uint32_t SlotContactId[MAX_CONTACTS];
+} UinputOutput;
+
+static bool UinputOpen(OutputBackend * self);
+static bool UinputSend(OutputBackend * self, const TouchFrame * frame);
+static void UinputClose(OutputBackend * self);
+static int FindSlot(UinputOutput * uinput, const TouchInfo * contact);
+static void EmitEvent(struct input_event * events, int * count, uint16_t type, uint16_t code, int32_t value);
+
+/*  Creates the Linux uinput touchscreen backend.
+ *
+ *  @return new backend, NULL if out of memory.
+*/
+OutputBackend * UinputOutputNew(void)
+{
+    OutputBackend * backend = calloc(1, sizeof(OutputBackend) + sizeof(UinputOutput));
+    if (backend == NULL)
+    {
+        return NULL;
+    }
+
+    UinputOutput * uinput = (UinputOutput *)(backend + 1);
+    uinput->Device = -1;
+
+    backend->Name = "uinput";
+    backend->Private = uinput;
+    backend->Open = UinputOpen;
+    backend->Send = UinputSend;
+    backend->SendRaw = NULL;
+    backend->Close = UinputClose;
+
+    return backend;
+}
+
+/*  Creates a direct multi-touch input device (protocol B) with the host screen size as axis range, unit is 1/10 mm.
+ *  The single touch axes follow the first contact for clients that do not handle multi-touch.
+ *
+ *  @return true on success, false on fail.
+*/
+static bool UinputOpen(OutputBackend * self)
+{
+    UinputOutput * uinput = (UinputOutput *)self->Private;
+
+    uinput->Device = open(UINPUT_DEVICE, O_WRONLY | O_NONBLOCK);
+    if (uinput->Device < 0)
+    {
+        perror("Error: Opening " UINPUT_DEVICE);
+        return false;
+    }
+
+    struct uinput_user_dev device;
+    memset(&device, 0, sizeof(device));
+    snprintf(device.name, UINPUT_MAX_NAME_SIZE, UINPUT_DEVICE_NAME);
+    device.id.bustype = BUS_VIRTUAL;
+    device.id.vendor = 0x1536;
+    device.id.product = 0x0101;
+    device.id.version = 1;
+    device.absmax[ABS_X] = GetSettings()->ScreenWidth;
+    device.absmax[ABS_Y] = GetSettings()->ScreenHeight;
+    device.absmax[ABS_MT_SLOT] = MAX_CONTACTS - 1;
+    device.absmax[ABS_MT_TRACKING_ID] = MAX_TRACKING_ID;
+    device.absmax[ABS_MT_POSITION_X] = GetSettings()->ScreenWidth;
+    device.absmax[ABS_MT_POSITION_Y] = GetSettings()->ScreenHeight;
+
+    if (ioctl(uinput->Device, UI_SET_EVBIT, EV_SYN) < 0 ||
+        ioctl(uinput->Device, UI_SET_EVBIT, EV_KEY) < 0 ||
+        ioctl(uinput->Device, UI_SET_KEYBIT, BTN_TOUCH) < 0 ||
+        ioctl(uinput->Device, UI_SET_EVBIT, EV_ABS) < 0 ||
+        ioctl(uinput->Device, UI_SET_ABSBIT, ABS_X) < 0 ||
+        ioctl(uinput->Device, UI_SET_ABSBIT, ABS_Y) < 0 ||
+        ioctl(uinput->Device, UI_SET_ABSBIT, ABS_MT_SLOT) < 0 ||
+        ioctl(uinput->Device, UI_SET_ABSBIT, ABS_MT_TRACKING_ID) < 0 ||
+        ioctl(uinput->Device, UI_SET_ABSBIT, ABS_MT_POSITION_X) < 0 ||
+        ioctl(uinput->Device, UI_SET_ABSBIT, ABS_MT_POSITION_Y) < 0 ||
+        ioctl(uinput->Device, UI_SET_PROPBIT, INPUT_PROP_DIRECT) < 0 ||
+        write(uinput->Device, &device, sizeof(device)) != sizeof(device) ||
+        ioctl(uinput->Device, UI_DEV_CREATE) < 0)
+    {
+        perror("Error: Creating uinput device");
+        close(uinput->Device);
+        uinput->Device = -1;
+        return false;
+    }
+
+    return true;
+}
+
+/*  Sends every contact in its own slot followed by the single touch position and touch button state.
+ *
+ *  @return always true, write errors are reported but not fatal.
+*/
+static bool UinputSend(OutputBackend * self, const TouchFrame * frame)
+{
+    UinputOutput * uinput = (UinputOutput *)self->Private;
+    struct input_event events[MAX_CONTACTS * 4 + 4];
+    int count = 0;
+    const TouchInfo * primary = NULL;
+
+    for (int i = 0; i < frame->NumberOfContacts; i++)
+    {
+        const TouchInfo * contact = &frame->Contacts[i];
+        bool isDown = contact->Event == App_DownEvent || contact->Event == App_MoveEvent;
+        int slot = FindSlot(uinput, contact);
+
+        if (slot < 0 || (!isDown && !uinput->SlotInUse[slot]))
+        {
+            continue;
+        }
+
+        EmitEvent(events, &count, EV_ABS, ABS_MT_SLOT, slot);
+        if (!isDown)
+        {
+            EmitEvent(events, &count, EV_ABS, ABS_MT_TRACKING_ID, -1);
+            uinput->SlotInUse[slot] = false;
+            continue;
+        }
+
+        if (!uinput->SlotInUse[slot])
+        {
+            EmitEvent(events, &count, EV_ABS, ABS_MT_TRACKING_ID, contact->ContactId & MAX_TRACKING_ID);
+            uinput->SlotInUse[slot] = true;
+            uinput->SlotContactId[slot] = contact->ContactId;
+        }
+        EmitEvent(events, &count, EV_ABS, ABS_MT_POSITION_X, contact->X);
+        EmitEvent(events, &count, EV_ABS, ABS_MT_POSITION_Y, contact->Y);
+
+        if (primary == NULL)
+        {
+            primary = contact;
+        }
+    }
+
+    bool isTouching = primary != NULL;
+    if (isTouching)
+    {
+        EmitEvent(events, &count, EV_ABS, ABS_X, primary->X);
+        EmitEvent(events, &count, EV_ABS, ABS_Y, primary->Y);
+    }
+    if (isTouching != uinput->IsTouching)
+    {
+        EmitEvent(events, &count, EV_KEY, BTN_TOUCH, isTouching);
+        uinput->IsTouching = isTouching;
+    }
+    EmitEvent(events, &count, EV_SYN, SYN_REPORT, 0);
+
+    if (write(uinput->Device, events, count * sizeof(struct input_event)) < 0)
+    {
+        perror("Error: Writing to uinput");
+    }
+
+    return true;
+}
+
+/*  Finds the slot of a contact, or a free slot for a new contact.
+ *
+ *  @return slot index, -1 if all slots are in use.
+*/
+static int FindSlot(UinputOutput * uinput, const TouchInfo * contact)
+{
+    int freeSlot = -1;
+
+    for (int slot = 0; slot < MAX_CONTACTS; slot++)
+    {
+        if (uinput->SlotInUse[slot] && uinput->SlotContactId[slot] == contact->ContactId)
+        {
+            return slot;
+        }
+        if (!uinput->SlotInUse[slot] && freeSlot < 0)
+        {
+            freeSlot = slot;
+        }
+    }
+
+    return freeSlot;
+}
+
+/*  Destroys the input device.  */
+static void UinputClose(OutputBackend * self)
+{
+    UinputOutput * uinput = (UinputOutput *)self->Private;
+
+    if (uinput->Device >= 0)
+    {
+        ioctl(uinput->Device, UI_DEV_DESTROY);
+        close(uinput->Device);
+    }
+    free(self);
+}
+
+/*  Adds an input event to given array.  */
+static void EmitEvent(struct input_event * events, int * count, uint16_t type, uint16_t code, int32_t value)
+{
+    memset(&events[*count], 0, sizeof(struct input_event));
+    events[*count].type = type;
+    events[*count].code = code;
+    events[*count].value = value;
+    (*count)++;
+}
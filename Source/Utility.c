@@ -1,16 +1,28 @@
 #include "Utility.h"
+#include "Settings.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <dirent.h>
 #include <zForce.h>
 
+#define HIDRAW_CLASS_PATH "/sys/class/hidraw"
+#define MAX_DEVICE_PATH_SIZE 256
+#define HIDPIPE_INTERFACE_NUMBER 0      // USB interface of a sensor that the hidpipe transport of zForceSDK opens.
+
+static bool IsHidpipeInterface(const char * devicePath);
+static bool ContainsString(char strings[][MAX_USB_PATH_SIZE], int count, const char * string);
+static int CompareStrings(const void * a, const void * b);
+
 /*  ********** File handling ********** 
  *
  */
 
-/*  Reads the sensor_positions.csv containing the MCU unique identifiers and sensor positions. 
+/*  Reads the sensor_positions.csv containing the MCU unique identifiers and sensor positions, and the cached touch
+ *  active area and USB port of each sensor. Files with only positions and identifiers are read without the cache, and
+ *  lines with only a position and a USB port map the port to the position. Empty identifiers are NULL.
  * 
- *  @return true if it successfully reads out the number of sensor positions equal to NUMBER_OF_SENSORS, otherwise false.
+ *  @return true if it successfully reads out the number of sensor positions given by the sensors setting, otherwise false.
 */
 bool ReadSensorPositionsFile(SensorConfiguration sensorConfigs[])
 {
@@ -29,31 +41,42 @@ bool ReadSensorPositionsFile(SensorConfiguration sensorConfigs[])
         char line[MAX_FILE_STRING_SIZE];
         while (fgets(line, MAX_FILE_STRING_SIZE, configFile))
         {
-            int valueIndex = 0;
-            char *values = strtok(line, ",");
-            while (values != NULL)
+            // Fields may be empty, e.g. 2,,,,1-1.3 maps a USB port to a position, so strtok can not be used.
+            char * values = line;
+            for (int valueIndex = 0; values != NULL && valueIndex < 5; valueIndex++)
             {
-                int len = strlen(values);
-                if (len > 0 && values[len - 1] == '\n')
+                char * next = strchr(values, ',');
+                if (next != NULL)
                 {
-                    values[len - 1] = 0; // remove \n character.
+                    *next++ = 0;
                 }
+                values[strcspn(values, "\r\n")] = 0; // remove \n character.
 
                 if (valueIndex == 0)
                 {
                     sensorConfigs[sensorIndex].SensorPosition = atoi(values);
                 }
-                else if (valueIndex == 1)
+                else if (valueIndex == 1 && values[0] != 0)
                 {
                     sensorConfigs[sensorIndex].McuUniqueIdentifier = (char*)zForceInstance->OsAbstractionLayer.MallocWithPattern(strlen(values) + 1, 0);
                     strcpy(sensorConfigs[sensorIndex].McuUniqueIdentifier, values);
-                    break;
                 }
-                valueIndex++;
-                values = strtok(NULL, ",");
+                else if (valueIndex == 2)
+                {
+                    sensorConfigs[sensorIndex].TouchActiveAreaWidth = atoi(values);
+                }
+                else if (valueIndex == 3)
+                {
+                    sensorConfigs[sensorIndex].TouchActiveAreaHeight = atoi(values);
+                }
+                else if (valueIndex == 4 && strlen(values) < MAX_USB_PATH_SIZE)
+                {
+                    strcpy(sensorConfigs[sensorIndex].UsbPath, values);
+                }
+                values = next;
             }
             sensorIndex++;
-            if (sensorIndex == NUMBER_OF_SENSORS)
+            if (sensorIndex == GetSettings()->Sensors)
             {
                 result = true;
                 break;
@@ -64,7 +87,8 @@ bool ReadSensorPositionsFile(SensorConfiguration sensorConfigs[])
     return result;
 }
 
-/*  Writes the given SensorConfigurations MCU unique identifiers and sensor positions to the sensor_positions.csv file.
+/*  Writes the given SensorConfigurations MCU unique identifiers, sensor positions, touch active areas and USB ports to
+ *  the sensor_positions.csv file.
  * 
  *  @return true on success, false on fail.
 */
@@ -74,9 +98,11 @@ bool WriteSensorPositionsFile(SensorConfiguration sensorConfigs[])
     if ((configFile = fopen("sensor_positions.csv", "w")))
     {
         printf("Creating sensor_positions.csv file.\n");
-        for (int i = 0; i < NUMBER_OF_SENSORS; i++)
+        for (int i = 0; i < GetSettings()->Sensors; i++)
         {
-            fprintf(configFile, "%d,%s\n", sensorConfigs[i].SensorPosition, sensorConfigs[i].McuUniqueIdentifier);
+            fprintf(configFile, "%d,%s,%u,%u,%s\n", sensorConfigs[i].SensorPosition,
+                sensorConfigs[i].McuUniqueIdentifier != NULL ? sensorConfigs[i].McuUniqueIdentifier : "",
+                sensorConfigs[i].TouchActiveAreaWidth, sensorConfigs[i].TouchActiveAreaHeight, sensorConfigs[i].UsbPath);
         }
         fclose(configFile);
     }
@@ -88,6 +114,179 @@ bool WriteSensorPositionsFile(SensorConfiguration sensorConfigs[])
     return true;
 }
 
+/*  ********** USB devices ********** 
+ *
+ */
+
+/*  Gets the USB port paths, e.g. 1-1.2, of the HID devices with given vendor and product id, in the order of their
+ *  sysfs paths, the same order as a udev enumeration. Like zForceSDK, only the HID device on the hidpipe interface of
+ *  a sensor is counted, so a sensor with several HID interfaces is listed once and entry i is hidpipe index i.
+ * 
+ *  @return number of devices, at most maxPaths.
+*/
+int GetUsbPortPaths(uint16_t vendorId, uint16_t productId, char paths[][MAX_USB_PATH_SIZE], int maxPaths)
+{
+    char devicePaths[MAX_HID_DEVICES][MAX_DEVICE_PATH_SIZE];
+    int numberOfDevices = 0;
+    int numberOfPaths = 0;
+    DIR * directory = opendir(HIDRAW_CLASS_PATH);
+
+    if (directory == NULL)
+    {
+        return 0;
+    }
+
+    for (struct dirent * entry = readdir(directory); entry != NULL && numberOfDevices < MAX_HID_DEVICES; entry = readdir(directory))
+    {
+        char filePath[sizeof(HIDRAW_CLASS_PATH) + sizeof(entry->d_name) + sizeof("/device/uevent")];
+        char line[MAX_FILE_STRING_SIZE];
+        unsigned int bus, vendor, product;
+        bool isMatch = false;
+
+        if (entry->d_name[0] == '.')
+        {
+            continue;
+        }
+
+        snprintf(filePath, sizeof(filePath), HIDRAW_CLASS_PATH "/%s/device/uevent", entry->d_name);
+        FILE * uevent = fopen(filePath, "r");
+        if (uevent == NULL)
+        {
+            continue;
+        }
+        while (!isMatch && fgets(line, sizeof(line), uevent))
+        {
+            isMatch = sscanf(line, "HID_ID=%x:%x:%x", &bus, &vendor, &product) == 3 && vendor == vendorId && product == productId;
+        }
+        fclose(uevent);
+
+        snprintf(filePath, sizeof(filePath), HIDRAW_CLASS_PATH "/%s/device", entry->d_name);
+        char * devicePath = isMatch ? realpath(filePath, NULL) : NULL;
+        if (devicePath != NULL && strlen(devicePath) < MAX_DEVICE_PATH_SIZE && IsHidpipeInterface(devicePath))
+        {
+            strcpy(devicePaths[numberOfDevices++], devicePath);
+        }
+        free(devicePath);
+    }
+    closedir(directory);
+
+    qsort(devicePaths, numberOfDevices, sizeof(devicePaths[0]), CompareStrings);
+
+    for (int i = 0; i < numberOfDevices && numberOfPaths < maxPaths; i++)
+    {
+        if (GetUsbPortFromDevicePath(devicePaths[i], paths[numberOfPaths], MAX_USB_PATH_SIZE) &&
+            !ContainsString(paths, numberOfPaths, paths[numberOfPaths]))
+        {
+            numberOfPaths++;
+        }
+    }
+
+    return numberOfPaths;
+}
+
+/*  Gets the USB port path, e.g. 1-1.2, of a HID device with given vendor and product id. Devices are indexed in the
+ *  order of their sysfs paths, the same order as a udev enumeration.
+ * 
+ *  @return true on success, false if there is no such device.
+*/
+bool GetUsbPortPath(uint16_t vendorId, uint16_t productId, int index, char * path, size_t size)
+{
+    char paths[MAX_HID_DEVICES][MAX_USB_PATH_SIZE];
+    int numberOfPaths = GetUsbPortPaths(vendorId, productId, paths, MAX_HID_DEVICES);
+
+    if (index < 0 || index >= numberOfPaths || strlen(paths[index]) >= size)
+    {
+        return false;
+    }
+
+    strcpy(path, paths[index]);
+    return true;
+}
+
+/*  Gets the USB port path, e.g. 1-1.2, from the sysfs path of a device on the port or one of its interfaces.
+ * 
+ *  @return true on success, false if the device is not on a USB port.
+*/
+bool GetUsbPortFromDevicePath(const char * devicePath, char * path, size_t size)
+{
+    char buffer[MAX_DEVICE_PATH_SIZE];
+
+    if (strlen(devicePath) >= sizeof(buffer))
+    {
+        return false;
+    }
+    strcpy(buffer, devicePath);
+
+    // The port is the parent of the first interface, e.g. .../usb1/1-1/1-1.2/1-1.2:1.0/0003:1536:0101.0001.
+    // Called from several threads, so strtok_r.
+    char * position = NULL;
+    for (char * component = strtok_r(buffer, "/", &position); component != NULL; component = strtok_r(NULL, "/", &position))
+    {
+        char * colon = strchr(component, ':');
+        if (colon != NULL && memchr(component, '-', colon - component) != NULL && (size_t)(colon - component) < size)
+        {
+            memcpy(path, component, colon - component);
+            path[colon - component] = 0;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*  Checks if the HID device with given sysfs path is on the hidpipe interface of its USB device, e.g.
+ *  .../1-1.2/1-1.2:1.0/0003:1536:0101.0001 is on interface 0.
+ * 
+ *  @return true if it is, false if it is on another interface or not on USB.
+*/
+static bool IsHidpipeInterface(const char * devicePath)
+{
+    char filePath[MAX_DEVICE_PATH_SIZE + sizeof("/bInterfaceNumber")];
+    const char * parentEnd = strrchr(devicePath, '/');
+    unsigned int interfaceNumber;
+
+    if (parentEnd == NULL)
+    {
+        return false;
+    }
+
+    snprintf(filePath, sizeof(filePath), "%.*s/bInterfaceNumber", (int)(parentEnd - devicePath), devicePath);
+    FILE * file = fopen(filePath, "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    bool isMatch = fscanf(file, "%x", &interfaceNumber) == 1 && interfaceNumber == HIDPIPE_INTERFACE_NUMBER;
+    fclose(file);
+
+    return isMatch;
+}
+
+/*  Checks if a string is among the first count strings.
+ * 
+ *  @return true if found.
+*/
+static bool ContainsString(char strings[][MAX_USB_PATH_SIZE], int count, const char * string)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(strings[i], string) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*  Compares two strings for qsort.
+ * 
+ *  @return result of strcmp.
+*/
+static int CompareStrings(const void * a, const void * b)
+{
+    return strcmp((const char *)a, (const char *)b);
+}
+
 /*  ********** Timestamps ********** 
  *
  */
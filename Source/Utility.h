@@ -5,19 +5,44 @@
 #include <stdbool.h>
 
 #define MAX_FILE_STRING_SIZE 100
+#define MAX_HID_DEVICES 16
 
-/*  Reads the sensor_positions.csv file containing the MCU unique identifiers and sensor positions. 
+/*  Reads the sensor_positions.csv file containing the MCU unique identifiers and sensor positions, and the cached touch
+ *  active area and USB port of each sensor. Files with only positions and identifiers are read without the cache, and
+ *  lines with only a position and a USB port map the port to the position. Empty identifiers are NULL.
  * 
- *  @return true if it successfully reads out the number of sensor positions equal to NUMBER_OF_SENSORS, otherwise false.
+ *  @return true if it successfully reads out the number of sensor positions given by the sensors setting, otherwise false.
 */
 bool ReadSensorPositionsFile(SensorConfiguration sensorConfigs[]);
 
-/*  Writes the given SensorConfigurations MCU unique identifiers and sensor positions to the sensor_positions.csv file.
+/*  Writes the given SensorConfigurations MCU unique identifiers, sensor positions, touch active areas and USB ports to
+ *  the sensor_positions.csv file.
  * 
  *  @return true on success, false on fail.
 */
 bool WriteSensorPositionsFile(SensorConfiguration sensorConfigs[]);
 
+/*  Gets the USB port path, e.g. 1-1.2, of a HID device with given vendor and product id. Devices are indexed in the
+ *  order of their sysfs paths, the same order as a udev enumeration.
+ * 
+ *  @return true on success, false if there is no such device.
+*/
+bool GetUsbPortPath(uint16_t vendorId, uint16_t productId, int index, char * path, size_t size);
+
+/*  Gets the USB port paths, e.g. 1-1.2, of the HID devices with given vendor and product id, in the order of their
+ *  sysfs paths, the same order as a udev enumeration. Only the hidpipe interface of each sensor is counted, so entry i
+ *  is hidpipe index i.
+ * 
+ *  @return number of devices, at most maxPaths.
+*/
+int GetUsbPortPaths(uint16_t vendorId, uint16_t productId, char paths[][MAX_USB_PATH_SIZE], int maxPaths);
+
+/*  Gets the USB port path, e.g. 1-1.2, from the sysfs path of a device on the port or one of its interfaces.
+ * 
+ *  @return true on success, false if the device is not on a USB port.
+*/
+bool GetUsbPortFromDevicePath(const char * devicePath, char * path, size_t size);
+
 /*  Gets the difference between two timestamps in milliseconds.
  * 
  *  @return the difference in milliseconds.